@@ -0,0 +1,270 @@
+// Mesh analyzer: measures how well OBJ files or cooked ".mesh" caches will render, as JSON for the asset dashboards.
+//
+//     analyzer [--cook] [--views N] [--resolution N] [-o report.json] <file.obj | file.mesh>...
+//
+// An OBJ is measured as loadOBJMesh builds it, or with --cook as the renderer and the cooker draw it
+// (optimized, see meshcooker.hpp). A cache is measured as it is stored, levels of detail left out.
+// Duplicate vertices are counted over an OBJ's face corners, and over a cache's vertices ("duplicatesOf").
+// The loaders' messages go to stderr, so that stdout is only the report.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "objloader.hpp"
+#include "meshcache.hpp"
+#include "meshcooker.hpp"
+#include "meshoptimizer.hpp"
+#include "meshanalyzer.hpp"
+#include "meshnormals.hpp"
+#include "vertexpacking.hpp"
+
+#define REPORT_VERSION 2
+
+struct Options {
+    bool cook;
+    unsigned int views;
+    unsigned int resolution;
+};
+
+// Face corners of an OBJ, and the distinct (v, vt, vn) triplets among them. loadOBJMesh keeps one vertex per
+// triplet, so they're its index and vertex counts, before cooking welds or splits anything else.
+struct CornerCounts {
+    size_t corners;
+    size_t unique;
+};
+
+static bool hasExtension(const std::string &path, const char *extension) {
+    size_t length = strlen(extension);
+    if(path.size() < length)
+        return false;
+    for(size_t i = 0; i < length; i++)
+        if(tolower(path[path.size() - length + i]) != extension[i])
+            return false;
+    return true;
+}
+
+// Copies a cache's streams into mesh, like VBO::loadObj does before uploading them.
+static bool loadCachedMesh(const char *path, Mesh &mesh, MeshCacheHeader &out_header) {
+    MeshCache cache;
+    if(!cache.openFile(path))
+        return false;
+    const MeshCacheHeader &header = cache.header();
+    out_header = header;
+    size_t count = header.vertexCount;
+    const glm::vec3 *vertices = (const glm::vec3 *)cache.attribute(MESH_ATTRIBUTE_POSITION);
+    const glm::vec2 *uvs = (const glm::vec2 *)cache.attribute(MESH_ATTRIBUTE_UV);
+    const glm::vec3 *normals = (const glm::vec3 *)cache.attribute(MESH_ATTRIBUTE_NORMAL);
+    mesh.vertices.assign(vertices, vertices + count);
+    mesh.uvs.assign(uvs, uvs + count);
+    mesh.normals.assign(normals, normals + count);
+    if(header.indexSize == 2) {
+        const unsigned short *indices = (const unsigned short *)cache.indexData();
+        mesh.indices.assign(indices, indices + header.indexCount);
+    } else if(header.indexSize == 4) {
+        const unsigned int *indices = (const unsigned int *)cache.indexData();
+        mesh.indices.assign(indices, indices + header.indexCount);
+    }
+    mesh.parts.assign(cache.parts(), cache.parts() + cache.partCount());
+    mesh.meshlets.assign(cache.meshlets(), cache.meshlets() + cache.meshletCount());
+    cache.materials(mesh.materials);
+    cache.groups(mesh.groups);
+    cache.lods(mesh.lods);
+    return true;
+}
+
+static void writeString(FILE *out, const std::string &str) {
+    fputc('"', out);
+    for(size_t i = 0; i < str.size(); i++) {
+        unsigned char c = (unsigned char)str[i];
+        if(c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if(c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void writeVector(FILE *out, const glm::vec3 &v) {
+    fprintf(out, "[%.9g, %.9g, %.9g]", v.x, v.y, v.z);
+}
+
+// corners is NULL for a cache.
+static void writeReport(FILE *out, const std::string &path, const Mesh &mesh, const CornerCounts *corners, const MeshCacheHeader *cache, const Options &options) {
+    // A mesh without indices draws its vertices in order
+    std::vector<unsigned int> sequential;
+    const std::vector<unsigned int> *indices = &mesh.indices;
+    if(mesh.indices.empty()) {
+        sequential.resize(mesh.vertices.size());
+        for(size_t i = 0; i < sequential.size(); i++)
+            sequential[i] = (unsigned int)i;
+        indices = &sequential;
+    }
+    size_t indexCount = fullMeshIndexCount(mesh);
+    const unsigned int *indexData = indices->data();
+    size_t vertexCount = mesh.vertices.size();
+
+    struct stat info;
+    fprintf(out, "    {\n      \"path\": ");
+    writeString(out, path);
+    fprintf(out, ",\n      \"format\": \"%s\",\n", cache ? (cache->compression == MESH_CACHE_COMPRESSED ? "cache-compressed" : "cache-raw") : (options.cook ? "obj-cooked" : "obj"));
+    fprintf(out, "      \"fileBytes\": %llu,\n", stat(path.c_str(), &info) == 0 ? (unsigned long long)info.st_size : 0ull);
+    fprintf(out, "      \"triangles\": %zu,\n      \"vertices\": %zu,\n      \"indices\": %zu,\n", indexCount / 3, vertexCount, mesh.indices.empty() ? 0 : indexCount);
+    fprintf(out, "      \"parts\": %zu,\n      \"groups\": %zu,\n      \"materials\": %zu,\n      \"meshlets\": %zu,\n",
+            mesh.parts.size(), mesh.groups.size(), mesh.materials.size(), mesh.meshlets.size());
+
+    fprintf(out, "      \"lods\": [");
+    for(size_t l = 0; l < mesh.lods.size(); l++) {
+        size_t lodIndices = 0;
+        for(size_t p = 0; p < mesh.lods[l].parts.size(); p++)
+            lodIndices += mesh.lods[l].parts[p].indexCount;
+        fprintf(out, "%s{ \"ratio\": %.4g, \"error\": %.6g, \"triangles\": %zu }", l ? ", " : "", mesh.lods[l].ratio, mesh.lods[l].error, lodIndices / 3);
+    }
+    fprintf(out, "],\n");
+
+    // An OBJ's duplicates are the face corners that repeat an earlier triplet, what writing one vertex per corner wastes :
+    // its loaded vertices can't have any left. A cache only has its vertices to compare
+    VertexDuplicateStats duplicates = analyzeVertexDuplicates(mesh, indexCount);
+    size_t duplicateCount = corners ? corners->corners - corners->unique : duplicates.duplicates;
+    size_t duplicateBase = corners ? corners->corners : vertexCount;
+    fprintf(out, "      \"duplicateVertices\": %zu,\n      \"duplicateVertexRatio\": %.6f,\n      \"duplicatesOf\": \"%s\",\n",
+            duplicateCount, duplicateBase ? (double)duplicateCount / duplicateBase : 0.0, corners ? "corners" : "vertices");
+    fprintf(out, "      \"sharedPositionVertices\": %zu,\n      \"unusedVertices\": %zu,\n", duplicates.sharedPositions, duplicates.unused);
+
+    // From the small post-transform caches of older GPUs to today's larger ones
+    const unsigned int cacheSizes[] = { 8, 16, 32, 64 };
+    fprintf(out, "      \"vertexCache\": [");
+    for(size_t i = 0; i < sizeof(cacheSizes) / sizeof(cacheSizes[0]); i++) {
+        VertexCacheStats stats = analyzeVertexCache(indexData, indexCount, vertexCount, cacheSizes[i]);
+        fprintf(out, "%s{ \"size\": %u, \"acmr\": %.4f, \"atvr\": %.4f }", i ? ", " : "", cacheSizes[i], stats.acmr, stats.atvr);
+    }
+    fprintf(out, "],\n");
+
+    OverdrawStats overdraw = analyzeOverdraw(indexData, indexCount, mesh.vertices.data(), vertexCount, options.views, options.resolution);
+    fprintf(out, "      \"overdraw\": { \"views\": %u, \"resolution\": %u, \"overdraw\": %.4f, \"coveredPixels\": %llu, \"shadedFragments\": %llu },\n",
+            options.views, options.resolution, overdraw.overdraw, overdraw.covered, overdraw.shaded);
+
+    // Bytes of each attribute stream in each encoding the renderer supports, for the full vertex buffer
+    // and, like "indices", the indices of the full mesh
+    fprintf(out, "      \"attributeBytes\": {\n");
+    fprintf(out, "        \"position\": { \"float\": %zu, \"half\": %zu, \"unorm16\": %zu },\n", vertexCount * positionStride(VERTEX_POSITION_FLOAT),
+            vertexCount * positionStride(VERTEX_POSITION_HALF), vertexCount * positionStride(VERTEX_POSITION_UNORM16));
+    fprintf(out, "        \"uv\": { \"float\": %zu, \"half\": %zu },\n", vertexCount * uvStride(VERTEX_UV_FLOAT), vertexCount * uvStride(VERTEX_UV_HALF));
+    fprintf(out, "        \"normal\": { \"float\": %zu, \"oct16\": %zu, \"oct8\": %zu },\n", vertexCount * normalStride(VERTEX_NORMAL_FLOAT),
+            vertexCount * normalStride(VERTEX_NORMAL_OCT16), vertexCount * normalStride(VERTEX_NORMAL_OCT8));
+    if(mesh.indices.empty())
+        fprintf(out, "        \"index\": {}\n");
+    else if(vertexCount <= 65536)
+        fprintf(out, "        \"index\": { \"uint16\": %zu, \"uint32\": %zu }\n", indexCount * 2, indexCount * 4);
+    else
+        fprintf(out, "        \"index\": { \"uint32\": %zu }\n", indexCount * 4);
+    fprintf(out, "      },\n");
+    if(cache) {
+        // What the streams take in the file, once coded for a compressed cache ; the indices include the levels of detail
+        fprintf(out, "      \"cacheStreamBytes\": { \"position\": %llu, \"uv\": %llu, \"normal\": %llu, \"index\": %llu },\n",
+                (unsigned long long)cache->attributes[MESH_ATTRIBUTE_POSITION].size, (unsigned long long)cache->attributes[MESH_ATTRIBUTE_UV].size,
+                (unsigned long long)cache->attributes[MESH_ATTRIBUTE_NORMAL].size, (unsigned long long)cache->indexBytes);
+    }
+
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    if(vertexCount > 0) {
+        boundsMin = boundsMax = mesh.vertices[0];
+        for(size_t i = 1; i < vertexCount; i++) {
+            boundsMin = glm::min(boundsMin, mesh.vertices[i]);
+            boundsMax = glm::max(boundsMax, mesh.vertices[i]);
+        }
+    }
+    fprintf(out, "      \"bounds\": { \"min\": ");
+    writeVector(out, boundsMin);
+    fprintf(out, ", \"max\": ");
+    writeVector(out, boundsMax);
+    fprintf(out, ", \"center\": ");
+    writeVector(out, (boundsMin + boundsMax) * 0.5f);
+    fprintf(out, ", \"radius\": %.9g }\n    }", glm::length(boundsMax - boundsMin) * 0.5f);
+}
+
+static void printUsage() {
+    fprintf(stderr, "Usage: analyzer [--cook] [--views N] [--resolution N] [-o report.json] <file.obj | file.mesh>...\n");
+    fprintf(stderr, "Writes triangle and vertex counts, vertex cache, overdraw, memory and bounds statistics as JSON.\n");
+}
+
+int main(int argc, const char * argv[]) {
+    Options options = { false, 8, 256 };
+    const char *outputPath = NULL;
+    std::vector<std::string> paths;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--cook") == 0) {
+            options.cook = true;
+        } else if(strcmp(argv[i], "--views") == 0 && i + 1 < argc) {
+            options.views = (unsigned int)std::max(1, atoi(argv[++i]));
+        } else if(strcmp(argv[i], "--resolution") == 0 && i + 1 < argc) {
+            options.resolution = (unsigned int)std::max(1, std::min(atoi(argv[++i]), 8192));
+        } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if(argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if(paths.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    // The report keeps the real stdout; everything else printed (the loaders' progress) goes to stderr
+    FILE *out = outputPath ? fopen(outputPath, "w") : fdopen(dup(STDOUT_FILENO), "w");
+    if(out == NULL) {
+        fprintf(stderr, "Impossible to write %s\n", outputPath ? outputPath : "the report");
+        return 1;
+    }
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    int failures = 0;
+    fprintf(out, "{\n  \"version\": %d,\n  \"meshes\": [\n", REPORT_VERSION);
+    for(size_t i = 0; i < paths.size(); i++) {
+        Mesh mesh;
+        MeshCacheHeader header;
+        CornerCounts corners = { 0, 0 };
+        bool isCache = hasExtension(paths[i], ".mesh");
+        bool loaded;
+        if(isCache) {
+            loaded = loadCachedMesh(paths[i].c_str(), mesh, header);
+        } else {
+            // Counted before cooking, which is cookOBJMesh's second half
+            loaded = loadOBJMesh(paths[i].c_str(), mesh, OBJ_LOAD_PARALLEL);
+            corners.corners = mesh.indices.size();
+            corners.unique = mesh.vertices.size();
+            loaded = loaded && (!options.cook || cookMesh(mesh));
+        }
+
+        if(i > 0)
+            fprintf(out, ",\n");
+        if(loaded) {
+            writeReport(out, paths[i], mesh, isCache ? NULL : &corners, isCache ? &header : NULL, options);
+        } else {
+            fprintf(out, "    { \"path\": ");
+            writeString(out, paths[i]);
+            fprintf(out, ", \"error\": \"impossible to load\" }");
+            failures++;
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    bool written = !ferror(out);
+    written = fclose(out) == 0 && written;
+    if(!written)
+        fprintf(stderr, "Impossible to write %s\n", outputPath ? outputPath : "the report");
+    return failures == 0 && written ? 0 : 1;
+}
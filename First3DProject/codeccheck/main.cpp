@@ -0,0 +1,368 @@
+// Mesh codec check: round trips random streams through meshcodec and the mesh cache, then feeds their decoders
+// truncated, bit-flipped and random data, which they must reject or decode without touching memory they don't own.
+//
+//     codeccheck [--seed N] [--iterations N]
+//
+// Exits with 1 on the first failure. Out of bounds accesses that stay inside the guard bytes around every output
+// are caught here; build with -fsanitize=address,undefined to catch all of them. The SSE2 decoders are checked
+// by default; build with -DMESHCODEC_SCALAR -DVERTEXPACKING_SCALAR to check the plain C++ ones instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "objloader.hpp"
+#include "meshcodec.hpp"
+#include "meshcache.hpp"
+#include "primitives.hpp"
+
+#define GUARD_BYTES 64
+#define GUARD_VALUE 0xA5
+
+static std::mt19937 generator;
+
+static bool check(bool condition, const char *what, unsigned int iteration) {
+    if(!condition)
+        printf("FAILED: %s (iteration %u)\n", what, iteration);
+    return condition;
+}
+
+static unsigned int randomBelow(unsigned int limit) {
+    return limit == 0 ? 0 : (unsigned int)(generator() % limit);
+}
+
+// Mostly small changes from one vertex to the next, like real meshes, with some noise so every plane width shows up.
+static void randomVertices(std::vector<unsigned char> &out, size_t count, size_t stride) {
+    out.resize(count * stride);
+    unsigned int noise = randomBelow(4);
+    for(size_t i = 0; i < out.size(); i++) {
+        unsigned char previous = i >= stride ? out[i - stride] : 0;
+        switch(randomBelow(8) < noise ? 3 : randomBelow(3)) {
+            case 0: out[i] = previous; break;
+            case 1: out[i] = (unsigned char)(previous + randomBelow(3) - 1); break;
+            case 2: out[i] = (unsigned char)(previous + randomBelow(15) - 7); break;
+            default: out[i] = (unsigned char)generator(); break;
+        }
+    }
+}
+
+// Near neighbours like an optimized index buffer, with some far jumps and, unless limit says otherwise, huge values.
+static void randomIndices(std::vector<unsigned int> &out, size_t count, unsigned int limit) {
+    out.resize(count);
+    unsigned int previous = randomBelow(limit);
+    for(size_t i = 0; i < count; i++) {
+        unsigned int index;
+        switch(randomBelow(8)) {
+            case 0: index = randomBelow(limit); break;
+            case 1: index = limit == 0 ? 0xFFFFFFFFu - randomBelow(8) : randomBelow(limit); break;
+            default: index = (unsigned int)std::min<int64_t>(std::max<int64_t>((int64_t)previous + randomBelow(64) - 32, 0), limit ? limit - 1 : 0xFFFFFFFFu); break;
+        }
+        out[i] = previous = index;
+    }
+}
+
+// A buffer of bytes with guards around it, so a decoder that writes past either end is caught.
+struct GuardedBuffer {
+    std::vector<unsigned char> storage;
+    size_t size;
+
+    explicit GuardedBuffer(size_t bytes) : storage(bytes + 2 * GUARD_BYTES, GUARD_VALUE), size(bytes) {}
+    unsigned char *data() { return &storage[GUARD_BYTES]; }
+    bool intact() const {
+        for(size_t i = 0; i < GUARD_BYTES; i++)
+            if(storage[i] != GUARD_VALUE || storage[GUARD_BYTES + size + i] != GUARD_VALUE)
+                return false;
+        return true;
+    }
+};
+
+// Truncates, extends, flips bits of or overwrites bytes of encoded.
+static void corrupt(std::vector<unsigned char> &encoded) {
+    switch(randomBelow(4)) {
+        case 0: encoded.resize(randomBelow((unsigned int)encoded.size())); break;
+        case 1: encoded.push_back((unsigned char)generator()); break;
+        case 2:
+            for(unsigned int flips = 1 + randomBelow(4); flips > 0 && !encoded.empty(); flips--)
+                encoded[randomBelow((unsigned int)encoded.size())] ^= (unsigned char)(1 << randomBelow(8));
+            break;
+        default:
+            for(unsigned int bytes = 1 + randomBelow(8); bytes > 0 && !encoded.empty(); bytes--)
+                encoded[randomBelow((unsigned int)encoded.size())] = (unsigned char)generator();
+            break;
+    }
+}
+
+static bool checkVertexStreams(unsigned int iterations) {
+    std::vector<unsigned char> vertices, encoded;
+    for(unsigned int i = 0; i < iterations; i++) {
+        size_t stride = 4 * (1 + randomBelow(MESH_CODEC_MAX_STRIDE / 4));
+        size_t count = randomBelow(4) == 0 ? randomBelow(2000) : randomBelow(70); // around group boundaries, and longer runs
+        randomVertices(vertices, count, stride);
+        encoded.clear();
+        if(!check(encodeVertexStream(vertices.data(), count, stride, encoded), "vertex stream encoding", i))
+            return false;
+
+        GuardedBuffer decoded(count * stride);
+        if(!check(decodeVertexStream(encoded.data(), encoded.size(), decoded.data(), count, stride), "vertex stream decoding", i)
+           || !check(memcmp(decoded.data(), vertices.data(), vertices.size()) == 0, "vertex stream round trip", i)
+           || !check(decoded.intact(), "vertex stream decoding stays in its output", i))
+            return false;
+        if(!encoded.empty()
+           && !check(!decodeVertexStream(encoded.data(), encoded.size() - 1, decoded.data(), count, stride), "truncated vertex stream rejected", i))
+            return false;
+
+        // Anything goes but writing out of place
+        corrupt(encoded);
+        GuardedBuffer corrupted(count * stride);
+        decodeVertexStream(encoded.data(), encoded.size(), corrupted.data(), count, stride);
+        if(!check(corrupted.intact(), "corrupted vertex stream decoding stays in its output", i))
+            return false;
+    }
+
+    const size_t badStrides[3] = { 6, MESH_CODEC_MAX_STRIDE + 4, 0 };
+    for(int i = 0; i < 3; i++)
+        if(!check(!encodeVertexStream(vertices.data(), 1, badStrides[i], encoded), "unsupported stride rejected", i))
+            return false;
+    printf("vertex streams: %u round trips ok\n", iterations);
+    return true;
+}
+
+static bool checkIndexStreams(unsigned int iterations) {
+    std::vector<unsigned int> indices;
+    std::vector<unsigned char> encoded;
+    for(unsigned int i = 0; i < iterations; i++) {
+        size_t count = randomBelow(4) == 0 ? randomBelow(5000) : randomBelow(100);
+        unsigned int limit = i % 3 == 0 ? 0 : i % 3 == 1 ? 65536 : 70000; // any, 16-bit, some just past 16-bit
+        randomIndices(indices, count, limit);
+        encoded.clear();
+        encodeIndexStream(indices.data(), count, encoded);
+
+        GuardedBuffer wide(count * sizeof(unsigned int));
+        if(!check(decodeIndexStream(encoded.data(), encoded.size(), (unsigned int *)wide.data(), count), "index stream decoding", i)
+           || !check(memcmp(wide.data(), indices.data(), count * sizeof(unsigned int)) == 0, "index stream round trip", i)
+           || !check(wide.intact(), "index stream decoding stays in its output", i))
+            return false;
+
+        bool fits = std::all_of(indices.begin(), indices.end(), [](unsigned int index) { return index < 65536; });
+        GuardedBuffer narrow(count * sizeof(unsigned short));
+        unsigned short *shorts = (unsigned short *)narrow.data();
+        if(!check(decodeIndexStream(encoded.data(), encoded.size(), shorts, count) == fits, "16-bit decoding fails exactly on indices past 65535", i)
+           || !check(narrow.intact(), "16-bit index stream decoding stays in its output", i))
+            return false;
+        for(size_t j = 0; fits && j < count; j++)
+            if(!check(shorts[j] == indices[j], "16-bit index stream round trip", i))
+                return false;
+        if(!encoded.empty()
+           && !check(!decodeIndexStream(encoded.data(), encoded.size() - 1, (unsigned int *)wide.data(), count), "truncated index stream rejected", i))
+            return false;
+
+        corrupt(encoded);
+        GuardedBuffer corruptedWide(count * sizeof(unsigned int));
+        GuardedBuffer corruptedNarrow(count * sizeof(unsigned short));
+        decodeIndexStream(encoded.data(), encoded.size(), (unsigned int *)corruptedWide.data(), count);
+        decodeIndexStream(encoded.data(), encoded.size(), (unsigned short *)corruptedNarrow.data(), count);
+        if(!check(corruptedWide.intact() && corruptedNarrow.intact(), "corrupted index stream decoding stays in its output", i))
+            return false;
+    }
+    printf("index streams: %u round trips ok\n", iterations);
+    return true;
+}
+
+static bool writeFile(const std::string &path, const void *data, size_t size) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if(file == NULL)
+        return false;
+    bool written = fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && written;
+}
+
+static bool readFile(const std::string &path, std::vector<unsigned char> &out) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if(file == NULL)
+        return false;
+    unsigned char buffer[4096];
+    size_t read;
+    out.clear();
+    while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        out.insert(out.end(), buffer, buffer + read);
+    fclose(file);
+    return true;
+}
+
+// A sphere, written out as an OBJ file for the cache to stat and hash. Its material library doesn't exist (yet).
+static bool writeSphere(const std::string &path) {
+    Mesh sphere;
+    generateSphere(sphere, 1.5f, 24, 12);
+    std::string text = "mtllib sphere.mtl\n";
+    char line[256];
+    for(size_t i = 0; i < sphere.vertices.size(); i++) {
+        snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn %f %f %f\n", sphere.vertices[i].x, sphere.vertices[i].y, sphere.vertices[i].z,
+                 sphere.uvs[i].x, sphere.uvs[i].y, sphere.normals[i].x, sphere.normals[i].y, sphere.normals[i].z);
+        text += line;
+    }
+    for(size_t i = 0; i + 2 < sphere.indices.size(); i += 3) {
+        unsigned int a = sphere.indices[i] + 1, b = sphere.indices[i + 1] + 1, c = sphere.indices[i + 2] + 1;
+        snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+        text += line;
+    }
+    return writeFile(path, text.data(), text.size());
+}
+
+// What openFile handed out matches mesh, exactly for a raw cache, within the quantization of a compressed one.
+static bool sameMesh(const MeshCache &cache, const Mesh &mesh, bool exact) {
+    const MeshCacheHeader &header = cache.header();
+    if(header.vertexCount != mesh.vertices.size() || header.indexCount != mesh.indices.size())
+        return false;
+    const glm::vec3 *positions = (const glm::vec3 *)cache.attribute(MESH_ATTRIBUTE_POSITION);
+    const glm::vec2 *uvs = (const glm::vec2 *)cache.attribute(MESH_ATTRIBUTE_UV);
+    const glm::vec3 *normals = (const glm::vec3 *)cache.attribute(MESH_ATTRIBUTE_NORMAL);
+    float positionTolerance = exact ? 0.0f : glm::length(glm::vec3(header.boundsMax[0] - header.boundsMin[0], header.boundsMax[1] - header.boundsMin[1],
+                                                                   header.boundsMax[2] - header.boundsMin[2])) / 65535.0f;
+    float tolerance = exact ? 0.0f : 2e-3f;
+    for(size_t i = 0; i < mesh.vertices.size(); i++)
+        if(glm::length(positions[i] - mesh.vertices[i]) > positionTolerance || glm::length(uvs[i] - mesh.uvs[i]) > tolerance
+           || glm::length(normals[i] - mesh.normals[i]) > tolerance)
+            return false;
+    for(size_t i = 0; i < mesh.indices.size(); i++) {
+        unsigned int index = header.indexSize == 2 ? ((const unsigned short *)cache.indexData())[i] : ((const unsigned int *)cache.indexData())[i];
+        if(index != mesh.indices[i])
+            return false;
+    }
+    return true;
+}
+
+static bool checkMeshCache(const std::string &directory, unsigned int iterations) {
+    std::string objPath = directory + "/sphere.obj";
+    std::string cachePath = meshCachePath(objPath.c_str());
+    Mesh mesh;
+    if(!check(writeSphere(objPath) && loadOBJMesh(objPath.c_str(), mesh), "loading the test OBJ", 0))
+        return false;
+
+    const MeshCacheCompression compressions[2] = { MESH_CACHE_RAW, MESH_CACHE_COMPRESSED };
+    std::vector<unsigned char> original, corrupted;
+    for(int c = 0; c < 2; c++) {
+        MeshCache cache;
+        if(!check(writeMeshCache(objPath.c_str(), mesh, compressions[c]), "writing the cache", c)
+           || !check(cache.open(objPath.c_str()), "opening a fresh cache", c)
+           || !check(sameMesh(cache, mesh, compressions[c] == MESH_CACHE_RAW), "cache round trip", c))
+            return false;
+        cache.close();
+
+        // Every corruption must either be rejected or open into streams of the sizes the header gives, with indices in range
+        if(!check(readFile(cachePath, original), "reading the cache back", c))
+            return false;
+        unsigned int accepted = 0;
+        for(unsigned int i = 0; i < iterations; i++) {
+            corrupted = original;
+            if(randomBelow(2) == 0) {
+                // In the header, where the offsets and counts are
+                for(unsigned int bytes = 1 + randomBelow(4); bytes > 0; bytes--)
+                    corrupted[randomBelow(sizeof(MeshCacheHeader))] = (unsigned char)generator();
+            } else {
+                corrupt(corrupted);
+            }
+            if(!writeFile(cachePath, corrupted.data(), corrupted.size()))
+                return false;
+            if(!cache.openFile(cachePath.c_str()))
+                continue;
+            accepted++;
+            const MeshCacheHeader &header = cache.header();
+            volatile unsigned char sink = 0;
+            for(int a = 0; a < MESH_ATTRIBUTE_COUNT; a++) {
+                const unsigned char *stream = (const unsigned char *)cache.attribute((MeshAttributeSemantic)a);
+                for(size_t b = 0; b < cache.attributeSize((MeshAttributeSemantic)a); b++)
+                    sink ^= stream[b];
+            }
+            const unsigned char *indices = (const unsigned char *)cache.indexData();
+            for(size_t b = 0; b < (size_t)header.indexCount * header.indexSize; b++)
+                sink ^= indices[b];
+            for(size_t k = 0; header.indexSize != 0 && k < header.indexCount; k++) {
+                unsigned int index = header.indexSize == 2 ? ((const unsigned short *)indices)[k] : ((const unsigned int *)indices)[k];
+                if(!check(index < header.vertexCount, "indices of an accepted cache in range", i))
+                    return false;
+            }
+            cache.close();
+        }
+        printf("%s cache: round trip ok, %u corruptions opened safely (%u accepted)\n",
+               compressions[c] == MESH_CACHE_RAW ? "raw" : "compressed", iterations, accepted);
+
+        // An index past the last vertex must be rejected, not drawn
+        unsigned int &index = mesh.indices[randomBelow((unsigned int)mesh.indices.size())];
+        unsigned int original = index;
+        index = (unsigned int)mesh.vertices.size() + randomBelow((unsigned int)mesh.vertices.size());
+        bool rejected = writeMeshCache(objPath.c_str(), mesh, compressions[c]) && !cache.open(objPath.c_str());
+        index = original;
+        if(!check(rejected, "cache with an index out of range rejected", c))
+            return false;
+    }
+
+    // A changed source must invalidate the cache, even with the same size and modification time
+    MeshCache cache;
+    writeMeshCache(objPath.c_str(), mesh, MESH_CACHE_RAW);
+    std::vector<unsigned char> source;
+    readFile(objPath, source);
+    source[source.size() / 2] = source[source.size() / 2] == '1' ? '2' : '1';
+    struct stat before;
+    stat(objPath.c_str(), &before);
+    writeFile(objPath, source.data(), source.size());
+#ifdef __APPLE__
+    struct timespec times[2] = { before.st_atimespec, before.st_mtimespec };
+#else
+    struct timespec times[2] = { before.st_atim, before.st_mtim };
+#endif
+    utimensat(AT_FDCWD, objPath.c_str(), times, 0);
+    if(!check(!cache.open(objPath.c_str()), "cache of a changed source rejected", 0))
+        return false;
+
+    // So must a material library that was missing and shows up
+    std::string libraryPath = directory + "/sphere.mtl";
+    const char library[] = "newmtl sphere\nKd 1 0 0\n";
+    if(!check(loadOBJMesh(objPath.c_str(), mesh) && writeMeshCache(objPath.c_str(), mesh, MESH_CACHE_RAW) && cache.open(objPath.c_str()),
+              "opening a cache with a missing material library", 0))
+        return false;
+    cache.close();
+    writeFile(libraryPath, library, sizeof(library) - 1);
+    if(!check(!cache.open(objPath.c_str()), "cache of a material library that appeared rejected", 0))
+        return false;
+    printf("stale caches rejected\n");
+    return true;
+}
+
+int main(int argc, char **argv) {
+    unsigned int seed = 1, iterations = 2000;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else {
+            printf("Usage: codeccheck [--seed N] [--iterations N]\n");
+            return 1;
+        }
+    }
+    generator.seed(seed);
+
+    char directory[] = "/tmp/codeccheck.XXXXXX";
+    if(mkdtemp(directory) == NULL) {
+        printf("Impossible to create a temporary directory\n");
+        return 1;
+    }
+    bool passed = checkVertexStreams(iterations) && checkIndexStreams(iterations) && checkMeshCache(directory, iterations);
+    std::string objPath = std::string(directory) + "/sphere.obj";
+    remove(meshCachePath(objPath.c_str()).c_str());
+    remove(objPath.c_str());
+    remove((std::string(directory) + "/sphere.mtl").c_str());
+    rmdir(directory);
+    printf(passed ? "All checks passed (seed %u)\n" : "Checks failed (seed %u)\n", seed);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <algorithm>
+
+#include "assetloader.hpp"
+
+AssetLoader::AssetLoader(unsigned int threadCount) : mStopping(false), mFinished(NULL), mPending(0) {
+	if( threadCount == 0 ){
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+	for( unsigned int i = 0; i < threadCount; i++ )
+		mWorkers.push_back(std::thread(&AssetLoader::work, this));
+}
+
+AssetLoader::~AssetLoader() {
+	shutdown();
+
+	// Whatever is still waiting for an upload is dropped : there may be no GL context anymore
+	uploadFinished(-1.0);
+	for( size_t i = 0; i < mReadyToUpload.size(); i++ ){
+		mReadyToUpload[i]->done.set_value(false);
+		delete mReadyToUpload[i];
+	}
+}
+
+std::future<bool> AssetLoader::submit(std::function<bool()> load, std::function<void(bool)> upload) {
+	Request * request = new Request();
+	request->load = load;
+	request->upload = upload;
+	request->loaded = false;
+	request->next = NULL;
+	std::future<bool> future = request->done.get_future();
+
+	mPending++;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if( !mStopping ){
+			mQueued.push_back(request);
+			request = NULL;
+		}
+	}
+	if( request != NULL ){
+		// Already shut down
+		request->done.set_value(false);
+		delete request;
+		mPending--;
+	}else{
+		mWakeUp.notify_one();
+	}
+	return future;
+}
+
+void AssetLoader::work() {
+	for( ;; ){
+		Request * request;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWakeUp.wait(lock, [this](){ return mStopping || !mQueued.empty(); });
+			if( mStopping )
+				return;
+			request = mQueued.front();
+			mQueued.pop_front();
+		}
+		request->loaded = request->load();
+		pushFinished(request);
+	}
+}
+
+void AssetLoader::pushFinished(Request * request) {
+	// Treiber stack push. The consumer always takes the whole stack at once, so there is no ABA problem.
+	Request * head = mFinished.load(std::memory_order_relaxed);
+	do {
+		request->next = head;
+	} while( !mFinished.compare_exchange_weak(head, request, std::memory_order_release, std::memory_order_relaxed) );
+}
+
+int AssetLoader::uploadFinished(double budgetMilliseconds) {
+	// Take everything the workers finished since last time. The stack is newest first, reverse it to upload in completion order.
+	Request * finished = mFinished.exchange(NULL, std::memory_order_acquire);
+	Request * oldestFirst = NULL;
+	while( finished != NULL ){
+		Request * next = finished->next;
+		finished->next = oldestFirst;
+		oldestFirst = finished;
+		finished = next;
+	}
+	for( ; oldestFirst != NULL; oldestFirst = oldestFirst->next )
+		mReadyToUpload.push_back(oldestFirst);
+
+	// A negative budget only collects, it doesn't upload anything
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int uploaded = 0;
+	while( budgetMilliseconds >= 0.0 && !mReadyToUpload.empty() ){
+		if( uploaded > 0 && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMilliseconds )
+			break;
+		Request * request = mReadyToUpload.front();
+		mReadyToUpload.pop_front();
+		request->upload(request->loaded);
+		request->done.set_value(request->loaded);
+		delete request;
+		mPending--;
+		uploaded++;
+	}
+	return uploaded;
+}
+
+void AssetLoader::shutdown() {
+	std::deque<Request *> dropped;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if( mStopping )
+			return;
+		mStopping = true;
+		dropped.swap(mQueued);
+	}
+	mWakeUp.notify_all();
+	for( size_t i = 0; i < mWorkers.size(); i++ )
+		mWorkers[i].join();
+	mWorkers.clear();
+
+	for( size_t i = 0; i < dropped.size(); i++ ){
+		dropped[i]->done.set_value(false);
+		delete dropped[i];
+		mPending--;
+	}
+}
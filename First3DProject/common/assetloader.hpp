@@ -0,0 +1,65 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <functional>
+
+// Loads assets on a pool of worker threads while the render thread keeps drawing.
+//
+// Each request is split in two : a load function that runs on a worker (file I/O, parsing, anything CPU-only)
+// and an upload function that runs on the GL thread afterwards. Finished requests come back through a lock-free
+// queue that the GL thread drains in uploadFinished(), spending at most a given time per frame on uploads.
+class AssetLoader {
+public:
+	// threadCount 0 uses every core but the one running the render loop.
+	explicit AssetLoader(unsigned int threadCount = 0);
+	~AssetLoader();
+
+	// Queues a request. The future becomes true once upload has run on the GL thread, false if load failed
+	// (upload is then called with false so the caller can clean up). Never wait on it from the GL thread :
+	// it's the GL thread that completes it, in uploadFinished().
+	std::future<bool> submit(std::function<bool()> load, std::function<void(bool loaded)> upload);
+
+	// GL thread : runs the upload functions of finished requests until budgetMilliseconds are spent.
+	// At least one upload runs per call, so a slow asset can't stall the queue. Returns how many ran.
+	int uploadFinished(double budgetMilliseconds);
+
+	// Requests that were submitted and haven't been uploaded yet.
+	int pendingCount() const { return mPending; }
+
+	// Stops the workers. Requests that haven't started are dropped and their futures become false.
+	void shutdown();
+
+private:
+	AssetLoader(const AssetLoader &);
+	AssetLoader & operator=(const AssetLoader &);
+
+	struct Request {
+		std::function<bool()> load;
+		std::function<void(bool)> upload;
+		std::promise<bool> done;
+		bool loaded;
+		Request * next; // link in the finished queue
+	};
+
+	void work();
+	void pushFinished(Request * request);
+
+	std::vector<std::thread> mWorkers;
+	std::deque<Request *> mQueued;         // waiting for a worker, guarded by mMutex
+	std::mutex mMutex;
+	std::condition_variable mWakeUp;
+	bool mStopping;
+
+	std::atomic<Request *> mFinished;      // lock-free stack pushed by the workers
+	std::deque<Request *> mReadyToUpload;  // GL thread only : finished requests in completion order
+	std::atomic<int> mPending;
+};
+
+#endif
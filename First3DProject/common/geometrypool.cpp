@@ -0,0 +1,181 @@
+#include <string.h>
+#include <algorithm>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "geometrypool.hpp"
+#include "vertexformat.hpp"
+#include "uniformring.hpp"
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand is read by GL as is");
+static_assert(sizeof(PoolDrawData) == 160, "PoolDrawData is read by the shader as is, std430");
+
+// Location of the draw index attribute, past the instance attributes of vertexformat.hpp
+#define POOL_DRAW_INDEX_LOCATION 8
+
+GeometryPool::GeometryPool() :
+	mVertexArray(0), mVertexBuffer(0), mIndexBuffer(0), mDrawIndexBuffer(0),
+	mVertexCapacity(0), mVertexCount(0), mIndexCapacity(0), mIndexCount(0), mDrawIndexCapacity(0),
+	mRing(NULL), mCommands(NULL), mDrawData(NULL), mCommandOffset(0), mDrawDataOffset(0), mDrawCount(0), mDrawCapacity(0) {
+}
+
+GeometryPool::~GeometryPool() {
+	destroy();
+}
+
+bool GeometryPool::create(const VertexEncoding & encoding, size_t vertexCapacity, size_t indexCapacity) {
+	if( !GLEW_VERSION_4_3 )
+		return false;
+	destroy();
+	mEncoding = encoding;
+	mVertexCapacity = vertexCapacity;
+	mIndexCapacity = indexCapacity;
+
+	glGenVertexArrays(1, &mVertexArray);
+	glBindVertexArray(mVertexArray);
+
+	glGenBuffers(1, &mIndexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &mVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * vertexSize(encoding), NULL, GL_STATIC_DRAW);
+	vertexAttributeSetup(encoding).specifyInterleaved(mVertexBuffer);
+
+	// Filled in submit(), as many as there are draws
+	glGenBuffers(1, &mDrawIndexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mDrawIndexBuffer);
+	glEnableVertexAttribArray(POOL_DRAW_INDEX_LOCATION);
+	glVertexAttribIPointer(POOL_DRAW_INDEX_LOCATION, 1, GL_UNSIGNED_INT, 0, (void*)0);
+	glVertexAttribDivisor(POOL_DRAW_INDEX_LOCATION, 1);
+
+	glBindVertexArray(0);
+
+	return true;
+}
+
+void GeometryPool::destroy() {
+	if( mVertexArray == 0 )
+		return;
+	GLuint buffers[3] = { mVertexBuffer, mIndexBuffer, mDrawIndexBuffer };
+	glDeleteBuffers(3, buffers);
+	glDeleteVertexArrays(1, &mVertexArray);
+	mVertexArray = mVertexBuffer = mIndexBuffer = mDrawIndexBuffer = 0;
+	mVertexCount = mIndexCount = mDrawIndexCapacity = 0;
+	mRing = NULL;
+	mDrawCount = mDrawCapacity = 0;
+}
+
+bool GeometryPool::add(const glm::vec3 * positions, const glm::vec2 * uvs, const glm::vec3 * normals, size_t count,
+                       const void * indices, size_t indexSize, size_t indexCount, PoolMesh & out_mesh) {
+	if( !isCreated() || indexCount == 0 || mVertexCount + count > mVertexCapacity || mIndexCount + indexCount > mIndexCapacity )
+		return false;
+
+	PackedVertices packed;
+	packVertices(mEncoding, positions, uvs, normals, count, packed);
+	std::vector<unsigned char> vertices;
+	interleaveVertices(mEncoding, packed, count, vertices);
+
+	// Indices stay relative to the mesh : baseVertex moves them to its range
+	std::vector<unsigned int> wideIndices(indexCount);
+	if( indexSize == sizeof(unsigned short) ){
+		const unsigned short * shortIndices = (const unsigned short *)indices;
+		for( size_t i = 0; i < indexCount; i++ )
+			wideIndices[i] = shortIndices[i];
+	}else{
+		memcpy(wideIndices.data(), indices, indexCount * sizeof(unsigned int));
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, mVertexCount * vertexSize(mEncoding), vertices.size(), vertices.data());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, mIndexCount * sizeof(unsigned int), indexCount * sizeof(unsigned int), wideIndices.data());
+
+	out_mesh.baseVertex = (GLint)mVertexCount;
+	out_mesh.firstIndex = (GLuint)mIndexCount;
+	out_mesh.indexCount = (GLuint)indexCount;
+	out_mesh.positionScale = packed.positionScale;
+	out_mesh.positionOffset = packed.positionOffset;
+	out_mesh.normalScale = packed.normalScale;
+	mVertexCount += count;
+	mIndexCount += indexCount;
+	return true;
+}
+
+size_t GeometryPool::usedBytes() const {
+	return mVertexCount * vertexSize(mEncoding) + mIndexCount * sizeof(unsigned int);
+}
+
+size_t GeometryPool::capacityBytes() const {
+	return mVertexCapacity * vertexSize(mEncoding) + mIndexCapacity * sizeof(unsigned int);
+}
+
+const char * GeometryPool::drawIDDeclaration() const {
+	if( GLEW_ARB_shader_draw_parameters )
+		return "#extension GL_ARB_shader_draw_parameters : require\n#define DRAW_ID gl_DrawIDARB\n";
+	return "layout(location = 8) in uint drawIndex;\n#define DRAW_ID int(drawIndex)\n";
+}
+
+bool GeometryPool::beginDraws(UniformRing & ring, size_t maxDraws) {
+	mRing = NULL;
+	mDrawCount = mDrawCapacity = 0;
+	if( !isCreated() || maxDraws == 0 )
+		return false;
+	mCommands = (DrawElementsIndirectCommand *)ring.allocate(maxDraws * sizeof(DrawElementsIndirectCommand), mCommandOffset);
+	mDrawData = mCommands == NULL ? NULL : (PoolDrawData *)ring.allocate(maxDraws * sizeof(PoolDrawData), mDrawDataOffset);
+	if( mDrawData == NULL )
+		return false;
+	mRing = &ring;
+	mDrawCapacity = maxDraws;
+	return true;
+}
+
+bool GeometryPool::addDraw(const PoolMesh & mesh, GLuint first, GLuint count, const glm::mat4 & model, const glm::vec3 & color) {
+	if( mDrawCount == mDrawCapacity )
+		return false;
+	// Written once, in order : the ring may be write-combined memory
+	DrawElementsIndirectCommand & command = mCommands[mDrawCount];
+	command.count = count;
+	command.instanceCount = 1;
+	command.firstIndex = mesh.firstIndex + first;
+	command.baseVertex = mesh.baseVertex;
+	command.baseInstance = (GLuint)mDrawCount;
+
+	PoolDrawData & data = mDrawData[mDrawCount];
+	data.model = model;
+	glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(model));
+	for( int c = 0; c < 3; c++ )
+		data.normalMatrix[c] = glm::vec4(normalMatrix[c], 0.0f);
+	data.color = glm::vec4(color, 1.0f);
+	data.positionScale = glm::vec4(mesh.positionScale, mesh.normalScale);
+	data.positionOffset = glm::vec4(mesh.positionOffset, 0.0f);
+	mDrawCount++;
+	return true;
+}
+
+void GeometryPool::submit() {
+	if( mDrawCount == 0 )
+		return;
+
+	if( mDrawCount > mDrawIndexCapacity ){
+		mDrawIndexCapacity = std::max(mDrawCount, mDrawIndexCapacity * 2);
+		std::vector<GLuint> drawIndices(mDrawIndexCapacity);
+		for( size_t i = 0; i < drawIndices.size(); i++ )
+			drawIndices[i] = (GLuint)i;
+		glBindBuffer(GL_ARRAY_BUFFER, mDrawIndexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, drawIndices.size() * sizeof(GLuint), drawIndices.data(), GL_STATIC_DRAW);
+	}
+
+	// Both live in the ring's region for this frame, fenced with the rest of it
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mRing->buffer());
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, mRing->buffer(), mDrawDataOffset, mDrawCount * sizeof(PoolDrawData));
+
+	glBindVertexArray(mVertexArray);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)mCommandOffset, (GLsizei)mDrawCount, 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	mRing = NULL;
+	mDrawCount = mDrawCapacity = 0;
+}
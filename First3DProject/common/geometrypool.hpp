@@ -0,0 +1,106 @@
+#ifndef GEOMETRYPOOL_HPP
+#define GEOMETRYPOOL_HPP
+
+#include <vector>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "vertexpacking.hpp"
+
+class UniformRing;
+
+// Static meshes suballocated into one shared vertex buffer and one index buffer, drawn together.
+//
+// Every mesh gets a range of both buffers; its indices stay relative to its first vertex (baseVertex).
+// A frame's draws are recorded as DrawElementsIndirectCommand records plus one PoolDrawData each, written straight into
+// the frame's region of a UniformRing (so nothing is reallocated per frame, and the ring's fences cover them too),
+// and submitted with a single glMultiDrawElementsIndirect : the vertex shader finds its draw's data with the draw index,
+// gl_DrawIDARB where GL_ARB_shader_draw_parameters is there, else an instanced attribute fed by baseInstance.
+// Needs GL 4.3 (indirect multi-draw and shader storage buffers); without it, create() fails and meshes keep their own buffers.
+
+// Where a mesh went in the pool, and how its vertices decode.
+struct PoolMesh {
+	GLint baseVertex;
+	GLuint firstIndex;
+	GLuint indexCount;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	float normalScale;
+};
+
+// As glMultiDrawElementsIndirect reads it.
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance; // the draw index, for the attribute fallback
+};
+
+// One draw's uniforms, laid out std430 for the "Draws" shader storage block of shader/PooledShading.vertexshader.
+struct PoolDrawData {
+	glm::mat4 model;
+	glm::vec4 normalMatrix[3]; // inverse transpose of model's upper 3x3, one column per vec4
+	glm::vec4 color;
+	glm::vec4 positionScale;  // w : normal scale
+	glm::vec4 positionOffset;
+};
+
+class GeometryPool {
+public:
+	GeometryPool();
+	~GeometryPool();
+
+	// Allocates room for vertexCapacity vertices of encoding and indexCapacity 32-bit indices.
+	bool create(const VertexEncoding & encoding, size_t vertexCapacity, size_t indexCapacity);
+	void destroy();
+	bool isCreated() const { return mVertexArray != 0; }
+
+	// Packs count vertices with the pool's encoding and copies them and the indices (of indexSize bytes, 2 or 4) in.
+	// Fails, copying nothing, when the pool is full.
+	bool add(const glm::vec3 * positions, const glm::vec2 * uvs, const glm::vec3 * normals, size_t count,
+	         const void * indices, size_t indexSize, size_t indexCount, PoolMesh & out_mesh);
+
+	// What the pooled vertex shader needs above its inputs to get the draw index, as DRAW_ID.
+	const char * drawIDDeclaration() const;
+
+	// Of the vertex and index buffers.
+	size_t usedBytes() const;
+	size_t capacityBytes() const;
+
+	// Makes room in the current frame of ring for up to maxDraws draws, between its beginFrame and its flush.
+	// Fails if ring has no room left; then addDraw records nothing.
+	bool beginDraws(UniformRing & ring, size_t maxDraws);
+
+	// Records count indices of mesh from first on (relative to the mesh), drawn with model and color.
+	// Returns false, recording nothing, past the maxDraws of beginDraws.
+	bool addDraw(const PoolMesh & mesh, GLuint first, GLuint count, const glm::mat4 & model, const glm::vec3 & color);
+	size_t drawCount() const { return mDrawCount; }
+
+	// Draws the recorded draws with one call, with the pooled program in use and ring flushed; then forgets them.
+	void submit();
+
+private:
+	GeometryPool(const GeometryPool &);
+	GeometryPool & operator=(const GeometryPool &);
+
+	VertexEncoding mEncoding;
+	GLuint mVertexArray;
+	GLuint mVertexBuffer;
+	GLuint mIndexBuffer;
+	GLuint mDrawIndexBuffer;   // 0, 1, 2... read once per instance, at baseInstance
+	size_t mVertexCapacity, mVertexCount;
+	size_t mIndexCapacity, mIndexCount;
+	size_t mDrawIndexCapacity;
+
+	// This frame's draws, in the ring
+	UniformRing * mRing;
+	DrawElementsIndirectCommand * mCommands;
+	PoolDrawData * mDrawData;
+	GLintptr mCommandOffset, mDrawDataOffset;
+	size_t mDrawCount, mDrawCapacity;
+};
+
+#endif
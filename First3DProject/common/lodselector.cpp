@@ -0,0 +1,58 @@
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "lodselector.hpp"
+
+// A coarser level is only taken once its error is this much under the threshold, and kept until it goes over :
+// objects sitting right at a switching distance don't flicker between two levels.
+static const float hysteresis = 0.75f;
+
+LodSelector::LodSelector(float pixelError, unsigned int triangleBudget)
+	: mBasePixelError(pixelError), mPixelError(pixelError), mTriangleBudget(triangleBudget) {
+	mStats = LodStats();
+	mStats.pixelError = pixelError;
+}
+
+void LodSelector::select(std::vector<LodRequest> & requests, const glm::mat4 & projection, int viewportHeight, const glm::vec3 & camera) {
+	// A length l at distance d covers l / d * pixelsPerRadian pixels : projection[1][1] is cot(fov / 2)
+	float pixelsPerRadian = projection[1][1] * viewportHeight * 0.5f;
+
+	mStats = LodStats();
+	mStats.pixelError = mPixelError;
+	for( size_t i = 0; i < requests.size(); i++ ){
+		LodRequest & request = requests[i];
+		int levelCount = request.lods ? (int)request.lods->size() : 0;
+		int previous = std::min(request.level, levelCount);
+
+		int level = 0;
+		float distance = glm::length(request.center - camera) - request.radius;
+		if( distance > 0.0f && levelCount > 0 ){
+			float pixelsPerUnit = pixelsPerRadian * request.errorScale / distance;
+			for( int l = levelCount; l > 0; l-- ){
+				float pixels = (*request.lods)[l - 1].error * pixelsPerUnit;
+				float threshold = l > previous ? mPixelError * hysteresis : mPixelError;
+				if( pixels <= threshold ){
+					level = l;
+					break;
+				}
+			}
+		}
+
+		if( level != previous )
+			mStats.switches++;
+		request.level = level;
+		mStats.objects++;
+		mStats.fullTriangles += request.triangles[0];
+		mStats.drawnTriangles += request.triangles[level];
+	}
+
+	// Budget feedback for the next frame
+	if( mTriangleBudget > 0 ){
+		if( mStats.drawnTriangles > mTriangleBudget )
+			mPixelError = std::min(mPixelError * 1.25f, mBasePixelError * 64.0f);
+		else if( mStats.drawnTriangles < mTriangleBudget * 0.8f )
+			mPixelError = std::max(mPixelError / 1.25f, mBasePixelError);
+	}
+}
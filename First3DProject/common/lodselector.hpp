@@ -0,0 +1,49 @@
+#ifndef LODSELECTOR_HPP
+#define LODSELECTOR_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// Per-frame level of detail selection : every object gets the coarsest level whose simplification error,
+// projected on screen, stays under a pixel threshold.
+
+// What the selector needs to know about one object, and its answer.
+struct LodRequest {
+	glm::vec3 center;                 // bounding sphere, in world space
+	float radius;
+	float errorScale;                 // largest scale of the model matrix, to bring the lods' errors to world units
+	const std::vector<MeshLod> * lods;
+	const unsigned int * triangles;   // triangle count of the full mesh, then of every lod
+	int level;                        // the level drawn last frame when selecting, the level to draw afterwards
+};
+
+struct LodStats {
+	unsigned int objects;
+	unsigned int fullTriangles;       // what drawing everything at full detail would cost
+	unsigned int drawnTriangles;
+	unsigned int switches;            // objects whose level changed this frame
+	float pixelError;                 // the threshold used this frame
+};
+
+class LodSelector {
+public:
+	// triangleBudget, when not 0, raises the pixel threshold while the frame draws more triangles than that,
+	// and lowers it back towards pixelError when there is room : the triangle count stays flat as the camera moves.
+	LodSelector(float pixelError = 1.0f, unsigned int triangleBudget = 0);
+
+	// Selects the level of all requests in one pass. projection is the camera's, viewportHeight in pixels.
+	void select(std::vector<LodRequest> & requests, const glm::mat4 & projection, int viewportHeight, const glm::vec3 & camera);
+
+	const LodStats & stats() const { return mStats; }
+
+private:
+	float mBasePixelError;
+	float mPixelError;
+	unsigned int mTriangleBudget;
+	LodStats mStats;
+};
+
+#endif
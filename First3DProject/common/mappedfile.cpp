@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mappedfile.hpp"
+
+// An empty file can't be mmap'ed, so it is represented by a non-NULL pointer to this byte and a size of 0.
+static const char emptyFile = 0;
+
+MappedFile::MappedFile() : mData(NULL), mSize(0) {
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const char * path) {
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if( fd < 0 ){
+		printf("Impossible to open %s for mapping\n", path);
+		return false;
+	}
+
+	struct stat info;
+	if( fstat(fd, &info) != 0 ){
+		printf("Impossible to stat %s\n", path);
+		::close(fd);
+		return false;
+	}
+
+	if( info.st_size == 0 ){
+		::close(fd);
+		mData = &emptyFile;
+		mSize = 0;
+		return true;
+	}
+
+	void * mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps its own reference to the file
+	if( mapping == MAP_FAILED ){
+		printf("Impossible to map %s\n", path);
+		return false;
+	}
+
+	// We read front to back exactly once, let the kernel read ahead aggressively.
+	madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	mData = (const char *)mapping;
+	mSize = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::close() {
+	if( mData != NULL && mData != &emptyFile )
+		munmap((void *)mData, mSize);
+	mData = NULL;
+	mSize = 0;
+}
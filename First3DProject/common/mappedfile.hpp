@@ -0,0 +1,28 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file.
+// The bytes stay valid until close() is called or the object is destroyed.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const char * path);
+	void close();
+
+	const char * data() const { return mData; }
+	size_t size() const { return mSize; }
+	bool isOpen() const { return mData != NULL; }
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	const char * mData;
+	size_t mSize;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <vector>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "mtlloader.hpp"
+
+// Material of the faces an OBJ file declares before its first usemtl : drawn with the object's own color.
+#define MESH_NO_MATERIAL 0xFFFFFFFFu
+
+// A range of the index buffer whose triangles all share one material.
+struct MeshPart {
+	unsigned int material;   // into Mesh::materials, or MESH_NO_MATERIAL
+	unsigned int firstIndex;
+	unsigned int indexCount;
+};
+
+// A named piece of a mesh (an OBJ "o" or "g" group) : a contiguous range of parts, and bounds to cull it with.
+struct MeshGroup {
+	std::string name;        // "" for the faces before the first o or g
+	unsigned int firstPart;  // into Mesh::parts
+	unsigned int partCount;
+	unsigned int firstIndex; // the index range all its parts cover
+	unsigned int indexCount;
+	glm::vec3 boundsMin;     // axis aligned box of the vertices the group uses
+	glm::vec3 boundsMax;
+	glm::vec3 center;        // bounding sphere, around the box
+	float radius;
+};
+
+// A small cluster of triangles of one part (about 64 vertices, 124 triangles) that can be culled on its own.
+struct Meshlet {
+	unsigned int part;        // into Mesh::parts
+	unsigned int firstIndex;  // a range inside the part
+	unsigned int indexCount;
+	glm::vec3 center;         // bounding sphere
+	float radius;
+	glm::vec3 coneAxis;       // every triangle faces away from the camera when
+	float coneCutoff;         // dot(center - camera, coneAxis) >= coneCutoff * |center - camera| + radius
+};
+
+// A simplified version of a mesh, drawn with the same vertices : parts[i] covers the same material and group as Mesh::parts[i].
+struct MeshLod {
+	float ratio;                  // of the full mesh's triangles that was asked for
+	float error;                  // largest distance the surface moved, in model units
+	std::vector<MeshPart> parts;  // ranges of Mesh::indices, after the full mesh's
+};
+
+// An indexed triangle mesh and its materials, as loadOBJMesh builds it.
+struct Mesh {
+	std::vector<unsigned int> indices;  // 3 per triangle, empty for a plain triangle list ; the lods' indices follow the full mesh's
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec4> tangents;    // empty unless computeTangents ran : xyz the tangent, w the bitangent's sign ; not cached
+
+	std::vector<Material> materials;
+	std::vector<MeshPart> parts;        // one per material of each group, in material order; together they cover all indices
+	std::vector<MeshGroup> groups;      // in order of first appearance
+	std::vector<MeshLod> lods;          // coarser and coarser, see generateMeshLods
+	std::vector<Meshlet> meshlets;      // of the full mesh, in part order, see buildMeshlets
+	std::vector<std::string> materialLibraries; // paths of the MTL files the OBJ references, including missing ones
+};
+
+#endif
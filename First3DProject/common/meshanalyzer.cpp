@@ -0,0 +1,135 @@
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "meshanalyzer.hpp"
+
+// Numbers of the vertices whose first size bytes of records (one per vertex, stride bytes apart) match an earlier one.
+static size_t countDuplicates(const unsigned char * records, size_t count, size_t stride, size_t size) {
+	std::vector<unsigned int> order(count);
+	for( size_t i = 0; i < count; i++ )
+		order[i] = (unsigned int)i;
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+		return memcmp(records + a * stride, records + b * stride, size) < 0;
+	});
+	size_t duplicates = 0;
+	for( size_t i = 1; i < count; i++ )
+		if( memcmp(records + order[i - 1] * stride, records + order[i] * stride, size) == 0 )
+			duplicates++;
+	return duplicates;
+}
+
+VertexDuplicateStats analyzeVertexDuplicates(const Mesh & mesh, size_t indexCount) {
+	// Position first, so the same records sort for both counts
+	size_t count = mesh.vertices.size();
+	std::vector<float> records(count * 8, 0.0f);
+	for( size_t i = 0; i < count; i++ ){
+		memcpy(&records[i * 8], &mesh.vertices[i][0], 3 * sizeof(float));
+		if( i < mesh.uvs.size() )
+			memcpy(&records[i * 8 + 3], &mesh.uvs[i][0], 2 * sizeof(float));
+		if( i < mesh.normals.size() )
+			memcpy(&records[i * 8 + 5], &mesh.normals[i][0], 3 * sizeof(float));
+	}
+	VertexDuplicateStats stats;
+	stats.duplicates = countDuplicates((const unsigned char *)records.data(), count, 8 * sizeof(float), 8 * sizeof(float));
+	stats.sharedPositions = countDuplicates((const unsigned char *)records.data(), count, 8 * sizeof(float), 3 * sizeof(float));
+
+	std::vector<char> used(count, 0);
+	if( mesh.indices.empty() )
+		std::fill(used.begin(), used.end(), 1);
+	for( size_t i = 0; i < indexCount && i < mesh.indices.size(); i++ )
+		if( mesh.indices[i] < count )
+			used[mesh.indices[i]] = 1;
+	stats.unused = (size_t)std::count(used.begin(), used.end(), 0);
+	return stats;
+}
+
+// Edge function of a to b at p : positive on the left of the edge, so inside a counter-clockwise triangle.
+static float edge(const glm::vec2 & a, const glm::vec2 & b, const glm::vec2 & p) {
+	return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// Top-left fill rule : a pixel center exactly on an edge shared by two triangles is drawn by only one of them.
+// For a counter-clockwise triangle with y up, that's the left edges (going down) and the top edges (going left).
+static bool isTopLeft(const glm::vec2 & a, const glm::vec2 & b) {
+	return b.y < a.y || (b.y == a.y && b.x < a.x);
+}
+
+OverdrawStats analyzeOverdraw(const unsigned int * indices, size_t indexCount, const glm::vec3 * vertices, size_t vertexCount, unsigned int viewCount, unsigned int resolution) {
+	OverdrawStats stats = { 0.0f, 0, 0 };
+	if( vertexCount == 0 || indexCount < 3 || viewCount == 0 || resolution == 0 )
+		return stats;
+
+	glm::vec3 boundsMin = vertices[0], boundsMax = vertices[0];
+	for( size_t i = 1; i < vertexCount; i++ ){
+		boundsMin = glm::min(boundsMin, vertices[i]);
+		boundsMax = glm::max(boundsMax, vertices[i]);
+	}
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+	if( radius <= 0.0f )
+		return stats;
+	float scale = resolution / (2.0f * radius);
+
+	std::vector<float> depth((size_t)resolution * resolution);
+	std::vector<glm::vec3> projected(vertexCount);
+	const float infinity = std::numeric_limits<float>::infinity();
+	for( unsigned int view = 0; view < viewCount; view++ ){
+		// Fibonacci sphere : viewCount directions at about the same distance from each other
+		float z = 1.0f - (2.0f * view + 1.0f) / viewCount;
+		float ring = sqrtf(std::max(0.0f, 1.0f - z * z));
+		float angle = view * 2.39996323f; // golden angle
+		glm::vec3 back(ring * cosf(angle), ring * sinf(angle), z); // from the mesh to the camera
+		glm::vec3 up = fabsf(back.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 right = glm::normalize(glm::cross(up, back));
+		up = glm::cross(back, right);
+
+		// Pixel coordinates, and the distance from the camera
+		for( size_t i = 0; i < vertexCount; i++ ){
+			glm::vec3 p = vertices[i] - center;
+			projected[i] = glm::vec3((glm::dot(p, right) + radius) * scale, (glm::dot(p, up) + radius) * scale, -glm::dot(p, back));
+		}
+		std::fill(depth.begin(), depth.end(), infinity);
+
+		for( size_t t = 0; t + 3 <= indexCount; t += 3 ){
+			if( indices[t] >= vertexCount || indices[t + 1] >= vertexCount || indices[t + 2] >= vertexCount )
+				continue;
+			const glm::vec3 & a = projected[indices[t]];
+			const glm::vec3 & b = projected[indices[t + 1]];
+			const glm::vec3 & c = projected[indices[t + 2]];
+			glm::vec2 a2(a), b2(b), c2(c);
+			float area = edge(a2, b2, c2);
+			if( area <= 0.0f )
+				continue; // back facing, or degenerate
+
+			int x0 = std::max(0, (int)floorf(std::min(a.x, std::min(b.x, c.x))));
+			int y0 = std::max(0, (int)floorf(std::min(a.y, std::min(b.y, c.y))));
+			int x1 = std::min((int)resolution - 1, (int)ceilf(std::max(a.x, std::max(b.x, c.x))));
+			int y1 = std::min((int)resolution - 1, (int)ceilf(std::max(a.y, std::max(b.y, c.y))));
+			bool topLeftA = isTopLeft(b2, c2), topLeftB = isTopLeft(c2, a2), topLeftC = isTopLeft(a2, b2);
+			for( int y = y0; y <= y1; y++ ){
+				for( int x = x0; x <= x1; x++ ){
+					glm::vec2 p(x + 0.5f, y + 0.5f);
+					float wa = edge(b2, c2, p), wb = edge(c2, a2, p), wc = edge(a2, b2, p);
+					if( wa < 0.0f || wb < 0.0f || wc < 0.0f
+						|| (wa == 0.0f && !topLeftA) || (wb == 0.0f && !topLeftB) || (wc == 0.0f && !topLeftC) )
+						continue;
+					float d = (wa * a.z + wb * b.z + wc * c.z) / area;
+					float & stored = depth[(size_t)y * resolution + x];
+					if( d >= stored )
+						continue;
+					if( stored == infinity )
+						stats.covered++;
+					stats.shaded++;
+					stored = d;
+				}
+			}
+		}
+	}
+	stats.overdraw = stats.covered > 0 ? (float)((double)stats.shaded / stats.covered) : 0.0f;
+	return stats;
+}
@@ -0,0 +1,39 @@
+#ifndef MESHANALYZER_HPP
+#define MESHANALYZER_HPP
+
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// Offline measurements of how well a mesh will render, for the analyzer tool.
+// See also analyzeVertexCache in meshoptimizer.hpp.
+
+struct VertexDuplicateStats {
+	size_t duplicates;      // vertices with the same position, UV and normal bits as an earlier one
+	size_t sharedPositions; // vertices with the same position as an earlier one : seams, or duplicates
+	size_t unused;          // vertices no index refers to
+};
+
+// Exact, bitwise comparison : two vertices that only differ by rounding are not duplicates.
+// Only the first indexCount indices of the mesh count as uses : those of the full mesh, not of its levels of detail.
+VertexDuplicateStats analyzeVertexDuplicates(const Mesh & mesh, size_t indexCount);
+
+struct OverdrawStats {
+	float overdraw;                // fragments shaded per covered pixel : 1 at best
+	unsigned long long covered;    // pixels covered, over all the views
+	unsigned long long shaded;     // fragments that passed the depth test, over all the views
+};
+
+// Rasterizes the triangles in index order, like the GPU would : counter-clockwise front faces, back faces culled,
+// and a less-than depth test. Triangles that pass it over triangles drawn earlier are shaded again.
+// The views are orthographic, resolution pixels square, fitted to the bounding sphere and looking at it from
+// viewCount directions spread evenly around it.
+OverdrawStats analyzeOverdraw(
+	const unsigned int * indices, size_t indexCount,
+	const glm::vec3 * vertices, size_t vertexCount,
+	unsigned int viewCount = 8, unsigned int resolution = 256
+);
+
+#endif
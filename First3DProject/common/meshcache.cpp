@@ -0,0 +1,615 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <glm/glm.hpp>
+
+#include "meshcache.hpp"
+#include "meshcodec.hpp"
+#include "vertexpacking.hpp"
+
+static_assert(sizeof(MeshAttributeLayout) == 32, "MeshAttributeLayout is written to disk as is");
+static_assert(sizeof(MeshCacheHeader) == 296, "MeshCacheHeader is written to disk as is");
+static_assert(sizeof(MeshCacheMaterial) == 60, "MeshCacheMaterial is written to disk as is");
+static_assert(sizeof(MeshCacheDependency) == 32, "MeshCacheDependency is written to disk as is");
+static_assert(sizeof(MeshCacheGroup) == 64, "MeshCacheGroup is written to disk as is");
+static_assert(sizeof(MeshCacheLod) == 8, "MeshCacheLod is written to disk as is");
+static_assert(sizeof(MeshPart) == 12, "MeshPart is written to disk as is");
+static_assert(sizeof(Meshlet) == 44, "Meshlet is written to disk as is");
+
+static const uint64_t streamAlignment = 16;
+
+// What the attribute streams hold : floats in a raw cache, the quantized encoding that gets coded in a compressed one.
+struct StreamFormat {
+	uint32_t componentType;
+	uint32_t components;
+	uint32_t stride;
+};
+
+static const StreamFormat streamFormats[2][MESH_ATTRIBUTE_COUNT] = {
+	{ { MESH_COMPONENT_FLOAT, 3, 12 }, { MESH_COMPONENT_FLOAT, 2, 8 }, { MESH_COMPONENT_FLOAT, 3, 12 } },
+	{ { MESH_COMPONENT_UNSIGNED_SHORT, 4, 8 }, { MESH_COMPONENT_HALF_FLOAT, 2, 4 }, { MESH_COMPONENT_SHORT, 2, 4 } }
+};
+
+// Fewest bytes meshcodec codes count vertices of stride bytes in : a header per group of 16, every plane 0 bits wide.
+// Keeps a forged vertex count from making decode() allocate more than the file could possibly hold.
+static uint64_t minimumVertexStreamSize(uint64_t count, uint32_t stride) {
+	return (count + 15) / 16 * (stride / 4);
+}
+
+// True if every one of count indices of indexSize bytes addresses one of vertexCount vertices.
+static bool indicesInRange(const void * indices, uint32_t indexSize, uint32_t count, uint32_t vertexCount) {
+	if( indexSize == 2 ){
+		const uint16_t * shortIndices = (const uint16_t *)indices;
+		for( uint32_t i = 0; i < count; i++ )
+			if( shortIndices[i] >= vertexCount )
+				return false;
+	} else if( indexSize == 4 ){
+		const uint32_t * wideIndices = (const uint32_t *)indices;
+		for( uint32_t i = 0; i < count; i++ )
+			if( wideIndices[i] >= vertexCount )
+				return false;
+	}
+	return true;
+}
+
+static VertexEncoding compressedEncoding() {
+	return VertexEncoding(VERTEX_POSITION_UNORM16, VERTEX_NORMAL_OCT16, VERTEX_UV_HALF);
+}
+
+std::string meshCachePath(const char * objPath) {
+	std::string path(objPath);
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of('/');
+	if( dot != std::string::npos && (slash == std::string::npos || dot > slash) )
+		path.erase(dot);
+	return path + ".mesh";
+}
+
+static bool statSource(const char * path, uint64_t & size, int64_t & seconds, int64_t & nanoseconds) {
+	struct stat info;
+	if( stat(path, &info) != 0 )
+		return false;
+	size = (uint64_t)info.st_size;
+	seconds = (int64_t)info.st_mtime;
+#ifdef __APPLE__
+	nanoseconds = (int64_t)info.st_mtimespec.tv_nsec;
+#else
+	nanoseconds = (int64_t)info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+// statSource for dependencies : a missing file gets the missing stamp, all zeros.
+static bool statDependency(const char * path, uint64_t & size, int64_t & seconds, int64_t & nanoseconds) {
+	if( statSource(path, size, seconds, nanoseconds) )
+		return true;
+	if( errno != ENOENT && errno != ENOTDIR )
+		return false;
+	size = 0;
+	seconds = nanoseconds = 0;
+	return true;
+}
+
+// Hashes 8 bytes at a time with a multiply-rotate mix, fast enough to run at memory speed.
+static uint64_t hashBytes(const char * data, size_t size) {
+	const uint64_t prime = 0x9E3779B97F4A7C15ull;
+	uint64_t h = 0xCBF29CE484222325ull ^ (size * prime);
+	size_t i = 0;
+	for( ; i + 8 <= size; i += 8 ){
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		h = (h ^ word) * prime;
+		h = (h << 31) | (h >> 33);
+	}
+	for( ; i < size; i++ )
+		h = (h ^ (unsigned char)data[i]) * 0x100000001B3ull;
+	h ^= h >> 32;
+	h *= prime;
+	h ^= h >> 29;
+	return h;
+}
+
+bool hashFile(const char * path, uint64_t & out_hash) {
+	MappedFile file;
+	if( !file.open(path) )
+		return false;
+	out_hash = hashBytes(file.data(), file.size());
+	return true;
+}
+
+// Appends str to the string table and returns where it starts.
+static uint32_t addString(std::string & table, const std::string & str, uint32_t & out_length) {
+	uint32_t offset = (uint32_t)table.size();
+	table += str;
+	out_length = (uint32_t)str.size();
+	return offset;
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+	return (offset + streamAlignment - 1) / streamAlignment * streamAlignment;
+}
+
+static void setAttribute(MeshAttributeLayout & layout, MeshAttributeSemantic semantic, MeshCacheCompression compression, uint64_t size, uint64_t & offset) {
+	const StreamFormat & format = streamFormats[compression][semantic];
+	layout.semantic = semantic;
+	layout.componentType = format.componentType;
+	layout.components = format.components;
+	layout.stride = format.stride;
+	layout.offset = offset;
+	layout.size = size;
+	offset = alignOffset(offset + layout.size);
+}
+
+static bool writeStream(FILE * file, const void * data, uint64_t offset, uint64_t size) {
+	// Zero-fill up to the aligned start of the stream
+	static const char padding[streamAlignment] = { 0 };
+	long position = ftell(file);
+	if( position < 0 || (uint64_t)position > offset || fwrite(padding, 1, offset - position, file) != offset - position )
+		return false;
+	return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+bool writeMeshCache(const char * objPath, const Mesh & mesh, MeshCacheCompression compression) {
+	const std::vector<unsigned int> & indices = mesh.indices;
+	const std::vector<glm::vec3> & vertices = mesh.vertices;
+	const std::vector<glm::vec2> & uvs = mesh.uvs;
+	const std::vector<glm::vec3> & normals = mesh.normals;
+
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+	header.version = MESH_CACHE_VERSION;
+	header.compression = compression;
+	if( !statSource(objPath, header.sourceSize, header.sourceModifiedSeconds, header.sourceModifiedNanoseconds) || !hashFile(objPath, header.sourceHash) ){
+		printf("Impossible to read %s to build its mesh cache\n", objPath);
+		return false;
+	}
+
+	header.vertexCount = (uint32_t)vertices.size();
+	header.indexCount = (uint32_t)indices.size();
+
+	// Same rule as VBO::genBuffers : 16-bit indices whenever every vertex fits
+	std::vector<unsigned short> shortIndices;
+	const void * indexData = indices.empty() ? NULL : &indices[0];
+	header.indexSize = indices.empty() ? 0 : 4;
+	if( !indices.empty() && vertices.size() <= 65536 ){
+		shortIndices.assign(indices.begin(), indices.end());
+		indexData = &shortIndices[0];
+		header.indexSize = 2;
+	}
+
+	const void * streams[MESH_ATTRIBUTE_COUNT] = {
+		vertices.empty() ? NULL : &vertices[0], uvs.empty() ? NULL : &uvs[0], normals.empty() ? NULL : &normals[0]
+	};
+	uint64_t streamBytes[MESH_ATTRIBUTE_COUNT] = { vertices.size() * sizeof(glm::vec3), uvs.size() * sizeof(glm::vec2), normals.size() * sizeof(glm::vec3) };
+	uint64_t indexBytes = (uint64_t)indices.size() * header.indexSize;
+	std::vector<unsigned char> encoded[MESH_ATTRIBUTE_COUNT];
+	std::vector<unsigned char> encodedIndices;
+	if( compression == MESH_CACHE_COMPRESSED ){
+		if( uvs.size() != vertices.size() || normals.size() != vertices.size() ){
+			printf("Every vertex of %s needs a UV and a normal to be compressed\n", objPath);
+			return false;
+		}
+		PackedVertices packed;
+		packVertices(compressedEncoding(), vertices.data(), uvs.data(), normals.data(), vertices.size(), packed);
+		const std::vector<unsigned char> * quantized[MESH_ATTRIBUTE_COUNT] = { &packed.positions, &packed.uvs, &packed.normals };
+		for( int i = 0; i < MESH_ATTRIBUTE_COUNT; i++ ){
+			encodeVertexStream(quantized[i]->data(), vertices.size(), streamFormats[compression][i].stride, encoded[i]);
+			streams[i] = encoded[i].data();
+			streamBytes[i] = encoded[i].size();
+		}
+		encodeIndexStream(indices.data(), indices.size(), encodedIndices);
+		indexData = encodedIndices.data();
+		indexBytes = encodedIndices.size();
+	}
+
+	uint64_t offset = sizeof(MeshCacheHeader);
+	header.attributeCount = MESH_ATTRIBUTE_COUNT;
+	for( int i = 0; i < MESH_ATTRIBUTE_COUNT; i++ )
+		setAttribute(header.attributes[i], (MeshAttributeSemantic)i, compression, streamBytes[i], offset);
+	header.indexOffset = offset;
+	header.indexBytes = indexBytes;
+	offset = alignOffset(offset + header.indexBytes);
+
+	std::string strings;
+	std::vector<MeshCacheMaterial> materials(mesh.materials.size());
+	for( size_t i = 0; i < mesh.materials.size(); i++ ){
+		const Material & material = mesh.materials[i];
+		MeshCacheMaterial & record = materials[i];
+		memcpy(record.ambient, &material.ambient[0], sizeof(record.ambient));
+		memcpy(record.diffuse, &material.diffuse[0], sizeof(record.diffuse));
+		memcpy(record.specular, &material.specular[0], sizeof(record.specular));
+		record.shininess = material.shininess;
+		record.opacity = material.opacity;
+		record.name = addString(strings, material.name, record.nameLength);
+		record.diffuseTexture = addString(strings, material.diffuseTexture, record.diffuseTextureLength);
+	}
+	std::vector<MeshCacheLod> lods(mesh.lods.size());
+	std::vector<MeshPart> lodParts;
+	for( size_t i = 0; i < mesh.lods.size(); i++ ){
+		lods[i].ratio = mesh.lods[i].ratio;
+		lods[i].error = mesh.lods[i].error;
+		if( mesh.lods[i].parts.size() != mesh.parts.size() ){
+			printf("Level of detail %u of %s doesn't match the mesh's parts\n", (unsigned int)i + 1, objPath);
+			return false;
+		}
+		lodParts.insert(lodParts.end(), mesh.lods[i].parts.begin(), mesh.lods[i].parts.end());
+	}
+	std::vector<MeshCacheGroup> groups(mesh.groups.size());
+	for( size_t i = 0; i < mesh.groups.size(); i++ ){
+		const MeshGroup & group = mesh.groups[i];
+		MeshCacheGroup & record = groups[i];
+		record.name = addString(strings, group.name, record.nameLength);
+		record.firstPart = group.firstPart;
+		record.partCount = group.partCount;
+		record.firstIndex = group.firstIndex;
+		record.indexCount = group.indexCount;
+		memcpy(record.boundsMin, &group.boundsMin[0], sizeof(record.boundsMin));
+		memcpy(record.boundsMax, &group.boundsMax[0], sizeof(record.boundsMax));
+		memcpy(record.center, &group.center[0], sizeof(record.center));
+		record.radius = group.radius;
+	}
+	std::vector<MeshCacheDependency> dependencies(mesh.materialLibraries.size());
+	for( size_t i = 0; i < mesh.materialLibraries.size(); i++ ){
+		MeshCacheDependency & record = dependencies[i];
+		if( !statDependency(mesh.materialLibraries[i].c_str(), record.size, record.modifiedSeconds, record.modifiedNanoseconds) ){
+			printf("Impossible to read %s to build its mesh cache\n", mesh.materialLibraries[i].c_str());
+			return false;
+		}
+		record.path = addString(strings, mesh.materialLibraries[i], record.pathLength);
+	}
+
+	header.partCount = (uint32_t)mesh.parts.size();
+	header.partOffset = offset;
+	offset = alignOffset(offset + mesh.parts.size() * sizeof(MeshPart));
+	header.lodCount = (uint32_t)lods.size();
+	header.lodOffset = offset;
+	offset = alignOffset(offset + lods.size() * sizeof(MeshCacheLod));
+	header.lodPartOffset = offset;
+	offset = alignOffset(offset + lodParts.size() * sizeof(MeshPart));
+	header.meshletCount = (uint32_t)mesh.meshlets.size();
+	header.meshletOffset = offset;
+	offset = alignOffset(offset + mesh.meshlets.size() * sizeof(Meshlet));
+	header.groupCount = (uint32_t)groups.size();
+	header.groupOffset = offset;
+	offset = alignOffset(offset + groups.size() * sizeof(MeshCacheGroup));
+	header.materialCount = (uint32_t)materials.size();
+	header.materialOffset = offset;
+	offset = alignOffset(offset + materials.size() * sizeof(MeshCacheMaterial));
+	header.dependencyCount = (uint32_t)dependencies.size();
+	header.dependencyOffset = offset;
+	offset = alignOffset(offset + dependencies.size() * sizeof(MeshCacheDependency));
+	header.stringOffset = offset;
+	header.stringBytes = strings.size();
+
+	glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+	if( !vertices.empty() ){
+		boundsMin = boundsMax = vertices[0];
+		for( size_t i = 1; i < vertices.size(); i++ ){
+			boundsMin = glm::min(boundsMin, vertices[i]);
+			boundsMax = glm::max(boundsMax, vertices[i]);
+		}
+	}
+	memcpy(header.boundsMin, &boundsMin[0], sizeof(header.boundsMin));
+	memcpy(header.boundsMax, &boundsMax[0], sizeof(header.boundsMax));
+
+	// Written under a name of its own, as another thread or process may be writing the same cache
+	std::string path = meshCachePath(objPath);
+	std::vector<char> temporaryPath(path.begin(), path.end());
+	const char suffix[] = ".XXXXXX";
+	temporaryPath.insert(temporaryPath.end(), suffix, suffix + sizeof(suffix));
+	int descriptor = mkstemp(temporaryPath.data());
+	FILE * file = descriptor < 0 ? NULL : fdopen(descriptor, "wb");
+	if( file == NULL ){
+		printf("Impossible to write the mesh cache %s\n", path.c_str());
+		if( descriptor >= 0 ){
+			close(descriptor);
+			remove(temporaryPath.data());
+		}
+		return false;
+	}
+	fchmod(descriptor, 0644); // mkstemp's 0600 would keep the cache from other users
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& writeStream(file, streams[MESH_ATTRIBUTE_POSITION], header.attributes[MESH_ATTRIBUTE_POSITION].offset, header.attributes[MESH_ATTRIBUTE_POSITION].size)
+		&& writeStream(file, streams[MESH_ATTRIBUTE_UV], header.attributes[MESH_ATTRIBUTE_UV].offset, header.attributes[MESH_ATTRIBUTE_UV].size)
+		&& writeStream(file, streams[MESH_ATTRIBUTE_NORMAL], header.attributes[MESH_ATTRIBUTE_NORMAL].offset, header.attributes[MESH_ATTRIBUTE_NORMAL].size)
+		&& writeStream(file, indexData, header.indexOffset, header.indexBytes)
+		&& writeStream(file, mesh.parts.empty() ? NULL : &mesh.parts[0], header.partOffset, header.partCount * sizeof(MeshPart))
+		&& writeStream(file, lods.empty() ? NULL : &lods[0], header.lodOffset, header.lodCount * sizeof(MeshCacheLod))
+		&& writeStream(file, lodParts.empty() ? NULL : &lodParts[0], header.lodPartOffset, lodParts.size() * sizeof(MeshPart))
+		&& writeStream(file, mesh.meshlets.empty() ? NULL : &mesh.meshlets[0], header.meshletOffset, header.meshletCount * sizeof(Meshlet))
+		&& writeStream(file, groups.empty() ? NULL : &groups[0], header.groupOffset, header.groupCount * sizeof(MeshCacheGroup))
+		&& writeStream(file, materials.empty() ? NULL : &materials[0], header.materialOffset, header.materialCount * sizeof(MeshCacheMaterial))
+		&& writeStream(file, dependencies.empty() ? NULL : &dependencies[0], header.dependencyOffset, header.dependencyCount * sizeof(MeshCacheDependency))
+		&& writeStream(file, strings.data(), header.stringOffset, header.stringBytes);
+	written = fclose(file) == 0 && written;
+	if( !written || rename(temporaryPath.data(), path.c_str()) != 0 ){
+		printf("Impossible to write the mesh cache %s\n", path.c_str());
+		remove(temporaryPath.data());
+		return false;
+	}
+	return true;
+}
+
+bool restampMeshCache(const char * objPath, uint64_t sourceHash) {
+	std::string path = meshCachePath(objPath);
+	FILE * file = fopen(path.c_str(), "r+b");
+	if( file == NULL )
+		return false;
+
+	MeshCacheHeader header;
+	std::vector<MeshCacheDependency> dependencies;
+	std::string strings;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, MESH_CACHE_MAGIC, 4) == 0 && header.version == MESH_CACHE_VERSION && header.sourceHash == sourceHash
+		&& header.dependencyCount < 0x10000 && header.stringBytes < 0x1000000;
+	if( valid ){
+		dependencies.resize(header.dependencyCount);
+		strings.resize((size_t)header.stringBytes);
+		valid = (dependencies.empty() || (fseek(file, (long)header.dependencyOffset, SEEK_SET) == 0
+				&& fread(&dependencies[0], sizeof(MeshCacheDependency), dependencies.size(), file) == dependencies.size()))
+			&& (strings.empty() || (fseek(file, (long)header.stringOffset, SEEK_SET) == 0
+				&& fread(&strings[0], 1, strings.size(), file) == strings.size()));
+	}
+	valid = valid && statSource(objPath, header.sourceSize, header.sourceModifiedSeconds, header.sourceModifiedNanoseconds);
+	for( size_t i = 0; valid && i < dependencies.size(); i++ ){
+		MeshCacheDependency & record = dependencies[i];
+		valid = (uint64_t)record.path + record.pathLength <= strings.size()
+			&& statDependency(strings.substr(record.path, record.pathLength).c_str(), record.size, record.modifiedSeconds, record.modifiedNanoseconds);
+	}
+
+	// Only the stamps change, in place : the streams a reader may have mapped stay where they are
+	valid = valid && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1
+		&& (dependencies.empty() || (fseek(file, (long)header.dependencyOffset, SEEK_SET) == 0
+			&& fwrite(&dependencies[0], sizeof(MeshCacheDependency), dependencies.size(), file) == dependencies.size()));
+	return fclose(file) == 0 && valid;
+}
+
+bool MeshCache::open(const char * objPath, bool verifyHash) {
+	close();
+
+	std::string path = meshCachePath(objPath);
+	struct stat info;
+	if( stat(path.c_str(), &info) != 0 )
+		return false; // no cache yet, not an error
+	if( !map(path.c_str()) )
+		return false;
+
+	const MeshCacheHeader * header = (const MeshCacheHeader *)mFile.data();
+	uint64_t sourceSize;
+	int64_t seconds, nanoseconds;
+	if( !statSource(objPath, sourceSize, seconds, nanoseconds)
+		|| sourceSize != header->sourceSize || seconds != header->sourceModifiedSeconds || nanoseconds != header->sourceModifiedNanoseconds ){
+		mFile.close();
+		return false;
+	}
+	uint64_t sourceHash;
+	if( verifyHash && (!hashFile(objPath, sourceHash) || sourceHash != header->sourceHash) ){
+		mFile.close();
+		return false;
+	}
+
+	if( !validate(path.c_str()) )
+		return false;
+	if( !dependenciesUnchanged() ){
+		close();
+		return false;
+	}
+	if( header->compression == MESH_CACHE_COMPRESSED && !decode() ){
+		printf("Mesh cache %s is corrupted, ignoring it\n", path.c_str());
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::openFile(const char * cachePath) {
+	close();
+	if( !map(cachePath) || !validate(cachePath) )
+		return false;
+	if( mHeader->compression == MESH_CACHE_COMPRESSED && !decode() ){
+		printf("Mesh cache %s is corrupted\n", cachePath);
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::map(const char * path) {
+	if( !mFile.open(path) )
+		return false;
+	const MeshCacheHeader * header = (const MeshCacheHeader *)mFile.data();
+	if( mFile.size() < sizeof(MeshCacheHeader) || memcmp(header->magic, MESH_CACHE_MAGIC, 4) != 0 || header->version != MESH_CACHE_VERSION ){
+		mFile.close();
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::validate(const char * path) {
+	// Never trust offsets read from disk, nor the indices : they go straight to the GPU.
+	// The sizes of coded streams and the indices in them are checked while decoding them
+	const MeshCacheHeader * header = (const MeshCacheHeader *)mFile.data();
+	bool compressed = header->compression == MESH_CACHE_COMPRESSED;
+	bool fits = header->attributeCount == MESH_ATTRIBUTE_COUNT
+		&& (header->compression == MESH_CACHE_RAW || compressed)
+		&& (header->indexSize == 0 || header->indexSize == 2 || header->indexSize == 4)
+		&& header->indexOffset % 4 == 0 && header->indexOffset <= mFile.size() && header->indexBytes <= mFile.size() - header->indexOffset
+		&& (compressed ? header->indexBytes >= header->indexCount : header->indexBytes == (uint64_t)header->indexCount * header->indexSize);
+	for( uint32_t i = 0; fits && i < MESH_ATTRIBUTE_COUNT; i++ ){
+		const MeshAttributeLayout & layout = header->attributes[i];
+		const StreamFormat & format = streamFormats[header->compression][i];
+		fits = layout.semantic == i && layout.componentType == format.componentType && layout.components == format.components && layout.stride == format.stride
+			&& layout.offset % 4 == 0 && layout.offset <= mFile.size() && layout.size <= mFile.size() - layout.offset
+			&& (compressed ? layout.size >= minimumVertexStreamSize(header->vertexCount, layout.stride)
+			               : layout.size == (uint64_t)header->vertexCount * layout.stride);
+	}
+	const uint64_t tables[8][2] = {
+		{ header->partOffset, (uint64_t)header->partCount * sizeof(MeshPart) },
+		{ header->lodOffset, (uint64_t)header->lodCount * sizeof(MeshCacheLod) },
+		{ header->lodPartOffset, (uint64_t)header->lodCount * header->partCount * sizeof(MeshPart) },
+		{ header->meshletOffset, (uint64_t)header->meshletCount * sizeof(Meshlet) },
+		{ header->groupOffset, (uint64_t)header->groupCount * sizeof(MeshCacheGroup) },
+		{ header->materialOffset, (uint64_t)header->materialCount * sizeof(MeshCacheMaterial) },
+		{ header->dependencyOffset, (uint64_t)header->dependencyCount * sizeof(MeshCacheDependency) },
+		{ header->stringOffset, header->stringBytes }
+	};
+	for( int i = 0; fits && i < 8; i++ )
+		fits = tables[i][0] % 8 == 0 && tables[i][0] <= mFile.size() && tables[i][1] <= mFile.size() - tables[i][0];
+	// The tables are only pointed at once they are known to be in the file, and each loop below stops at the first misfit
+	const MeshPart * parts = fits ? (const MeshPart *)(mFile.data() + header->partOffset) : NULL;
+	for( uint32_t i = 0; fits && i < header->partCount; i++ )
+		fits = (parts[i].material == MESH_NO_MATERIAL || parts[i].material < header->materialCount)
+			&& parts[i].firstIndex <= header->indexCount && parts[i].indexCount <= header->indexCount - parts[i].firstIndex;
+	const MeshPart * lodParts = fits ? (const MeshPart *)(mFile.data() + header->lodPartOffset) : NULL;
+	for( uint64_t i = 0; fits && i < (uint64_t)header->lodCount * header->partCount; i++ )
+		fits = lodParts[i].material == parts[i % header->partCount].material
+			&& lodParts[i].firstIndex <= header->indexCount && lodParts[i].indexCount <= header->indexCount - lodParts[i].firstIndex;
+	const Meshlet * meshlets = fits ? (const Meshlet *)(mFile.data() + header->meshletOffset) : NULL;
+	for( uint32_t i = 0; fits && i < header->meshletCount; i++ )
+		fits = meshlets[i].part < header->partCount
+			&& meshlets[i].firstIndex >= parts[meshlets[i].part].firstIndex
+			&& meshlets[i].firstIndex <= parts[meshlets[i].part].firstIndex + parts[meshlets[i].part].indexCount
+			&& meshlets[i].indexCount <= parts[meshlets[i].part].firstIndex + parts[meshlets[i].part].indexCount - meshlets[i].firstIndex
+			&& (i == 0 || meshlets[i].part >= meshlets[i - 1].part);
+	const MeshCacheGroup * groups = fits ? (const MeshCacheGroup *)(mFile.data() + header->groupOffset) : NULL;
+	for( uint32_t i = 0; fits && i < header->groupCount; i++ )
+		fits = (uint64_t)groups[i].name + groups[i].nameLength <= header->stringBytes
+			&& groups[i].firstPart <= header->partCount && groups[i].partCount <= header->partCount - groups[i].firstPart
+			&& groups[i].firstIndex <= header->indexCount && groups[i].indexCount <= header->indexCount - groups[i].firstIndex;
+	const MeshCacheMaterial * materials = fits ? (const MeshCacheMaterial *)(mFile.data() + header->materialOffset) : NULL;
+	for( uint32_t i = 0; fits && i < header->materialCount; i++ )
+		fits = (uint64_t)materials[i].name + materials[i].nameLength <= header->stringBytes
+			&& (uint64_t)materials[i].diffuseTexture + materials[i].diffuseTextureLength <= header->stringBytes;
+	const MeshCacheDependency * dependencies = fits ? (const MeshCacheDependency *)(mFile.data() + header->dependencyOffset) : NULL;
+	for( uint32_t i = 0; fits && i < header->dependencyCount; i++ )
+		fits = (uint64_t)dependencies[i].path + dependencies[i].pathLength <= header->stringBytes;
+	fits = fits && (compressed || indicesInRange(mFile.data() + header->indexOffset, header->indexSize, header->indexCount, header->vertexCount));
+	if( !fits ){
+		printf("Mesh cache %s is corrupted, ignoring it\n", path);
+		mFile.close();
+		return false;
+	}
+
+	mHeader = header;
+	return true;
+}
+
+void MeshCache::close() {
+	mFile.close();
+	mHeader = NULL;
+	for( int i = 0; i < MESH_ATTRIBUTE_COUNT; i++ )
+		std::vector<unsigned char>().swap(mDecodedAttributes[i]);
+	std::vector<unsigned char>().swap(mDecodedIndices);
+}
+
+bool MeshCache::decode() {
+	size_t count = mHeader->vertexCount;
+	PackedVertices packed;
+	std::vector<unsigned char> * quantized[MESH_ATTRIBUTE_COUNT] = { &packed.positions, &packed.uvs, &packed.normals };
+	for( int i = 0; i < MESH_ATTRIBUTE_COUNT; i++ ){
+		const MeshAttributeLayout & layout = mHeader->attributes[i];
+		quantized[i]->resize(count * layout.stride);
+		if( !decodeVertexStream((const unsigned char *)mFile.data() + layout.offset, (size_t)layout.size, quantized[i]->data(), count, layout.stride) )
+			return false;
+	}
+	// Positions were quantized across the bounds of the mesh, like packVertices does
+	packed.positionOffset = glm::vec3(mHeader->boundsMin[0], mHeader->boundsMin[1], mHeader->boundsMin[2]);
+	packed.positionScale = glm::vec3(mHeader->boundsMax[0], mHeader->boundsMax[1], mHeader->boundsMax[2]) - packed.positionOffset;
+	mDecodedAttributes[MESH_ATTRIBUTE_POSITION].resize(count * sizeof(glm::vec3));
+	mDecodedAttributes[MESH_ATTRIBUTE_UV].resize(count * sizeof(glm::vec2));
+	mDecodedAttributes[MESH_ATTRIBUTE_NORMAL].resize(count * sizeof(glm::vec3));
+	unpackVertices(compressedEncoding(), packed, count,
+		(glm::vec3 *)mDecodedAttributes[MESH_ATTRIBUTE_POSITION].data(),
+		(glm::vec2 *)mDecodedAttributes[MESH_ATTRIBUTE_UV].data(),
+		(glm::vec3 *)mDecodedAttributes[MESH_ATTRIBUTE_NORMAL].data());
+
+	const unsigned char * indices = (const unsigned char *)mFile.data() + mHeader->indexOffset;
+	mDecodedIndices.resize((size_t)mHeader->indexCount * mHeader->indexSize);
+	bool decoded = mHeader->indexBytes == 0;
+	if( mHeader->indexSize == 2 )
+		decoded = decodeIndexStream(indices, (size_t)mHeader->indexBytes, (unsigned short *)mDecodedIndices.data(), mHeader->indexCount);
+	else if( mHeader->indexSize == 4 )
+		decoded = decodeIndexStream(indices, (size_t)mHeader->indexBytes, (unsigned int *)mDecodedIndices.data(), mHeader->indexCount);
+	return decoded && indicesInRange(mDecodedIndices.data(), mHeader->indexSize, mHeader->indexCount, mHeader->vertexCount);
+}
+
+const void * MeshCache::attribute(MeshAttributeSemantic semantic) const {
+	if( mHeader->compression == MESH_CACHE_COMPRESSED )
+		return mDecodedAttributes[semantic].data();
+	return mFile.data() + mHeader->attributes[semantic].offset;
+}
+
+size_t MeshCache::attributeSize(MeshAttributeSemantic semantic) const {
+	if( mHeader->compression == MESH_CACHE_COMPRESSED )
+		return mDecodedAttributes[semantic].size();
+	return (size_t)mHeader->attributes[semantic].size;
+}
+
+const void * MeshCache::indexData() const {
+	if( mHeader->compression == MESH_CACHE_COMPRESSED )
+		return mDecodedIndices.data();
+	return mFile.data() + mHeader->indexOffset;
+}
+
+bool MeshCache::dependenciesUnchanged() const {
+	const MeshCacheDependency * dependencies = (const MeshCacheDependency *)(mFile.data() + mHeader->dependencyOffset);
+	for( uint32_t i = 0; i < mHeader->dependencyCount; i++ ){
+		std::string path = string(dependencies[i].path, dependencies[i].pathLength);
+		uint64_t size;
+		int64_t seconds, nanoseconds;
+		if( !statDependency(path.c_str(), size, seconds, nanoseconds)
+			|| size != dependencies[i].size || seconds != dependencies[i].modifiedSeconds || nanoseconds != dependencies[i].modifiedNanoseconds )
+			return false;
+	}
+	return true;
+}
+
+void MeshCache::materials(std::vector<Material> & out_materials) const {
+	const MeshCacheMaterial * records = (const MeshCacheMaterial *)(mFile.data() + mHeader->materialOffset);
+	for( uint32_t i = 0; i < mHeader->materialCount; i++ ){
+		Material material;
+		material.name = string(records[i].name, records[i].nameLength);
+		material.ambient = glm::vec3(records[i].ambient[0], records[i].ambient[1], records[i].ambient[2]);
+		material.diffuse = glm::vec3(records[i].diffuse[0], records[i].diffuse[1], records[i].diffuse[2]);
+		material.specular = glm::vec3(records[i].specular[0], records[i].specular[1], records[i].specular[2]);
+		material.shininess = records[i].shininess;
+		material.opacity = records[i].opacity;
+		material.diffuseTexture = string(records[i].diffuseTexture, records[i].diffuseTextureLength);
+		out_materials.push_back(material);
+	}
+}
+
+void MeshCache::groups(std::vector<MeshGroup> & out_groups) const {
+	const MeshCacheGroup * records = (const MeshCacheGroup *)(mFile.data() + mHeader->groupOffset);
+	for( uint32_t i = 0; i < mHeader->groupCount; i++ ){
+		MeshGroup group;
+		group.name = string(records[i].name, records[i].nameLength);
+		group.firstPart = records[i].firstPart;
+		group.partCount = records[i].partCount;
+		group.firstIndex = records[i].firstIndex;
+		group.indexCount = records[i].indexCount;
+		group.boundsMin = glm::vec3(records[i].boundsMin[0], records[i].boundsMin[1], records[i].boundsMin[2]);
+		group.boundsMax = glm::vec3(records[i].boundsMax[0], records[i].boundsMax[1], records[i].boundsMax[2]);
+		group.center = glm::vec3(records[i].center[0], records[i].center[1], records[i].center[2]);
+		group.radius = records[i].radius;
+		out_groups.push_back(group);
+	}
+}
+
+void MeshCache::lods(std::vector<MeshLod> & out_lods) const {
+	const MeshCacheLod * records = (const MeshCacheLod *)(mFile.data() + mHeader->lodOffset);
+	const MeshPart * parts = (const MeshPart *)(mFile.data() + mHeader->lodPartOffset);
+	for( uint32_t i = 0; i < mHeader->lodCount; i++ ){
+		MeshLod lod;
+		lod.ratio = records[i].ratio;
+		lod.error = records[i].error;
+		lod.parts.assign(parts + (size_t)i * mHeader->partCount, parts + (size_t)(i + 1) * mHeader->partCount);
+		out_lods.push_back(lod);
+	}
+}
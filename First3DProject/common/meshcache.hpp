@@ -0,0 +1,190 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "mappedfile.hpp"
+#include "mesh.hpp"
+
+// Binary ".mesh" cache written next to an OBJ file, so that loading a model is just a few memcpy's away.
+//
+// Layout : a MeshCacheHeader, then every attribute stream and the index buffer, each at a 16 byte aligned offset.
+// Streams are stored exactly as they are uploaded to the GPU, so the mapped pointers can go straight to glBufferData.
+// They are followed by the material parts, the levels of detail and their parts, the meshlets, the groups, the materials, the files the cache depends on besides
+// the OBJ (its material libraries), and the strings those records point into.
+//
+// A compressed cache instead quantizes the attributes (like VERTEX_POSITION_UNORM16 across the bounds, VERTEX_NORMAL_OCT16
+// and VERTEX_UV_HALF) and codes them and the indices with meshcodec ; they are decoded back to floats when the cache is opened.
+
+#define MESH_CACHE_MAGIC "MESH"
+#define MESH_CACHE_VERSION 8
+
+// Component types, with the values of the matching GL enums so they can be passed to glVertexAttribPointer as is
+#define MESH_COMPONENT_SHORT          0x1402 // GL_SHORT
+#define MESH_COMPONENT_UNSIGNED_SHORT 0x1403 // GL_UNSIGNED_SHORT
+#define MESH_COMPONENT_UNSIGNED_INT   0x1405 // GL_UNSIGNED_INT
+#define MESH_COMPONENT_FLOAT          0x1406 // GL_FLOAT
+#define MESH_COMPONENT_HALF_FLOAT     0x140B // GL_HALF_FLOAT
+
+enum MeshCacheCompression {
+	MESH_CACHE_RAW,        // float streams, mapped and used in place
+	MESH_CACHE_COMPRESSED  // quantized, delta coded streams : a third to a half of the size, not bit-exact
+};
+
+enum MeshAttributeSemantic {
+	MESH_ATTRIBUTE_POSITION = 0,
+	MESH_ATTRIBUTE_UV       = 1,
+	MESH_ATTRIBUTE_NORMAL   = 2,
+	MESH_ATTRIBUTE_COUNT
+};
+
+struct MeshAttributeLayout {
+	uint32_t semantic;      // MeshAttributeSemantic
+	uint32_t componentType; // MESH_COMPONENT_*
+	uint32_t components;    // components per vertex
+	uint32_t stride;        // bytes per vertex
+	uint64_t offset;        // from the start of the file
+	uint64_t size;          // bytes, once coded in a compressed cache
+};
+
+// A Material, with its strings stored in the string table.
+struct MeshCacheMaterial {
+	float ambient[3];
+	float diffuse[3];
+	float specular[3];
+	float shininess;
+	float opacity;
+	uint32_t name, nameLength;                     // into the string table
+	uint32_t diffuseTexture, diffuseTextureLength; // into the string table
+};
+
+// A MeshLod, whose parts are stored with those of the other levels.
+struct MeshCacheLod {
+	float ratio;
+	float error;
+};
+
+// A MeshGroup, with its name stored in the string table.
+struct MeshCacheGroup {
+	uint32_t name, nameLength; // into the string table
+	uint32_t firstPart, partCount;
+	uint32_t firstIndex, indexCount;
+	float boundsMin[3];
+	float boundsMax[3];
+	float center[3];
+	float radius;
+};
+
+// A file whose changes make the cache stale, e.g. a material library.
+// One that was missing is stamped with a size and modification time of 0 : creating it makes the cache stale too.
+struct MeshCacheDependency {
+	uint64_t size;
+	int64_t modifiedSeconds;
+	int64_t modifiedNanoseconds;
+	uint32_t path, pathLength; // into the string table
+};
+
+struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+
+	// Identity of the OBJ file the cache was built from
+	uint64_t sourceSize;
+	int64_t sourceModifiedSeconds;
+	int64_t sourceModifiedNanoseconds;
+	uint64_t sourceHash;
+
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;     // 2 or 4 bytes per index, 0 for a non-indexed mesh
+	uint32_t attributeCount;
+	MeshAttributeLayout attributes[MESH_ATTRIBUTE_COUNT];
+	uint64_t indexOffset;
+	uint64_t indexBytes;    // once coded in a compressed cache
+	uint32_t compression;   // MeshCacheCompression
+	uint32_t reserved;
+
+	float boundsMin[3];
+	float boundsMax[3];
+
+	uint32_t partCount;       // MeshPart records
+	uint32_t materialCount;   // MeshCacheMaterial records
+	uint32_t dependencyCount; // MeshCacheDependency records
+	uint32_t groupCount;      // MeshCacheGroup records
+	uint32_t lodCount;        // MeshCacheLod records, and lodCount * partCount MeshPart records
+	uint32_t meshletCount;    // Meshlet records
+	uint64_t partOffset;
+	uint64_t lodOffset;
+	uint64_t lodPartOffset;
+	uint64_t meshletOffset;
+	uint64_t groupOffset;
+	uint64_t materialOffset;
+	uint64_t dependencyOffset;
+	uint64_t stringOffset;
+	uint64_t stringBytes;
+};
+
+// Where the cache of an OBJ file lives : the same path with the extension replaced by ".mesh".
+std::string meshCachePath(const char * objPath);
+
+// 64-bit hash of a file's content, used to tell whether a cache still matches its source.
+bool hashFile(const char * path, uint64_t & out_hash);
+
+// Writes the cache of objPath. The file is written under a temporary name and renamed, so readers never see half of it.
+// mesh.materialLibraries are recorded as dependencies, missing or not : editing or adding a material library invalidates the cache too.
+bool writeMeshCache(const char * objPath, const Mesh & mesh, MeshCacheCompression compression = MESH_CACHE_RAW);
+
+// Records the current size and modification time of objPath and of its dependencies in its cache, for files that were
+// touched but not changed (e.g. by a fresh checkout), which would otherwise make MeshCache::open reject it.
+// Fails unless the cache is of this version and was built from an OBJ whose content hash is sourceHash.
+// The cache doesn't hash the dependencies : the caller is trusted to have checked that their content didn't change.
+bool restampMeshCache(const char * objPath, uint64_t sourceHash);
+
+// A mapped, validated cache file.
+class MeshCache {
+public:
+	MeshCache() : mHeader(NULL) {}
+
+	// Maps the cache of objPath. Fails if there is none, or if it's stale : its version differs,
+	// or the size or modification time of the OBJ file or of a dependency changed, or the OBJ's content hash did.
+	// Hashing reads the whole OBJ : callers that trust the size and time stamps can skip it with verifyHash false.
+	// A compressed cache is decoded here, so the streams below are always floats and indices of indexSize bytes.
+	bool open(const char * objPath, bool verifyHash = true);
+	// Maps a cache file on its own, e.g. to inspect it : only its version and its content are checked, not its sources.
+	bool openFile(const char * cachePath);
+	void close();
+	bool isOpen() const { return mHeader != NULL; }
+
+	const MeshCacheHeader & header() const { return *mHeader; }
+	const void * attribute(MeshAttributeSemantic semantic) const;
+	size_t attributeSize(MeshAttributeSemantic semantic) const;
+	const void * indexData() const;
+	size_t indexDataSize() const { return (size_t)mHeader->indexCount * mHeader->indexSize; }
+	const MeshPart * parts() const { return (const MeshPart *)(mFile.data() + mHeader->partOffset); }
+	size_t partCount() const { return mHeader->partCount; }
+	const Meshlet * meshlets() const { return (const Meshlet *)(mFile.data() + mHeader->meshletOffset); }
+	size_t meshletCount() const { return mHeader->meshletCount; }
+
+	// Decode the material, group and level of detail records.
+	void materials(std::vector<Material> & out_materials) const;
+	void lods(std::vector<MeshLod> & out_lods) const;
+	void groups(std::vector<MeshGroup> & out_groups) const;
+
+private:
+	std::string string(uint32_t offset, uint32_t length) const { return std::string(mFile.data() + mHeader->stringOffset + offset, length); }
+	bool map(const char * path);
+	bool validate(const char * path);
+	bool dependenciesUnchanged() const;
+	bool decode();
+
+	MappedFile mFile;
+	const MeshCacheHeader * mHeader;
+	std::vector<unsigned char> mDecodedAttributes[MESH_ATTRIBUTE_COUNT]; // of a compressed cache
+	std::vector<unsigned char> mDecodedIndices;
+};
+
+#endif
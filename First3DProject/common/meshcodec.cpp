@@ -0,0 +1,395 @@
+#include <vector>
+#include <stdint.h>
+#include <cstring>
+#include <algorithm>
+
+// MESHCODEC_SCALAR builds the plain C++ paths only, e.g. to check them against the SSE2 ones
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(MESHCODEC_SCALAR)
+#include <emmintrin.h>
+#define MESHCODEC_SSE
+#endif
+
+#include "meshcodec.hpp"
+
+// Vertex stream : for every group of 16 vertices, a header of 2 bits per byte plane (stride / 4 bytes),
+// then every plane of the group packed with the bit width its header gives : 0 (all deltas are 0), 2, 4 or 8 bits.
+// Deltas are zigzag coded bytes. With bits per value, the 16 values are spread over 2 * bits bytes, value i in byte
+// i % (2 * bits) at bit bits * (i / (2 * bits)), which SSE2 unpacks with a few shifts and no shuffle.
+// The last group is padded with deltas of 0.
+//
+// Index stream : one varint per index, 7 bits per byte with the high bit set on all bytes but the last,
+// holding the zigzag coded difference with the previous index (the first one with 0).
+
+namespace {
+
+const size_t groupSize = 16;
+const unsigned int modeBits[4] = { 0, 2, 4, 8 };
+
+inline unsigned char zigzag8(unsigned char delta) {
+	return (unsigned char)((delta << 1) ^ ((signed char)delta >> 7));
+}
+
+inline unsigned char unzigzag8(unsigned char value) {
+	return (unsigned char)((value >> 1) ^ -(value & 1));
+}
+
+inline uint32_t zigzag32(uint32_t delta) {
+	return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+inline uint32_t unzigzag32(uint32_t value) {
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+// Smallest mode whose bit width holds every value.
+unsigned int modeFor(const unsigned char * values) {
+	unsigned char largest = 0;
+	for( size_t i = 0; i < groupSize; i++ )
+		largest = std::max(largest, values[i]);
+	return largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+}
+
+void packPlane(const unsigned char * values, unsigned int mode, std::vector<unsigned char> & out) {
+	unsigned int bits = modeBits[mode];
+	size_t bytes = 2 * bits;
+	size_t start = out.size();
+	out.resize(start + bytes, 0);
+	for( size_t i = 0; i < groupSize && bytes > 0; i++ )
+		out[start + i % bytes] |= (unsigned char)(values[i] << (bits * (i / bytes)));
+}
+
+#ifndef MESHCODEC_SSE
+
+// The unpacked deltas of one plane of a group, which has to hold 2 * bits bytes at data.
+void unpackPlane(const unsigned char * data, unsigned int mode, unsigned char * out_values) {
+	unsigned int bits = modeBits[mode];
+	size_t bytes = 2 * bits;
+	unsigned int mask = (1u << bits) - 1;
+	for( size_t i = 0; i < groupSize; i++ )
+		out_values[i] = bytes ? unzigzag8((unsigned char)((data[i % bytes] >> (bits * (i / bytes))) & mask)) : 0;
+}
+
+#else
+
+inline __m128i unpackPlaneSSE(const unsigned char * data, unsigned int mode) {
+	__m128i z;
+	switch( mode ){
+	case 0:
+		return _mm_setzero_si128();
+	case 1: {
+		int32_t word;
+		memcpy(&word, data, 4);
+		__m128i x = _mm_cvtsi32_si128(word);
+		__m128i mask = _mm_set1_epi8(3);
+		__m128i low = _mm_unpacklo_epi32(_mm_and_si128(x, mask), _mm_and_si128(_mm_srli_epi16(x, 2), mask));
+		__m128i high = _mm_unpacklo_epi32(_mm_and_si128(_mm_srli_epi16(x, 4), mask), _mm_and_si128(_mm_srli_epi16(x, 6), mask));
+		z = _mm_unpacklo_epi64(low, high);
+		break;
+	}
+	case 2: {
+		__m128i x = _mm_loadl_epi64((const __m128i *)data);
+		__m128i mask = _mm_set1_epi8(15);
+		z = _mm_unpacklo_epi64(_mm_and_si128(x, mask), _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+		break;
+	}
+	default:
+		z = _mm_loadu_si128((const __m128i *)data);
+		break;
+	}
+	__m128i half = _mm_and_si128(_mm_srli_epi16(z, 1), _mm_set1_epi8(0x7F));
+	__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(z, _mm_set1_epi8(1)));
+	return _mm_xor_si128(half, sign);
+}
+
+// Running sum of the 16 bytes of deltas, starting from carry, whose 16 bytes all hold the previous value.
+inline __m128i prefixSum8(__m128i deltas, __m128i carry) {
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 1));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 2));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 4));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 8));
+	return _mm_add_epi8(deltas, carry);
+}
+
+// The last byte of values, in all 16 bytes.
+inline __m128i broadcastLast8(__m128i values) {
+	__m128i words = _mm_shufflehi_epi16(_mm_unpackhi_epi8(values, values), 0xFF);
+	return _mm_shuffle_epi32(words, 0xFF);
+}
+
+// The 16 values of 4 planes (one 32-bit component), 4 per register.
+inline void interleavePlanes(const __m128i * p, __m128i * out_words) {
+	__m128i low01 = _mm_unpacklo_epi8(p[0], p[1]);
+	__m128i high01 = _mm_unpackhi_epi8(p[0], p[1]);
+	__m128i low23 = _mm_unpacklo_epi8(p[2], p[3]);
+	__m128i high23 = _mm_unpackhi_epi8(p[2], p[3]);
+	out_words[0] = _mm_unpacklo_epi16(low01, low23);
+	out_words[1] = _mm_unpackhi_epi16(low01, low23);
+	out_words[2] = _mm_unpacklo_epi16(high01, high23);
+	out_words[3] = _mm_unpackhi_epi16(high01, high23);
+}
+
+// Writes the 16 vertices held by planes to out, stride bytes apart.
+// Strides of 4 and 8 bytes are stored a register at a time, others a component at a time.
+inline void transposeGroup(const __m128i * planes, size_t stride, unsigned char * out) {
+	__m128i words[4];
+	if( stride == 4 ){
+		interleavePlanes(planes, words);
+		for( int i = 0; i < 4; i++ )
+			_mm_storeu_si128((__m128i *)out + i, words[i]);
+		return;
+	}
+	if( stride == 8 ){
+		__m128i second[4];
+		interleavePlanes(planes, words);
+		interleavePlanes(planes + 4, second);
+		for( int i = 0; i < 4; i++ ){
+			_mm_storeu_si128((__m128i *)out + 2 * i, _mm_unpacklo_epi32(words[i], second[i]));
+			_mm_storeu_si128((__m128i *)out + 2 * i + 1, _mm_unpackhi_epi32(words[i], second[i]));
+		}
+		return;
+	}
+	for( size_t component = 0; component * 4 < stride; component++ ){
+		interleavePlanes(planes + component * 4, words);
+		unsigned char * destination = out + component * 4;
+		for( int i = 0; i < 4; i++ ){
+			int32_t a = _mm_cvtsi128_si32(words[i]);
+			int32_t b = _mm_cvtsi128_si32(_mm_shuffle_epi32(words[i], 0x55));
+			int32_t c = _mm_cvtsi128_si32(_mm_shuffle_epi32(words[i], 0xAA));
+			int32_t d = _mm_cvtsi128_si32(_mm_shuffle_epi32(words[i], 0xFF));
+			memcpy(destination, &a, 4); destination += stride;
+			memcpy(destination, &b, 4); destination += stride;
+			memcpy(destination, &c, 4); destination += stride;
+			memcpy(destination, &d, 4); destination += stride;
+		}
+	}
+}
+
+#endif
+
+// Reads one varint at p, which must stay below end.
+inline bool readVarint(const unsigned char *& p, const unsigned char * end, uint32_t & out) {
+	uint32_t value = 0;
+	for( unsigned int shift = 0; shift < 35; shift += 7 ){
+		if( p >= end )
+			return false;
+		unsigned char byte = *p++;
+		if( shift == 28 && byte > 0x0F )
+			return false; // more than 32 bits
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if( !(byte & 0x80) ){
+			out = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+inline bool storeIndex(unsigned int * out, uint32_t index) {
+	*out = index;
+	return true;
+}
+
+inline bool storeIndex(unsigned short * out, uint32_t index) {
+	*out = (unsigned short)index;
+	return index <= 0xFFFF;
+}
+
+#ifdef MESHCODEC_SSE
+
+inline bool storeIndices(unsigned int * out, const __m128i * indices) {
+	for( int i = 0; i < 4; i++ )
+		_mm_storeu_si128((__m128i *)out + i, indices[i]);
+	return true;
+}
+
+inline bool storeIndices(unsigned short * out, const __m128i * indices) {
+	// packs_epi32 saturates signed values : move 0..65535 to -32768..32767 and back around it
+	__m128i bias = _mm_set1_epi32(0x8000);
+	__m128i biasWords = _mm_set1_epi16((short)0x8000);
+	__m128i high = _mm_setzero_si128();
+	for( int i = 0; i < 4; i += 2 ){
+		high = _mm_or_si128(high, _mm_or_si128(_mm_srli_epi32(indices[i], 16), _mm_srli_epi32(indices[i + 1], 16)));
+		__m128i packed = _mm_packs_epi32(_mm_sub_epi32(indices[i], bias), _mm_sub_epi32(indices[i + 1], bias));
+		_mm_storeu_si128((__m128i *)(out + i * 4), _mm_xor_si128(packed, biasWords));
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) == 0xFFFF;
+}
+
+// Index of the lowest bit set in mask, which isn't 0.
+inline int lowestBit(int mask) {
+#if defined(__GNUC__)
+	return __builtin_ctz((unsigned int)mask);
+#else
+	int bit = 0;
+	while( !(mask & 1) ){
+		mask >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
+
+#endif
+
+template <typename Index>
+bool decodeIndices(const unsigned char * data, size_t size, Index * out_indices, size_t count) {
+	const unsigned char * p = data;
+	const unsigned char * end = data + size;
+	uint32_t previous = 0;
+	size_t i = 0;
+#ifdef MESHCODEC_SSE
+	// Most deltas of an optimized index buffer fit a single byte : 16 of them are decoded at once,
+	// then the varints around the next multi-byte one, one at a time.
+	__m128i zero = _mm_setzero_si128();
+	while( count - i >= 16 && end - p >= 16 ){
+		__m128i bytes = _mm_loadu_si128((const __m128i *)p);
+		int continued = _mm_movemask_epi8(bytes);
+		if( continued != 0 ){
+			for( int single = lowestBit(continued); single >= 0; single-- ){
+				uint32_t delta;
+				if( !readVarint(p, end, delta) )
+					return false;
+				previous += unzigzag32(delta);
+				if( !storeIndex(out_indices + i++, previous) )
+					return false;
+			}
+			continue;
+		}
+		__m128i half = _mm_srli_epi16(_mm_and_si128(bytes, _mm_set1_epi8((char)0xFE)), 1);
+		__m128i deltas = _mm_xor_si128(half, _mm_sub_epi8(zero, _mm_and_si128(bytes, _mm_set1_epi8(1))));
+		__m128i sign = _mm_cmpgt_epi8(zero, deltas);
+		__m128i words[2] = { _mm_unpacklo_epi8(deltas, sign), _mm_unpackhi_epi8(deltas, sign) };
+		__m128i carry = _mm_set1_epi32((int32_t)previous);
+		__m128i indices[4];
+		for( int j = 0; j < 4; j++ ){
+			__m128i word = words[j / 2];
+			__m128i wordSign = _mm_cmpgt_epi16(zero, word);
+			__m128i values = (j & 1) ? _mm_unpackhi_epi16(word, wordSign) : _mm_unpacklo_epi16(word, wordSign);
+			values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+			values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+			indices[j] = _mm_add_epi32(values, carry);
+			carry = _mm_shuffle_epi32(indices[j], 0xFF);
+		}
+		if( !storeIndices(out_indices + i, indices) )
+			return false;
+		previous = (uint32_t)_mm_cvtsi128_si32(carry);
+		p += 16;
+		i += 16;
+	}
+#endif
+	for( ; i < count; i++ ){
+		uint32_t delta;
+		if( !readVarint(p, end, delta) )
+			return false;
+		previous += unzigzag32(delta);
+		if( !storeIndex(out_indices + i, previous) )
+			return false;
+	}
+	return p == end;
+}
+
+} // namespace
+
+bool encodeVertexStream(const void * vertices, size_t count, size_t stride, std::vector<unsigned char> & out) {
+	if( stride == 0 || stride % 4 != 0 || stride > MESH_CODEC_MAX_STRIDE )
+		return false;
+	const unsigned char * bytes = (const unsigned char *)vertices;
+	unsigned char previous[MESH_CODEC_MAX_STRIDE] = { 0 };
+	unsigned char deltas[MESH_CODEC_MAX_STRIDE][groupSize];
+	for( size_t first = 0; first < count; first += groupSize ){
+		size_t groupCount = std::min(groupSize, count - first);
+		for( size_t k = 0; k < stride; k++ ){
+			for( size_t v = 0; v < groupCount; v++ ){
+				unsigned char byte = bytes[(first + v) * stride + k];
+				deltas[k][v] = zigzag8((unsigned char)(byte - previous[k]));
+				previous[k] = byte;
+			}
+			for( size_t v = groupCount; v < groupSize; v++ )
+				deltas[k][v] = 0;
+		}
+
+		size_t header = out.size();
+		out.resize(header + stride / 4, 0);
+		for( size_t k = 0; k < stride; k++ ){
+			unsigned int mode = modeFor(deltas[k]);
+			out[header + k / 4] |= (unsigned char)(mode << (2 * (k % 4)));
+			packPlane(deltas[k], mode, out);
+		}
+	}
+	return true;
+}
+
+bool decodeVertexStream(const unsigned char * data, size_t size, void * out_vertices, size_t count, size_t stride) {
+	if( stride == 0 || stride % 4 != 0 || stride > MESH_CODEC_MAX_STRIDE )
+		return false;
+	const unsigned char * p = data;
+	const unsigned char * end = data + size;
+	unsigned char * out = (unsigned char *)out_vertices;
+	size_t headerBytes = stride / 4;
+
+#ifdef MESHCODEC_SSE
+	__m128i planes[MESH_CODEC_MAX_STRIDE];
+	__m128i carries[MESH_CODEC_MAX_STRIDE];
+	for( size_t k = 0; k < stride; k++ )
+		carries[k] = _mm_setzero_si128();
+	unsigned char partial[MESH_CODEC_MAX_STRIDE * groupSize];
+#else
+	unsigned char previous[MESH_CODEC_MAX_STRIDE] = { 0 };
+	unsigned char deltas[groupSize];
+#endif
+
+	for( size_t first = 0; first < count; first += groupSize ){
+		size_t groupCount = std::min(groupSize, count - first);
+		if( (size_t)(end - p) < headerBytes )
+			return false;
+		const unsigned char * header = p;
+		p += headerBytes;
+		for( size_t k = 0; k < stride; k++ ){
+			unsigned int mode = (header[k / 4] >> (2 * (k % 4))) & 3;
+			size_t bytes = 2 * modeBits[mode];
+			if( (size_t)(end - p) < bytes )
+				return false;
+#ifdef MESHCODEC_SSE
+			planes[k] = prefixSum8(unpackPlaneSSE(p, mode), carries[k]);
+			carries[k] = broadcastLast8(planes[k]);
+#else
+			unpackPlane(p, mode, deltas);
+			for( size_t v = 0; v < groupCount; v++ ){
+				previous[k] = (unsigned char)(previous[k] + deltas[v]);
+				out[(first + v) * stride + k] = previous[k];
+			}
+#endif
+			p += bytes;
+		}
+#ifdef MESHCODEC_SSE
+		if( groupCount == groupSize ){
+			transposeGroup(planes, stride, out + first * stride);
+		}else{
+			transposeGroup(planes, stride, partial);
+			memcpy(out + first * stride, partial, groupCount * stride);
+		}
+#endif
+	}
+	return p == end;
+}
+
+void encodeIndexStream(const unsigned int * indices, size_t count, std::vector<unsigned char> & out) {
+	uint32_t previous = 0;
+	for( size_t i = 0; i < count; i++ ){
+		uint32_t value = zigzag32(indices[i] - previous);
+		previous = indices[i];
+		while( value >= 0x80 ){
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+}
+
+bool decodeIndexStream(const unsigned char * data, size_t size, unsigned int * out_indices, size_t count) {
+	return decodeIndices(data, size, out_indices, count);
+}
+
+bool decodeIndexStream(const unsigned char * data, size_t size, unsigned short * out_indices, size_t count) {
+	return decodeIndices(data, size, out_indices, count);
+}
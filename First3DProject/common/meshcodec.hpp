@@ -0,0 +1,33 @@
+#ifndef MESHCODEC_HPP
+#define MESHCODEC_HPP
+
+#include <vector>
+#include <stddef.h>
+
+// Lossless compression of vertex and index streams, for the binary mesh cache.
+//
+// Vertex streams are delta coded byte by byte against the previous vertex, and transposed into byte planes :
+// bytes that barely change from one vertex to the next (exponents, high bytes of nearby values) line up and shrink
+// to 0, 2 or 4 bits each. Planes are cut into groups of 16 vertices, each plane of a group with its own bit width.
+// Index streams are deltas against the previous index, zigzag coded (small negative deltas stay small) into varints.
+// Both decoders run 16 bytes at a time with SSE2 where available, and fall back to plain C++ elsewhere.
+
+// Largest vertex stride the vertex codec handles, in bytes ; strides must be a multiple of 4.
+#define MESH_CODEC_MAX_STRIDE 64
+
+// Appends the encoding of count vertices of stride bytes each to out. Fails for a stride the codec doesn't handle.
+bool encodeVertexStream(const void * vertices, size_t count, size_t stride, std::vector<unsigned char> & out);
+
+// Decodes count vertices of stride bytes out of exactly size bytes of data.
+// Returns false, leaving out_vertices partly written, if the data is malformed or isn't that long.
+bool decodeVertexStream(const unsigned char * data, size_t size, void * out_vertices, size_t count, size_t stride);
+
+// Appends the encoding of count indices to out.
+void encodeIndexStream(const unsigned int * indices, size_t count, std::vector<unsigned char> & out);
+
+// Decodes count indices out of exactly size bytes of data, like decodeVertexStream.
+// The 16-bit flavour is for index buffers whose indices all fit, and fails on one that doesn't.
+bool decodeIndexStream(const unsigned char * data, size_t size, unsigned int * out_indices, size_t count);
+bool decodeIndexStream(const unsigned char * data, size_t size, unsigned short * out_indices, size_t count);
+
+#endif
@@ -0,0 +1,26 @@
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "meshcooker.hpp"
+#include "meshoptimizer.hpp"
+#include "meshsimplifier.hpp"
+#include "meshlets.hpp"
+#include "objparser.hpp"
+
+bool cookOBJMesh(const char * path, Mesh & mesh, OBJLoadMode mode, const MeshCookOptions & options) {
+	return loadOBJMesh(path, mesh, mode) && cookMesh(mesh, options);
+}
+
+bool cookMesh(Mesh & mesh, const MeshCookOptions & options) {
+	unsigned int threadCount = options.threadCount != 0 ? options.threadCount : defaultOBJThreadCount();
+	// Splitting vertices along creases adds some : before the vertex order is settled
+	if( options.recomputeNormals && !computeSmoothNormals(mesh, options.creaseAngle, threadCount) )
+		return false;
+	optimizeMesh(mesh); // before the rest : the levels of detail and the meshlets follow the cache-friendly order
+	const float lodRatios[] = { 0.5f, 0.25f, 0.125f };
+	generateMeshLods(mesh, lodRatios, sizeof(lodRatios) / sizeof(lodRatios[0]));
+	buildMeshlets(mesh);
+	// The levels of detail share the vertices, so their tangents come with the full mesh's
+	return !options.tangents || computeTangents(mesh, threadCount);
+}
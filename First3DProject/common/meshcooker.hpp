@@ -0,0 +1,34 @@
+#ifndef MESHCOOKER_HPP
+#define MESHCOOKER_HPP
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "objloader.hpp"
+#include "meshnormals.hpp"
+
+// Bump whenever cookOBJMesh produces something different for the same OBJ (new stages, other LOD ratios...),
+// so that the asset cooker rebuilds everything it cooked before.
+#define MESH_COOK_VERSION 1
+
+// The optional stages of cookMesh. By default the file's normals are kept (those it lacks are smoothed by the loader)
+// and there are no tangents.
+struct MeshCookOptions {
+	MeshCookOptions() : recomputeNormals(false), creaseAngle(NORMALS_SMOOTH_ALL), tangents(false), threadCount(0) {}
+
+	bool recomputeNormals; // replace every normal with a smooth one, split where faces are more than creaseAngle degrees apart
+	float creaseAngle;
+	bool tangents;         // fill Mesh::tangents, e.g. for normal mapping ; the mesh cache doesn't keep them
+	unsigned int threadCount; // of the normal and tangent stages, 0 for all cores ; e.g. 1 when meshes are cooked in parallel
+};
+
+// Every stage an OBJ file goes through before it's drawn or cached : loading and de-indexing into an indexed mesh
+// with its groups and materials, vertex cache and fetch optimization, the levels of detail and the meshlets.
+// Quantization happens when the result is written with writeMeshCache(..., MESH_CACHE_COMPRESSED).
+bool cookOBJMesh(const char * path, Mesh & mesh, OBJLoadMode mode = OBJ_LOAD_PARALLEL, const MeshCookOptions & options = MeshCookOptions());
+
+// The stages after loading, for meshes loaded some other way, e.g. with the memory or stream flavours of loadOBJMesh.
+// Fails only if a tangent or normal stage does.
+bool cookMesh(Mesh & mesh, const MeshCookOptions & options = MeshCookOptions());
+
+#endif
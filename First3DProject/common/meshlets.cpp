@@ -0,0 +1,241 @@
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "meshlets.hpp"
+#include "meshoptimizer.hpp"
+
+// Unit normal of a counter-clockwise triangle, or zero if it is degenerate.
+static glm::vec3 faceNormal(const Mesh & mesh, const unsigned int * triangle) {
+	const glm::vec3 & p0 = mesh.vertices[triangle[0]];
+	glm::vec3 normal = glm::cross(mesh.vertices[triangle[1]] - p0, mesh.vertices[triangle[2]] - p0);
+	float length = glm::length(normal);
+	return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
+
+// Bounding sphere and normal cone of the triangles of a meshlet.
+static void boundMeshlet(const Mesh & mesh, Meshlet & meshlet, const unsigned int * indices) {
+	glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+	for( unsigned int i = 0; i < meshlet.indexCount; i++ ){
+		boundsMin = glm::min(boundsMin, mesh.vertices[indices[i]]);
+		boundsMax = glm::max(boundsMax, mesh.vertices[indices[i]]);
+	}
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	meshlet.radius = 0.0f;
+	for( unsigned int i = 0; i < meshlet.indexCount; i++ )
+		meshlet.radius = std::max(meshlet.radius, glm::length(mesh.vertices[indices[i]] - meshlet.center));
+
+	// Cone around the mean of the face normals, as wide as the face furthest from it
+	glm::vec3 sum(0.0f);
+	for( unsigned int i = 0; i < meshlet.indexCount; i += 3 )
+		sum += faceNormal(mesh, indices + i);
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f; // never culls
+	float sumLength = glm::length(sum);
+	if( sumLength == 0.0f )
+		return;
+	meshlet.coneAxis = sum / sumLength;
+	float minimumDot = 1.0f;
+	for( unsigned int i = 0; i < meshlet.indexCount; i += 3 ){
+		glm::vec3 normal = faceNormal(mesh, indices + i);
+		if( normal != glm::vec3(0.0f) )
+			minimumDot = std::min(minimumDot, glm::dot(normal, meshlet.coneAxis));
+	}
+	if( minimumDot <= 0.0f )
+		return; // the normals spread over more than a half-space, some triangle always faces the camera
+	meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot); // sine of the cone's half angle
+}
+
+// The order triangles were grabbed in is poor for the vertex cache : runs Tipsify on the meshlet, numbered locally.
+// scratch has one entry per vertex of the mesh and is left as it was.
+static void optimizeMeshletCache(unsigned int * indices, unsigned int indexCount, std::vector<unsigned int> & scratch) {
+	if( indexCount > MESHLET_MAX_TRIANGLES * 3 )
+		return; // larger meshlets were asked for, keep their order
+	unsigned int original[MESHLET_MAX_TRIANGLES * 3];
+	unsigned int saved[MESHLET_MAX_TRIANGLES * 3];
+	unsigned int global[MESHLET_MAX_TRIANGLES * 3];
+	unsigned int vertexCount = 0;
+	for( unsigned int i = 0; i < indexCount; i++ ){
+		original[i] = indices[i];
+		saved[i] = scratch[indices[i]];
+		scratch[indices[i]] = 0xFFFFFFFFu;
+	}
+	for( unsigned int i = 0; i < indexCount; i++ ){
+		unsigned int v = original[i];
+		if( scratch[v] == 0xFFFFFFFFu ){
+			scratch[v] = vertexCount;
+			global[vertexCount++] = v;
+		}
+		indices[i] = scratch[v];
+	}
+	optimizeVertexCache(indices, indexCount, vertexCount);
+	for( unsigned int i = 0; i < indexCount; i++ )
+		indices[i] = global[indices[i]];
+	for( unsigned int i = indexCount; i-- > 0; )
+		scratch[original[i]] = saved[i];
+}
+
+// Grows the meshlets of one part a triangle at a time, and rewrites the part's indices in meshlet order.
+// owner and localVertex have one entry per vertex of the mesh ; localVertex is all unused on entry and on exit.
+static void buildPartMeshlets(Mesh & mesh, unsigned int partIndex, unsigned int maxVertices, unsigned int maxTriangles,
+	std::vector<unsigned int> & owner, std::vector<unsigned int> & localVertex) {
+	const MeshPart & part = mesh.parts[partIndex];
+	const unsigned int * indices = &mesh.indices[part.firstIndex];
+	unsigned int triangleCount = part.indexCount / 3;
+
+	// Triangles around each vertex of the part
+	std::vector<unsigned int> vertexOffsets;
+	for( unsigned int i = 0; i < triangleCount * 3; i++ ){
+		if( localVertex[indices[i]] == 0xFFFFFFFFu ){
+			localVertex[indices[i]] = (unsigned int)vertexOffsets.size();
+			vertexOffsets.push_back(0);
+		}
+		vertexOffsets[localVertex[indices[i]]]++;
+	}
+	unsigned int sum = 0;
+	for( size_t v = 0; v < vertexOffsets.size(); v++ ){
+		unsigned int count = vertexOffsets[v];
+		vertexOffsets[v] = sum;
+		sum += count;
+	}
+	vertexOffsets.push_back(sum);
+	std::vector<unsigned int> vertexTriangles(sum);
+	std::vector<unsigned int> fill(vertexOffsets.begin(), vertexOffsets.end() - 1);
+	for( unsigned int i = 0; i < triangleCount * 3; i++ )
+		vertexTriangles[fill[localVertex[indices[i]]]++] = i / 3;
+
+	std::vector<glm::vec3> normals(triangleCount), centroids(triangleCount);
+	for( unsigned int t = 0; t < triangleCount; t++ ){
+		normals[t] = faceNormal(mesh, indices + t * 3);
+		centroids[t] = (mesh.vertices[indices[t * 3]] + mesh.vertices[indices[t * 3 + 1]] + mesh.vertices[indices[t * 3 + 2]]) / 3.0f;
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> ordered;
+	ordered.reserve(triangleCount * 3);
+	std::vector<unsigned int> candidates;
+	unsigned int seed = 0;
+	while( ordered.size() < triangleCount * 3 ){
+		Meshlet meshlet;
+		meshlet.part = partIndex;
+		meshlet.firstIndex = part.firstIndex + (unsigned int)ordered.size();
+		meshlet.indexCount = 0;
+		unsigned int id = (unsigned int)mesh.meshlets.size();
+		unsigned int vertexCount = 0;
+		glm::vec3 normalSum(0.0f), centroidSum(0.0f);
+
+		// Start next to the previous meshlet, or else at the next triangle in the optimized order
+		unsigned int next = 0xFFFFFFFFu;
+		for( size_t c = 0; c < candidates.size() && next == 0xFFFFFFFFu; c++ )
+			if( !emitted[candidates[c]] )
+				next = candidates[c];
+		candidates.clear();
+		while( emitted[seed] )
+			seed++;
+		if( next == 0xFFFFFFFFu )
+			next = seed;
+		while( next != 0xFFFFFFFFu ){
+			emitted[next] = true;
+			meshlet.indexCount += 3;
+			normalSum += normals[next];
+			centroidSum += centroids[next];
+			for( int k = 0; k < 3; k++ ){
+				unsigned int v = indices[next * 3 + k];
+				ordered.push_back(v);
+				if( owner[v] == id )
+					continue;
+				owner[v] = id;
+				vertexCount++;
+				unsigned int local = localVertex[v];
+				for( unsigned int j = vertexOffsets[local]; j < vertexOffsets[local + 1]; j++ )
+					if( !emitted[vertexTriangles[j]] )
+						candidates.push_back(vertexTriangles[j]);
+			}
+			if( meshlet.indexCount / 3 >= maxTriangles )
+				break;
+
+			// Among the triangles touching the meshlet, the one adding the fewest vertices,
+			// then the one closest to it in position and orientation
+			glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+			glm::vec3 center = centroidSum / (float)(meshlet.indexCount / 3);
+			float spread = FLT_MIN;
+			size_t kept = 0;
+			for( size_t c = 0; c < candidates.size(); c++ ){
+				unsigned int t = candidates[c];
+				if( emitted[t] )
+					continue;
+				candidates[kept++] = t;
+				spread = std::max(spread, glm::length(centroids[t] - center));
+			}
+			candidates.resize(kept);
+			next = 0xFFFFFFFFu;
+			float bestScore = FLT_MAX;
+			for( size_t c = 0; c < candidates.size(); c++ ){
+				unsigned int t = candidates[c];
+				unsigned int added = 0;
+				for( int k = 0; k < 3; k++ )
+					added += owner[indices[t * 3 + k]] != id;
+				if( vertexCount + added > maxVertices )
+					continue;
+				float score = (float)added * 4.0f + (1.0f - glm::dot(normals[t], axis)) + glm::length(centroids[t] - center) / spread;
+				if( score < bestScore ){
+					bestScore = score;
+					next = t;
+				}
+			}
+		}
+		unsigned int * meshletIndices = &ordered[meshlet.firstIndex - part.firstIndex];
+		optimizeMeshletCache(meshletIndices, meshlet.indexCount, localVertex);
+		boundMeshlet(mesh, meshlet, meshletIndices);
+		mesh.meshlets.push_back(meshlet);
+	}
+	std::copy(ordered.begin(), ordered.end(), mesh.indices.begin() + part.firstIndex);
+	for( unsigned int i = 0; i < triangleCount * 3; i++ )
+		localVertex[ordered[i]] = 0xFFFFFFFFu;
+}
+
+void buildMeshlets(Mesh & mesh, unsigned int maxVertices, unsigned int maxTriangles) {
+	mesh.meshlets.clear();
+	std::vector<unsigned int> owner(mesh.vertices.size(), 0xFFFFFFFFu); // meshlet a vertex was last counted in
+	std::vector<unsigned int> localVertex(mesh.vertices.size(), 0xFFFFFFFFu);
+	for( size_t p = 0; p < mesh.parts.size(); p++ )
+		buildPartMeshlets(mesh, (unsigned int)p, maxVertices, maxTriangles, owner, localVertex);
+}
+
+MeshletCuller::MeshletCuller(const glm::mat4 & viewProjection, const glm::vec3 & camera)
+	: mViewProjection(viewProjection), mCamera(camera), mTested(0), mCulled(0) {
+	setModelMatrix(glm::mat4(1.0f));
+}
+
+void MeshletCuller::setModelMatrix(const glm::mat4 & model) {
+	// Planes of the clip volume -w <= x, y, z <= w, pulled back through model view projection (Gribb & Hartmann)
+	glm::mat4 m = glm::transpose(mViewProjection * model);
+	for( int i = 0; i < 3; i++ ){
+		mPlanes[i * 2 + 0] = m[3] + m[i];
+		mPlanes[i * 2 + 1] = m[3] - m[i];
+	}
+	for( int i = 0; i < 6; i++ )
+		mPlanes[i] /= glm::length(glm::vec3(mPlanes[i]));
+
+	// Facing is preserved by any transform that doesn't mirror, so the cones can be tested in model space
+	mModelCamera = glm::vec3(glm::inverse(model) * glm::vec4(mCamera, 1.0f));
+}
+
+bool MeshletCuller::isVisible(const Meshlet & meshlet) {
+	mTested++;
+	for( int i = 0; i < 6; i++ ){
+		if( glm::dot(glm::vec3(mPlanes[i]), meshlet.center) + mPlanes[i].w < -meshlet.radius ){
+			mCulled++;
+			return false;
+		}
+	}
+	glm::vec3 toCenter = meshlet.center - mModelCamera;
+	if( glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius ){
+		mCulled++;
+		return false;
+	}
+	return true;
+}
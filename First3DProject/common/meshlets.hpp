@@ -0,0 +1,43 @@
+#ifndef MESHLETS_HPP
+#define MESHLETS_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Cuts every part of the full mesh into meshlets, and computes their bounding spheres and normal cones.
+// Meshlets grow from triangle to neighbouring triangle, preferring those that share vertices and face the same way,
+// and start where the previous one stopped. The triangles of each part are reordered so that every meshlet is a range of indices.
+void buildMeshlets(Mesh & mesh, unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// Tests meshlets against the view frustum and their normal cones, in the model space of one object at a time.
+class MeshletCuller {
+public:
+	// viewProjection and camera are the frame's
+	MeshletCuller(const glm::mat4 & viewProjection, const glm::vec3 & camera);
+
+	// Brings the frustum and the camera into the model space of the next object's meshlets.
+	void setModelMatrix(const glm::mat4 & model);
+
+	// False when the meshlet is entirely off-screen, or all its triangles face away from the camera.
+	bool isVisible(const Meshlet & meshlet);
+
+	// Meshlets tested and culled since the culler was made
+	unsigned int testedCount() const { return mTested; }
+	unsigned int culledCount() const { return mCulled; }
+
+private:
+	glm::mat4 mViewProjection;
+	glm::vec3 mCamera;
+	glm::vec4 mPlanes[6];  // model space, normalized
+	glm::vec3 mModelCamera;
+	unsigned int mTested;
+	unsigned int mCulled;
+};
+
+#endif
@@ -0,0 +1,463 @@
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESHNORMALS_SSE
+#endif
+
+#include <glm/glm.hpp>
+
+#include "meshnormals.hpp"
+
+namespace {
+
+// Into how many chunks of at least minimumChunk items count items are cut, at most one per thread.
+size_t chunkCountFor(size_t count, size_t minimumChunk, unsigned int threadCount) {
+	return std::max<size_t>(1, std::min<size_t>(threadCount, count / minimumChunk));
+}
+
+// Runs function(chunk, first, last) on every chunk of [0, count), each on its own thread, and waits for them.
+template <typename Function>
+void parallelChunks(size_t count, size_t chunkCount, Function function) {
+	if( chunkCount == 1 ){
+		function((size_t)0, (size_t)0, count);
+		return;
+	}
+	std::vector<std::thread> workers;
+	for( size_t i = 0; i < chunkCount; i++ )
+		workers.push_back(std::thread([&, i](){
+			function(i, count * i / chunkCount, count * (i + 1) / chunkCount);
+		}));
+	for( size_t i = 0; i < chunkCount; i++ )
+		workers[i].join();
+}
+
+// Runs function(first, last) on [0, count) cut into at most threadCount chunks of at least minimumChunk items.
+template <typename Function>
+void parallelFor(size_t count, size_t minimumChunk, unsigned int threadCount, Function function) {
+	parallelChunks(count, chunkCountFor(count, minimumChunk, threadCount), [&](size_t, size_t first, size_t last){
+		function(first, last);
+	});
+}
+
+inline unsigned int vertexOf(const unsigned int * indices, size_t corner) {
+	return indices ? indices[corner] : (unsigned int)corner;
+}
+
+// remap[v] is the first vertex at exactly the same position as v.
+void weldPositions(const glm::vec3 * positions, size_t vertexCount, std::vector<unsigned int> & remap) {
+	size_t capacity = 64;
+	while( capacity < vertexCount * 2 )
+		capacity *= 2;
+	const unsigned int empty = 0xFFFFFFFFu;
+	std::vector<unsigned int> table(capacity, empty);
+	size_t mask = capacity - 1;
+	remap.resize(vertexCount);
+	for( size_t v = 0; v < vertexCount; v++ ){
+		glm::vec3 position = positions[v] + glm::vec3(0.0f); // -0 and +0 are the same place
+		uint32_t bits[3];
+		memcpy(bits, &position, sizeof(bits));
+		uint64_t h = bits[0] * 0x9E3779B97F4A7C15ull ^ bits[1] * 0xC2B2AE3D27D4EB4Full ^ bits[2] * 0x165667B19E3779F9ull;
+		h ^= h >> 29;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 32;
+		for( size_t i = (size_t)h & mask; ; i = (i + 1) & mask ){
+			if( table[i] == empty ){
+				table[i] = (unsigned int)v;
+				remap[v] = (unsigned int)v;
+				break;
+			}
+			glm::vec3 other = positions[table[i]] + glm::vec3(0.0f);
+			if( memcmp(&other, &position, sizeof(position)) == 0 ){
+				remap[v] = table[i];
+				break;
+			}
+		}
+	}
+}
+
+// acos to within 7e-5 radians (Abramowitz & Stegun 4.4.45), plenty for a weight.
+inline float approximateAcos(float x) {
+	x = std::max(-1.0f, std::min(1.0f, x));
+	float a = std::fabs(x);
+	float r = std::sqrt(1.0f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f + a * -0.0187293f)));
+	return x < 0.0f ? 3.14159265f - r : r;
+}
+
+#ifdef MESHNORMALS_SSE
+inline __m128 approximateAcos4(__m128 x) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	x = _mm_max_ps(_mm_min_ps(x, one), _mm_set1_ps(-1.0f));
+	__m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+	__m128 a = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+	__m128 poly = _mm_add_ps(_mm_set1_ps(0.0742610f), _mm_mul_ps(a, _mm_set1_ps(-0.0187293f)));
+	poly = _mm_add_ps(_mm_set1_ps(-0.2121144f), _mm_mul_ps(a, poly));
+	poly = _mm_add_ps(_mm_set1_ps(1.5707288f), _mm_mul_ps(a, poly));
+	__m128 r = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(one, a)), poly);
+	return _mm_or_ps(_mm_andnot_ps(negative, r), _mm_and_ps(negative, _mm_sub_ps(_mm_set1_ps(3.14159265f), r)));
+}
+
+inline __m128 dot4(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) {
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+#endif
+
+// Angle of every corner of the triangle p0 p1 p2
+inline glm::vec3 cornerAngles(const glm::vec3 & p0, const glm::vec3 & p1, const glm::vec3 & p2) {
+	glm::vec3 e1 = p1 - p0, e2 = p2 - p0, e3 = p2 - p1;
+	float l1 = glm::length(e1), l2 = glm::length(e2), l3 = glm::length(e3);
+	return glm::vec3(
+		approximateAcos(glm::dot(e1, e2) / std::max(l1 * l2, FLT_MIN)),
+		approximateAcos(-glm::dot(e1, e3) / std::max(l1 * l3, FLT_MIN)),
+		approximateAcos(glm::dot(e2, e3) / std::max(l2 * l3, FLT_MIN)));
+}
+
+// For the triangles [first, last), writes the weighted normal of every corner : the face normal, as long as twice
+// the face's area, times the corner's angle. faces, when not NULL, receives the unit normal of every face.
+// Both are written from their start : corners[0] is the first corner of triangle first.
+void weightCorners(const unsigned int * indices, const glm::vec3 * positions, size_t first, size_t last, glm::vec3 * corners, glm::vec3 * faces) {
+	size_t t = first;
+#ifdef MESHNORMALS_SSE
+	for( ; t + 4 <= last; t += 4 ){
+		// Four triangles side by side, one per lane
+		const glm::vec3 * p[3][4];
+		for( int j = 0; j < 4; j++ )
+			for( int k = 0; k < 3; k++ )
+				p[k][j] = &positions[vertexOf(indices, (t + j) * 3 + k)];
+		__m128 x0 = _mm_setr_ps(p[0][0]->x, p[0][1]->x, p[0][2]->x, p[0][3]->x);
+		__m128 y0 = _mm_setr_ps(p[0][0]->y, p[0][1]->y, p[0][2]->y, p[0][3]->y);
+		__m128 z0 = _mm_setr_ps(p[0][0]->z, p[0][1]->z, p[0][2]->z, p[0][3]->z);
+		__m128 x1 = _mm_setr_ps(p[1][0]->x, p[1][1]->x, p[1][2]->x, p[1][3]->x);
+		__m128 y1 = _mm_setr_ps(p[1][0]->y, p[1][1]->y, p[1][2]->y, p[1][3]->y);
+		__m128 z1 = _mm_setr_ps(p[1][0]->z, p[1][1]->z, p[1][2]->z, p[1][3]->z);
+		__m128 x2 = _mm_setr_ps(p[2][0]->x, p[2][1]->x, p[2][2]->x, p[2][3]->x);
+		__m128 y2 = _mm_setr_ps(p[2][0]->y, p[2][1]->y, p[2][2]->y, p[2][3]->y);
+		__m128 z2 = _mm_setr_ps(p[2][0]->z, p[2][1]->z, p[2][2]->z, p[2][3]->z);
+		__m128 e1x = _mm_sub_ps(x1, x0), e1y = _mm_sub_ps(y1, y0), e1z = _mm_sub_ps(z1, z0);
+		__m128 e2x = _mm_sub_ps(x2, x0), e2y = _mm_sub_ps(y2, y0), e2z = _mm_sub_ps(z2, z0);
+		__m128 e3x = _mm_sub_ps(x2, x1), e3y = _mm_sub_ps(y2, y1), e3z = _mm_sub_ps(z2, z1);
+		__m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+		__m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+		__m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+		__m128 l1 = _mm_sqrt_ps(dot4(e1x, e1y, e1z, e1x, e1y, e1z));
+		__m128 l2 = _mm_sqrt_ps(dot4(e2x, e2y, e2z, e2x, e2y, e2z));
+		__m128 l3 = _mm_sqrt_ps(dot4(e3x, e3y, e3z, e3x, e3y, e3z));
+		const __m128 tiny = _mm_set1_ps(FLT_MIN);
+		__m128 w[3];
+		w[0] = approximateAcos4(_mm_div_ps(dot4(e1x, e1y, e1z, e2x, e2y, e2z), _mm_max_ps(_mm_mul_ps(l1, l2), tiny)));
+		w[1] = approximateAcos4(_mm_div_ps(_mm_sub_ps(_mm_setzero_ps(), dot4(e1x, e1y, e1z, e3x, e3y, e3z)), _mm_max_ps(_mm_mul_ps(l1, l3), tiny)));
+		w[2] = approximateAcos4(_mm_div_ps(dot4(e2x, e2y, e2z, e3x, e3y, e3z), _mm_max_ps(_mm_mul_ps(l2, l3), tiny)));
+		float x[3][4], y[3][4], z[3][4];
+		for( int k = 0; k < 3; k++ ){
+			_mm_storeu_ps(x[k], _mm_mul_ps(nx, w[k]));
+			_mm_storeu_ps(y[k], _mm_mul_ps(ny, w[k]));
+			_mm_storeu_ps(z[k], _mm_mul_ps(nz, w[k]));
+		}
+		for( int j = 0; j < 4; j++ )
+			for( int k = 0; k < 3; k++ )
+				corners[(t + j - first) * 3 + k] = glm::vec3(x[k][j], y[k][j], z[k][j]);
+		if( faces ){
+			__m128 length = _mm_sqrt_ps(dot4(nx, ny, nz, nx, ny, nz));
+			__m128 scale = _mm_and_ps(_mm_cmpgt_ps(length, _mm_setzero_ps()), _mm_div_ps(_mm_set1_ps(1.0f), length));
+			_mm_storeu_ps(x[0], _mm_mul_ps(nx, scale));
+			_mm_storeu_ps(y[0], _mm_mul_ps(ny, scale));
+			_mm_storeu_ps(z[0], _mm_mul_ps(nz, scale));
+			for( int j = 0; j < 4; j++ )
+				faces[t + j - first] = glm::vec3(x[0][j], y[0][j], z[0][j]);
+		}
+	}
+#endif
+	for( ; t < last; t++ ){
+		const glm::vec3 & p0 = positions[vertexOf(indices, t * 3)];
+		const glm::vec3 & p1 = positions[vertexOf(indices, t * 3 + 1)];
+		const glm::vec3 & p2 = positions[vertexOf(indices, t * 3 + 2)];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		glm::vec3 angles = cornerAngles(p0, p1, p2);
+		for( int k = 0; k < 3; k++ )
+			corners[(t - first) * 3 + k] = normal * angles[k];
+		if( faces ){
+			float length = glm::length(normal);
+			faces[t - first] = length > 0.0f ? normal * (1.0f / length) : glm::vec3(0.0f);
+		}
+	}
+}
+
+// The tangent and bitangent a corner adds to its vertex
+struct TangentPair {
+	glm::vec3 tangent, bitangent;
+	TangentPair() : tangent(0.0f), bitangent(0.0f) {}
+	TangentPair & operator+=(const TangentPair & other) { tangent += other.tangent; bitangent += other.bitangent; return *this; }
+};
+
+// Sums the values of all corners of triangleCount triangles, starting from zero, into out_sums, per vertex : corner c goes to
+// remap[vertexOf(indices, c)] (or just its vertex when remap is NULL). produce(first, last, values) writes the values of
+// the triangles [first, last), at most cornerBlock / 3 of them at a time.
+// Every chunk of triangles sums into its own span of the vertices it touches, and the spans are added up per vertex
+// afterwards, so that no two threads write the same sum. Optimized meshes use their vertices roughly in order, so the spans
+// hardly overlap : the memory needed stays close to one sum per vertex, and there are no per corner arrays to go through.
+template <typename Value, typename Produce>
+void accumulateCorners(
+	const unsigned int * indices, size_t triangleCount, const unsigned int * remap,
+	const Value & zero, Value * out_sums, size_t vertexCount, unsigned int threadCount, Produce produce
+){
+	const size_t cornerBlock = 192;
+	size_t chunkCount = chunkCountFor(triangleCount, 1 << 14, threadCount);
+	std::vector<size_t> spanFirst(chunkCount, 0);
+	std::vector<std::vector<Value> > spans(chunkCount);
+	parallelChunks(triangleCount, chunkCount, [&](size_t chunk, size_t first, size_t last){
+		size_t low = vertexCount, high = 0;
+		for( size_t c = first * 3; c < last * 3; c++ ){
+			size_t v = remap ? remap[vertexOf(indices, c)] : vertexOf(indices, c);
+			low = std::min(low, v);
+			high = std::max(high, v);
+		}
+		if( low > high )
+			return;
+		std::vector<Value> & sums = spans[chunk];
+		sums.assign(high - low + 1, zero);
+		spanFirst[chunk] = low;
+		Value values[cornerBlock];
+		for( size_t t = first; t < last; t += cornerBlock / 3 ){
+			size_t end = std::min(last, t + cornerBlock / 3);
+			produce(t, end, values);
+			for( size_t c = t * 3; c < end * 3; c++ )
+				sums[(remap ? remap[vertexOf(indices, c)] : vertexOf(indices, c)) - low] += values[c - t * 3];
+		}
+	});
+	parallelFor(vertexCount, 1 << 16, threadCount, [&](size_t first, size_t last){
+		for( size_t v = first; v < last; v++ ){
+			Value sum = zero;
+			for( size_t chunk = 0; chunk < chunkCount; chunk++ )
+				if( v - spanFirst[chunk] < spans[chunk].size() )
+					sum += spans[chunk][v - spanFirst[chunk]];
+			out_sums[v] = sum;
+		}
+	});
+}
+
+// Normalizes vectors in place. Zero vectors become (0, 0, 1).
+void normalizeAll(glm::vec3 * vectors, size_t count, unsigned int threadCount) {
+	parallelFor(count, 1 << 16, threadCount, [&](size_t first, size_t last){
+		size_t v = first;
+#ifdef MESHNORMALS_SSE
+		for( ; v + 4 <= last; v += 4 ){
+			// 4 vectors are 3 registers : xyzx yzxy zxyz
+			float * p = &vectors[v].x;
+			__m128 x = _mm_setr_ps(p[0], p[3], p[6], p[9]);
+			__m128 y = _mm_setr_ps(p[1], p[4], p[7], p[10]);
+			__m128 z = _mm_setr_ps(p[2], p[5], p[8], p[11]);
+			__m128 lengthSquared = dot4(x, y, z, x, y, z);
+			__m128 nonZero = _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps());
+			__m128 scale = _mm_and_ps(nonZero, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSquared)));
+			_mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(1, 0, 0, 0))));
+			_mm_storeu_ps(p + 4, _mm_mul_ps(_mm_loadu_ps(p + 4), _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(2, 2, 1, 1))));
+			_mm_storeu_ps(p + 8, _mm_mul_ps(_mm_loadu_ps(p + 8), _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(3, 3, 3, 2))));
+			int mask = _mm_movemask_ps(nonZero);
+			for( int j = 0; mask != 0xF && j < 4; j++ )
+				if( !(mask & (1 << j)) )
+					vectors[v + j] = glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+#endif
+		for( ; v < last; v++ ){
+			float length = glm::length(vectors[v]);
+			vectors[v] = length > 0.0f ? vectors[v] * (1.0f / length) : glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+	});
+}
+
+} // namespace
+
+size_t fullMeshIndexCount(const Mesh & mesh) {
+	if( mesh.indices.empty() )
+		return mesh.vertices.size();
+	if( mesh.lods.empty() )
+		return mesh.indices.size();
+	size_t count = 0;
+	for( size_t p = 0; p < mesh.parts.size(); p++ )
+		count = std::max<size_t>(count, mesh.parts[p].firstIndex + mesh.parts[p].indexCount);
+	return count;
+}
+
+void computeSmoothNormals(
+	const unsigned int * indices, size_t indexCount,
+	const glm::vec3 * positions, size_t vertexCount,
+	glm::vec3 * out_normals,
+	unsigned int threadCount
+){
+	size_t triangleCount = indexCount / 3;
+	std::vector<unsigned int> remap;
+	weldPositions(positions, vertexCount, remap);
+
+	accumulateCorners(indices, triangleCount, remap.data(), glm::vec3(0.0f), out_normals, vertexCount, threadCount, [&](size_t first, size_t last, glm::vec3 * corners){
+		weightCorners(indices, positions, first, last, corners, NULL);
+	});
+	normalizeAll(out_normals, vertexCount, threadCount);
+
+	// Vertices welded to an earlier one take its normal ; that one is never a copy itself
+	parallelFor(vertexCount, 1 << 16, threadCount, [&](size_t first, size_t last){
+		for( size_t v = first; v < last; v++ )
+			if( remap[v] != v )
+				out_normals[v] = out_normals[remap[v]];
+	});
+}
+
+bool computeSmoothNormals(Mesh & mesh, float creaseAngle, unsigned int threadCount) {
+	if( !mesh.lods.empty() ){
+		printf("Normals have to be computed before the levels of detail\n");
+		return false;
+	}
+	const unsigned int * indices = mesh.indices.empty() ? NULL : &mesh.indices[0];
+	size_t indexCount = fullMeshIndexCount(mesh);
+	size_t vertexCount = mesh.vertices.size();
+	mesh.tangents.clear();
+	mesh.normals.assign(vertexCount, glm::vec3(0.0f, 0.0f, 1.0f));
+	if( creaseAngle >= NORMALS_SMOOTH_ALL ){
+		computeSmoothNormals(indices, indexCount, mesh.vertices.data(), vertexCount, mesh.normals.data(), threadCount);
+		return true;
+	}
+
+	size_t triangleCount = indexCount / 3;
+	std::vector<unsigned int> remap;
+	weldPositions(mesh.vertices.data(), vertexCount, remap);
+	std::vector<glm::vec3> corners(indexCount), faces(triangleCount);
+	std::vector<unsigned int> targets(indexCount);
+	parallelFor(triangleCount, 1 << 14, threadCount, [&](size_t first, size_t last){
+		weightCorners(indices, mesh.vertices.data(), first, last, &corners[first * 3], &faces[first]);
+		for( size_t c = first * 3; c < last * 3; c++ )
+			targets[c] = remap[vertexOf(indices, c)];
+	});
+
+	// Corners around each position
+	std::vector<unsigned int> offsets(vertexCount + 1, 0), around(indexCount);
+	for( size_t c = 0; c < indexCount; c++ )
+		offsets[targets[c] + 1]++;
+	for( size_t v = 0; v < vertexCount; v++ )
+		offsets[v + 1] += offsets[v];
+	{
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for( size_t c = 0; c < indexCount; c++ )
+			around[fill[targets[c]]++] = (unsigned int)c;
+	}
+
+	// Every corner smooths with the corners around its position whose faces are within the crease angle of its own.
+	// Corners that agree on which faces those are add them in the same order, so they get bit-identical normals.
+	float creaseCosine = std::cos(glm::radians(creaseAngle));
+	std::vector<glm::vec3> cornerNormals(indexCount);
+	parallelFor(indexCount, 1 << 16, threadCount, [&](size_t first, size_t last){
+		for( size_t c = first; c < last; c++ ){
+			const glm::vec3 & face = faces[c / 3];
+			bool degenerate = face == glm::vec3(0.0f);
+			glm::vec3 sum(0.0f);
+			for( unsigned int j = offsets[targets[c]]; j < offsets[targets[c] + 1]; j++ ){
+				unsigned int d = around[j];
+				if( degenerate || glm::dot(face, faces[d / 3]) >= creaseCosine )
+					sum += corners[d];
+			}
+			cornerNormals[c] = sum;
+		}
+	});
+	normalizeAll(cornerNormals.data(), indexCount, threadCount);
+	if( indices == NULL ){
+		std::copy(cornerNormals.begin(), cornerNormals.end(), mesh.normals.begin());
+		return true;
+	}
+
+	// A vertex keeps the normal of its first corner, corners that disagree move to a copy of it with their own
+	const unsigned int none = 0xFFFFFFFFu;
+	std::vector<unsigned int> nextCopy(vertexCount, none);
+	std::vector<char> assigned(vertexCount, 0);
+	size_t firstCopy = vertexCount;
+	for( size_t c = 0; c < indexCount; c++ ){
+		unsigned int v = mesh.indices[c];
+		if( !assigned[v] ){
+			assigned[v] = 1;
+			mesh.normals[v] = cornerNormals[c];
+			continue;
+		}
+		unsigned int copy = v, previous = v;
+		while( copy != none && mesh.normals[copy] != cornerNormals[c] ){
+			previous = copy;
+			copy = nextCopy[copy];
+		}
+		if( copy == none ){
+			copy = (unsigned int)mesh.vertices.size();
+			glm::vec3 position = mesh.vertices[v];
+			mesh.vertices.push_back(position);
+			if( !mesh.uvs.empty() ){
+				glm::vec2 uv = mesh.uvs[v];
+				mesh.uvs.push_back(uv);
+			}
+			mesh.normals.push_back(cornerNormals[c]);
+			nextCopy.push_back(none);
+			nextCopy[previous] = copy;
+		}
+		mesh.indices[c] = copy;
+	}
+	printf("Smoothed normals up to %.0f degrees, %u vertices split along creases\n", creaseAngle, (unsigned int)(mesh.vertices.size() - firstCopy));
+	return true;
+}
+
+bool computeTangents(Mesh & mesh, unsigned int threadCount) {
+	size_t vertexCount = mesh.vertices.size();
+	if( mesh.uvs.size() != vertexCount || mesh.normals.size() != vertexCount ){
+		printf("Tangents need UVs and normals\n");
+		return false;
+	}
+	const unsigned int * indices = mesh.indices.empty() ? NULL : &mesh.indices[0];
+	size_t indexCount = fullMeshIndexCount(mesh);
+	size_t triangleCount = indexCount / 3;
+
+	// The face tangent and bitangent are the directions of increasing u and v. Every corner projects the tangent
+	// on the plane of its vertex normal, and weights both by its angle.
+	std::vector<TangentPair> sums(vertexCount);
+	accumulateCorners(indices, triangleCount, (const unsigned int *)NULL, TangentPair(), sums.data(), vertexCount, threadCount, [&](size_t first, size_t last, TangentPair * corners){
+		for( size_t t = first; t < last; t++ ){
+			unsigned int v[3] = { vertexOf(indices, t * 3), vertexOf(indices, t * 3 + 1), vertexOf(indices, t * 3 + 2) };
+			const glm::vec3 & p0 = mesh.vertices[v[0]];
+			glm::vec3 e1 = mesh.vertices[v[1]] - p0, e2 = mesh.vertices[v[2]] - p0;
+			glm::vec2 d1 = mesh.uvs[v[1]] - mesh.uvs[v[0]], d2 = mesh.uvs[v[2]] - mesh.uvs[v[0]];
+			float determinant = d1.x * d2.y - d2.x * d1.y;
+			glm::vec3 tangent(0.0f), bitangent(0.0f);
+			if( std::fabs(determinant) > FLT_MIN ){
+				float r = 1.0f / determinant;
+				tangent = (e1 * d2.y - e2 * d1.y) * r;
+				bitangent = (e2 * d1.x - e1 * d2.x) * r;
+			}
+			glm::vec3 angles = cornerAngles(p0, mesh.vertices[v[1]], mesh.vertices[v[2]]);
+			for( int k = 0; k < 3; k++ ){
+				const glm::vec3 & normal = mesh.normals[v[k]];
+				glm::vec3 projected = tangent - normal * glm::dot(normal, tangent);
+				float length = glm::length(projected);
+				TangentPair & corner = corners[(t - first) * 3 + k];
+				corner.tangent = length > 0.0f ? projected * (angles[k] / length) : glm::vec3(0.0f);
+				corner.bitangent = bitangent * angles[k];
+			}
+		}
+	});
+
+	mesh.tangents.resize(vertexCount);
+	parallelFor(vertexCount, 1 << 16, threadCount, [&](size_t first, size_t last){
+		for( size_t v = first; v < last; v++ ){
+			const glm::vec3 & normal = mesh.normals[v];
+			// Gram-Schmidt : the sum is only in the tangent plane up to rounding
+			glm::vec3 tangent = sums[v].tangent - normal * glm::dot(normal, sums[v].tangent);
+			float length = glm::length(tangent);
+			if( length < 1e-6f ){
+				// No UV gradient here (or it is along the normal) : any direction in the tangent plane will do
+				tangent = glm::cross(normal, std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+				length = glm::length(tangent);
+			}
+			tangent = length > 0.0f ? tangent * (1.0f / length) : glm::vec3(1.0f, 0.0f, 0.0f);
+			float sign = glm::dot(glm::cross(normal, tangent), sums[v].bitangent) < 0.0f ? -1.0f : 1.0f;
+			mesh.tangents[v] = glm::vec4(tangent, sign);
+		}
+	});
+	return true;
+}
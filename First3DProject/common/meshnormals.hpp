@@ -0,0 +1,43 @@
+#ifndef MESHNORMALS_HPP
+#define MESHNORMALS_HPP
+
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// Normals and tangent frames for meshes that come without them, e.g. scans.
+// The face normal weights and the normalization run 4 triangles or vertices at a time with SSE where available.
+// Adding the weighted normals into their vertices is a scalar scatter : SSE and AVX2 have no scatter store, and
+// the vertices of 4 neighbouring corners often collide. Every pass is split into chunks of faces or vertices over threadCount threads.
+// cookMesh runs them on request, see MeshCookOptions.
+
+// Crease angle, in degrees, that smooths every face with its neighbours
+#define NORMALS_SMOOTH_ALL 180.0f
+
+// Corners of the triangles that the full mesh, not its levels of detail, is made of :
+// its vertex count when it has no indices, else the indices its parts cover.
+size_t fullMeshIndexCount(const Mesh & mesh);
+
+// Smooth normals of a triangle list, given by indices or, when indices is NULL, as plain consecutive triangles.
+// Each face adds its normal to its corners weighted by its area and by the corner's angle. Vertices at the same
+// position share their normal, even across UV seams. Vertices that no triangle uses get (0, 0, 1).
+void computeSmoothNormals(
+	const unsigned int * indices, size_t indexCount,
+	const glm::vec3 * positions, size_t vertexCount,
+	glm::vec3 * out_normals,
+	unsigned int threadCount = 1
+);
+
+// Same for a mesh, except that faces more than creaseAngle degrees apart aren't smoothed together :
+// the vertices along a crease are split, one per side. The triangles and their order don't change.
+// Call it before generateMeshLods, so that only the full mesh is smoothed. Drops mesh.tangents.
+bool computeSmoothNormals(Mesh & mesh, float creaseAngle = NORMALS_SMOOTH_ALL, unsigned int threadCount = 1);
+
+// Fills mesh.tangents, with the MikkTSpace conventions : per vertex, the angle weighted sum of the face tangents
+// projected on the plane of the vertex normal, orthonormalized, and the sign of the bitangent (cross(normal, tangent) * w) in w.
+// The mesh needs UVs and normals.
+bool computeTangents(Mesh & mesh, unsigned int threadCount = 1);
+
+#endif
@@ -0,0 +1,174 @@
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "meshoptimizer.hpp"
+
+VertexCacheStats analyzeVertexCache(const unsigned int * indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+	// A vertex is in the cache while fewer than cacheSize misses happened since its own
+	std::vector<size_t> missTime(vertexCount, 0);
+	std::vector<char> used(vertexCount, 0);
+	size_t misses = 0, unique = 0;
+	for( size_t i = 0; i < indexCount; i++ ){
+		unsigned int v = indices[i];
+		if( !used[v] ){
+			used[v] = 1;
+			unique++;
+		}
+		if( missTime[v] == 0 || misses + 1 - missTime[v] > cacheSize )
+			missTime[v] = ++misses;
+	}
+	VertexCacheStats stats;
+	stats.acmr = indexCount >= 3 ? (float)misses / (indexCount / 3) : 0.0f;
+	stats.atvr = unique > 0 ? (float)misses / unique : 0.0f;
+	return stats;
+}
+
+void optimizeVertexCache(unsigned int * indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+	size_t triangleCount = indexCount / 3;
+	if( triangleCount == 0 )
+		return;
+
+	// Triangles around each vertex, in compressed rows
+	std::vector<unsigned int> firstTriangle(vertexCount + 1, 0);
+	for( size_t i = 0; i < triangleCount * 3; i++ )
+		firstTriangle[indices[i] + 1]++;
+	for( size_t v = 0; v < vertexCount; v++ )
+		firstTriangle[v + 1] += firstTriangle[v];
+	std::vector<unsigned int> live(vertexCount); // triangles around the vertex not emitted yet
+	for( size_t v = 0; v < vertexCount; v++ )
+		live[v] = firstTriangle[v + 1] - firstTriangle[v];
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	{
+		std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for( size_t i = 0; i < triangleCount * 3; i++ )
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<unsigned int> deadEnd;     // recently touched vertices, to restart from when the fan runs dry
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	unsigned int time = cacheSize + 1;
+	size_t scan = 0; // next vertex to try when everything else is dead
+
+	// Start from the first vertex of the first triangle, like the file does
+	long fan = indices[0];
+	while( fan >= 0 ){
+		// Emit every triangle left around the fanning vertex
+		candidates.clear();
+		for( unsigned int a = firstTriangle[fan]; a < firstTriangle[fan + 1]; a++ ){
+			unsigned int t = adjacency[a];
+			if( emitted[t] )
+				continue;
+			emitted[t] = 1;
+			for( int k = 0; k < 3; k++ ){
+				unsigned int v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if( time - cacheTime[v] > cacheSize )
+					cacheTime[v] = time++;
+			}
+		}
+
+		// Next fan : the candidate still in the cache that will stay there the longest once its triangles are emitted
+		long next = -1;
+		unsigned int bestPriority = 0;
+		for( size_t c = 0; c < candidates.size(); c++ ){
+			unsigned int v = candidates[c];
+			if( live[v] == 0 )
+				continue;
+			unsigned int priority = 0;
+			if( time - cacheTime[v] + 2 * live[v] <= cacheSize )
+				priority = time - cacheTime[v];
+			if( next < 0 || priority > bestPriority ){
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		// Dead end : go back to a recently used vertex, or to the next vertex with triangles left
+		while( next < 0 && !deadEnd.empty() ){
+			unsigned int v = deadEnd.back();
+			deadEnd.pop_back();
+			if( live[v] > 0 )
+				next = v;
+		}
+		for( ; next < 0 && scan < vertexCount; scan++ )
+			if( live[scan] > 0 )
+				next = (long)scan;
+		fan = next;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(Mesh & mesh) {
+	const unsigned int unassigned = 0xFFFFFFFFu;
+	std::vector<unsigned int> remap(mesh.vertices.size(), unassigned);
+	unsigned int next = 0;
+	for( size_t i = 0; i < mesh.indices.size(); i++ ){
+		unsigned int & index = mesh.indices[i];
+		if( remap[index] == unassigned )
+			remap[index] = next++;
+		index = remap[index];
+	}
+
+	std::vector<glm::vec3> vertices(next), normals(next);
+	std::vector<glm::vec2> uvs(next);
+	std::vector<glm::vec4> tangents(mesh.tangents.empty() ? 0 : next);
+	for( size_t v = 0; v < remap.size(); v++ ){
+		if( remap[v] == unassigned )
+			continue;
+		vertices[remap[v]] = mesh.vertices[v];
+		uvs[remap[v]] = mesh.uvs[v];
+		normals[remap[v]] = mesh.normals[v];
+		if( !tangents.empty() )
+			tangents[remap[v]] = mesh.tangents[v];
+	}
+	mesh.vertices.swap(vertices);
+	mesh.uvs.swap(uvs);
+	mesh.normals.swap(normals);
+	mesh.tangents.swap(tangents);
+}
+
+void optimizeMesh(Mesh & mesh) {
+	if( mesh.indices.empty() )
+		return;
+
+	// Each part is optimized on its own, with its vertices numbered locally so the work stays proportional to the part
+	std::vector<MeshPart> parts = mesh.parts;
+	if( parts.empty() ){
+		MeshPart all = { MESH_NO_MATERIAL, 0, (unsigned int)mesh.indices.size() };
+		parts.push_back(all);
+	}
+	const unsigned int unassigned = 0xFFFFFFFFu;
+	std::vector<unsigned int> local(mesh.vertices.size(), unassigned);
+	std::vector<unsigned int> global;
+	std::vector<unsigned int> partIndices;
+	for( size_t p = 0; p < parts.size(); p++ ){
+		unsigned int * indices = &mesh.indices[parts[p].firstIndex];
+		size_t count = parts[p].indexCount;
+		global.clear();
+		partIndices.resize(count);
+		for( size_t i = 0; i < count; i++ ){
+			if( local[indices[i]] == unassigned ){
+				local[indices[i]] = (unsigned int)global.size();
+				global.push_back(indices[i]);
+			}
+			partIndices[i] = local[indices[i]];
+		}
+		optimizeVertexCache(count ? &partIndices[0] : NULL, count, global.size());
+		for( size_t i = 0; i < count; i++ )
+			indices[i] = global[partIndices[i]];
+		for( size_t v = 0; v < global.size(); v++ )
+			local[global[v]] = unassigned;
+	}
+
+	optimizeVertexFetch(mesh);
+}
@@ -0,0 +1,32 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include <stddef.h>
+
+#include "mesh.hpp"
+
+// Post-transform vertex cache and vertex fetch optimization of indexed triangle lists.
+
+// Size of the FIFO the GPU is assumed to keep transformed vertices in.
+#define VERTEX_CACHE_SIZE 16
+
+struct VertexCacheStats {
+	float acmr; // average cache miss ratio : vertex shader runs per triangle, 0.5 at best, 3 at worst
+	float atvr; // average transform to vertex ratio : vertex shader runs per vertex, 1 at best
+};
+
+// Simulates a FIFO cache of cacheSize vertices over the triangles.
+VertexCacheStats analyzeVertexCache(const unsigned int * indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders the triangles so that consecutive ones share vertices (Tipsify, Sander et al. 2007). Linear time.
+void optimizeVertexCache(unsigned int * indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Renumbers the vertices in the order the triangles first use them, so that fetches walk the buffers forward.
+// Unused vertices are dropped.
+void optimizeVertexFetch(Mesh & mesh);
+
+// Both of the above for a loaded mesh : the triangles are reordered within each part, so the parts and groups stay valid.
+// The analyzer tool reports the ACMR and ATVR it gets to (with --cook) and started from (without).
+void optimizeMesh(Mesh & mesh);
+
+#endif
@@ -0,0 +1,301 @@
+#include <vector>
+#include <stdint.h>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "meshsimplifier.hpp"
+#include "meshoptimizer.hpp"
+
+namespace {
+
+// Sum of squared distances to a set of planes, weighted by the area of the triangles they come from.
+struct Quadric {
+	double a2, b2, c2, d2, ab, ac, ad, bc, bd, cd;
+	double weight;
+
+	void clear() { memset(this, 0, sizeof(*this)); }
+
+	void addPlane(const glm::dvec3 & normal, double d, double area) {
+		a2 += area * normal.x * normal.x; b2 += area * normal.y * normal.y; c2 += area * normal.z * normal.z; d2 += area * d * d;
+		ab += area * normal.x * normal.y; ac += area * normal.x * normal.z; ad += area * normal.x * d;
+		bc += area * normal.y * normal.z; bd += area * normal.y * d; cd += area * normal.z * d;
+		weight += area;
+	}
+
+	void add(const Quadric & other) {
+		a2 += other.a2; b2 += other.b2; c2 += other.c2; d2 += other.d2;
+		ab += other.ab; ac += other.ac; ad += other.ad; bc += other.bc; bd += other.bd; cd += other.cd;
+		weight += other.weight;
+	}
+
+	// Mean squared distance of p to the planes
+	double error(const glm::vec3 & p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double sum = a2 * x * x + b2 * y * y + c2 * z * z + d2
+			+ 2.0 * (ab * x * y + ac * x * z + ad * x + bc * y * z + bd * y + cd * z);
+		return weight > 0.0 ? std::fabs(sum) / weight : 0.0;
+	}
+};
+
+struct Collapse {
+	unsigned int from, to;
+	double cost;
+	bool operator<(const Collapse & other) const { return cost < other.cost; }
+};
+
+uint64_t edgeKey(unsigned int a, unsigned int b) {
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+// Bit pattern of a position, to find vertices that only differ by their UV or normal
+uint64_t positionKey(const glm::vec3 & p) {
+	uint32_t bits[3];
+	memcpy(bits, &p[0], sizeof(bits));
+	return ((uint64_t)bits[0] * 73856093u) ^ ((uint64_t)bits[1] * 19349663u << 16) ^ ((uint64_t)bits[2] * 83492791u << 32);
+}
+
+} // namespace
+
+float simplifyIndices(
+	const unsigned int * indices,
+	size_t indexCount,
+	const glm::vec3 * positions,
+	size_t vertexCount,
+	size_t targetIndexCount,
+	std::vector<unsigned int> & out_indices
+){
+	out_indices.assign(indices, indices + indexCount);
+	if( indexCount <= targetIndexCount )
+		return 0.0f;
+
+	// Vertices that share a position are one point of the surface : number the points
+	std::vector<unsigned int> point(vertexCount);
+	std::vector<unsigned int> wedges; // vertices per point
+	{
+		std::unordered_multimap<uint64_t, unsigned int> byPosition;
+		byPosition.reserve(vertexCount);
+		for( size_t v = 0; v < vertexCount; v++ ){
+			uint64_t key = positionKey(positions[v]);
+			unsigned int found = (unsigned int)-1;
+			auto range = byPosition.equal_range(key);
+			for( auto it = range.first; it != range.second && found == (unsigned int)-1; ++it )
+				if( positions[it->second] == positions[v] )
+					found = point[it->second];
+			if( found == (unsigned int)-1 ){
+				found = (unsigned int)wedges.size();
+				wedges.push_back(0);
+				byPosition.insert(std::make_pair(key, (unsigned int)v));
+			}
+			point[v] = found;
+			wedges[found]++;
+		}
+	}
+
+	// Seams and open borders are locked : an edge between two points used by a single triangle is a border
+	std::vector<char> locked(vertexCount, 0);
+	{
+		std::unordered_map<uint64_t, unsigned int> edgeUses;
+		edgeUses.reserve(indexCount);
+		for( size_t i = 0; i < indexCount; i += 3 )
+			for( int k = 0; k < 3; k++ )
+				edgeUses[edgeKey(point[indices[i + k]], point[indices[i + (k + 1) % 3]])]++;
+		std::vector<char> borderPoint(wedges.size(), 0);
+		for( auto it = edgeUses.begin(); it != edgeUses.end(); ++it )
+			if( it->second == 1 ){
+				borderPoint[it->first >> 32] = 1;
+				borderPoint[it->first & 0xFFFFFFFFu] = 1;
+			}
+		for( size_t v = 0; v < vertexCount; v++ )
+			locked[v] = wedges[point[v]] > 1 || borderPoint[point[v]];
+	}
+
+	// Quadric of every vertex, from the planes of its triangles
+	std::vector<Quadric> quadrics(vertexCount);
+	for( size_t v = 0; v < vertexCount; v++ )
+		quadrics[v].clear();
+	for( size_t i = 0; i < indexCount; i += 3 ){
+		glm::dvec3 p0(positions[indices[i]]), p1(positions[indices[i + 1]]), p2(positions[indices[i + 2]]);
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+		if( length == 0.0 )
+			continue;
+		normal /= length;
+		double d = -glm::dot(normal, p0);
+		for( int k = 0; k < 3; k++ )
+			quadrics[indices[i + k]].addPlane(normal, d, length * 0.5);
+	}
+
+	// Passes of independent collapses, cheapest first, until the target is reached or nothing can move
+	double maxCost = 0.0;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<char> touched(vertexCount);
+	std::vector<unsigned int> firstTriangle(vertexCount + 1), adjacency;
+	while( out_indices.size() > targetIndexCount ){
+		size_t triangleCount = out_indices.size() / 3;
+
+		collapses.clear();
+		for( size_t i = 0; i < out_indices.size(); i += 3 )
+			for( int k = 0; k < 3; k++ ){
+				unsigned int a = out_indices[i + k], b = out_indices[i + (k + 1) % 3];
+				for( int direction = 0; direction < 2; direction++, std::swap(a, b) ){
+					if( locked[a] )
+						continue;
+					Quadric merged = quadrics[a];
+					merged.add(quadrics[b]);
+					Collapse collapse = { a, b, merged.error(positions[b]) };
+					collapses.push_back(collapse);
+				}
+			}
+		if( collapses.empty() )
+			break;
+		std::sort(collapses.begin(), collapses.end());
+
+		// Triangles around each vertex, to check for flips
+		std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+		for( size_t i = 0; i < out_indices.size(); i++ )
+			firstTriangle[out_indices[i] + 1]++;
+		for( size_t v = 0; v < vertexCount; v++ )
+			firstTriangle[v + 1] += firstTriangle[v];
+		adjacency.resize(out_indices.size());
+		{
+			std::vector<unsigned int> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+			for( size_t i = 0; i < out_indices.size(); i++ )
+				adjacency[fill[out_indices[i]]++] = (unsigned int)(i / 3);
+		}
+
+		// Each collapse removes about two triangles
+		size_t wanted = (triangleCount - targetIndexCount / 3) / 2 + 1;
+		size_t done = 0;
+		for( size_t v = 0; v < vertexCount; v++ )
+			remap[v] = (unsigned int)v;
+		std::fill(touched.begin(), touched.end(), 0);
+		for( size_t c = 0; c < collapses.size() && done < wanted; c++ ){
+			const Collapse & collapse = collapses[c];
+			if( touched[collapse.from] || touched[collapse.to] )
+				continue;
+
+			// Moving from onto to must not turn any remaining triangle over
+			bool flips = false;
+			for( unsigned int j = firstTriangle[collapse.from]; j < firstTriangle[collapse.from + 1] && !flips; j++ ){
+				const unsigned int * triangle = &out_indices[adjacency[j] * 3];
+				if( triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to )
+					continue; // collapses away
+				glm::vec3 before[3], after[3];
+				for( int k = 0; k < 3; k++ ){
+					before[k] = positions[triangle[k]];
+					after[k] = triangle[k] == collapse.from ? positions[collapse.to] : before[k];
+				}
+				glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+			}
+			if( flips )
+				continue;
+
+			// Keep the neighbourhood still for the rest of the pass, the checks above assumed it was
+			for( unsigned int j = firstTriangle[collapse.from]; j < firstTriangle[collapse.from + 1]; j++ )
+				for( int k = 0; k < 3; k++ )
+					touched[out_indices[adjacency[j] * 3 + k]] = 1;
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			maxCost = std::max(maxCost, collapse.cost);
+			done++;
+		}
+		if( done == 0 )
+			break;
+
+		// Apply the pass and drop the triangles that collapsed
+		size_t kept = 0;
+		for( size_t i = 0; i < out_indices.size(); i += 3 ){
+			unsigned int a = remap[out_indices[i]], b = remap[out_indices[i + 1]], c = remap[out_indices[i + 2]];
+			if( a == b || b == c || a == c )
+				continue;
+			out_indices[kept++] = a;
+			out_indices[kept++] = b;
+			out_indices[kept++] = c;
+		}
+		out_indices.resize(kept);
+	}
+	return (float)std::sqrt(maxCost);
+}
+
+void generateMeshLods(Mesh & mesh, const float * ratios, size_t ratioCount) {
+	if( mesh.indices.empty() )
+		return;
+	if( mesh.parts.empty() ){
+		MeshPart all = { MESH_NO_MATERIAL, 0, (unsigned int)mesh.indices.size() };
+		mesh.parts.push_back(all);
+	}
+	if( mesh.groups.empty() ){
+		MeshGroup group;
+		group.firstPart = 0;
+		group.partCount = (unsigned int)mesh.parts.size();
+		group.firstIndex = 0;
+		group.indexCount = (unsigned int)mesh.indices.size();
+		group.boundsMin = group.boundsMax = mesh.vertices[0];
+		for( size_t v = 1; v < mesh.vertices.size(); v++ ){
+			group.boundsMin = glm::min(group.boundsMin, mesh.vertices[v]);
+			group.boundsMax = glm::max(group.boundsMax, mesh.vertices[v]);
+		}
+		group.center = (group.boundsMin + group.boundsMax) * 0.5f;
+		group.radius = glm::length(group.boundsMax - group.boundsMin) * 0.5f;
+		mesh.groups.push_back(group);
+	}
+
+	// Like optimizeMesh, every part works on its own small numbering of the vertices it uses
+	const unsigned int unassigned = 0xFFFFFFFFu;
+	std::vector<unsigned int> local(mesh.vertices.size(), unassigned);
+	std::vector<unsigned int> global, partIndices, simplified;
+	std::vector<glm::vec3> partPositions;
+	size_t fullCount = mesh.parts.back().firstIndex + mesh.parts.back().indexCount;
+	size_t previousTriangles = fullCount / 3;
+	for( size_t l = 0; l < ratioCount; l++ ){
+		size_t levelStart = mesh.indices.size();
+		MeshLod lod;
+		lod.ratio = ratios[l];
+		lod.error = 0.0f;
+		size_t triangles = 0;
+		for( size_t p = 0; p < mesh.parts.size(); p++ ){
+			// Each level starts over from the full part, so errors don't pile up from level to level
+			const MeshPart & part = mesh.parts[p];
+			global.clear();
+			partPositions.clear();
+			partIndices.resize(part.indexCount);
+			for( unsigned int i = 0; i < part.indexCount; i++ ){
+				unsigned int v = mesh.indices[part.firstIndex + i];
+				if( local[v] == unassigned ){
+					local[v] = (unsigned int)global.size();
+					global.push_back(v);
+					partPositions.push_back(mesh.vertices[v]);
+				}
+				partIndices[i] = local[v];
+			}
+			for( size_t v = 0; v < global.size(); v++ )
+				local[global[v]] = unassigned;
+
+			size_t target = (size_t)(part.indexCount / 3 * ratios[l]) * 3;
+			float error = simplifyIndices(partIndices.data(), partIndices.size(), partPositions.data(), partPositions.size(), target, simplified);
+			if( !simplified.empty() )
+				optimizeVertexCache(&simplified[0], simplified.size(), partPositions.size());
+
+			MeshPart lodPart = { part.material, (unsigned int)mesh.indices.size(), (unsigned int)simplified.size() };
+			for( size_t i = 0; i < simplified.size(); i++ )
+				mesh.indices.push_back(global[simplified[i]]);
+			lod.parts.push_back(lodPart);
+			lod.error = std::max(lod.error, error);
+			triangles += simplified.size() / 3;
+		}
+		if( triangles >= previousTriangles ){
+			// Seams and borders are all that's left : a coarser level would be the same
+			mesh.indices.resize(levelStart);
+			break;
+		}
+		previousTriangles = triangles;
+		mesh.lods.push_back(lod);
+	}
+}
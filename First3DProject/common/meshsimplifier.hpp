@@ -0,0 +1,31 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// Quadric error metric simplification (Garland & Heckbert 1997) by edge collapse onto existing vertices.
+// Only the indices change : every level of detail shares the vertex buffers of the full mesh.
+
+// Simplifies the triangles in indices towards targetIndexCount indices and returns the result in out_indices.
+// Vertices on UV or normal seams (several vertices at one position) and on open borders never move, so seams stay sealed.
+// Returns the largest collapse error, as a distance in model units.
+float simplifyIndices(
+	const unsigned int * indices,
+	size_t indexCount,
+	const glm::vec3 * positions,
+	size_t vertexCount,
+	size_t targetIndexCount,
+	std::vector<unsigned int> & out_indices
+);
+
+// Appends one level of detail per ratio (of the full triangle count, decreasing) to mesh.lods, simplifying each part
+// on its own so materials and groups keep their ranges. A mesh without parts gets a single part and group first.
+// Stops early once a level can't remove anything more.
+void generateMeshLods(Mesh & mesh, const float * ratios, size_t ratioCount);
+
+#endif
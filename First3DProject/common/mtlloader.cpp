@@ -0,0 +1,94 @@
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstring>
+#include <unistd.h>
+
+#include <glm/glm.hpp>
+
+#include "mtlloader.hpp"
+#include "mappedfile.hpp"
+
+// MTL files are a few hundred bytes, so strtof is plenty here.
+
+static const char * skipBlanks(const char * p, const char * end) {
+	while( p < end && (*p == ' ' || *p == '\t') )
+		++p;
+	return p;
+}
+
+// The rest of the line, without surrounding blanks.
+static std::string restOfLine(const char * p, const char * end) {
+	p = skipBlanks(p, end);
+	const char * last = end;
+	while( last > p && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r') )
+		--last;
+	return std::string(p, last);
+}
+
+static bool readFloats(const char * p, const char * end, float * out, int count) {
+	std::string line(p, end); // strtof needs a terminated string
+	const char * cursor = line.c_str();
+	for( int i = 0; i < count; i++ ){
+		char * stop;
+		out[i] = strtof(cursor, &stop);
+		if( stop == cursor )
+			return false;
+		cursor = stop;
+	}
+	return true;
+}
+
+bool loadMTL(const char * path, std::vector<Material> & out_materials) {
+	// Exporters write an mtllib whether or not they write the library : a missing one is worth one line.
+	// MappedFile reports any other failure
+	if( access(path, F_OK) != 0 ){
+		printf("Material library %s is missing\n", path);
+		return false;
+	}
+	MappedFile file;
+	if( !file.open(path) )
+		return false;
+
+	Material * current = NULL;
+	const char * p = file.data();
+	const char * end = file.data() + file.size();
+	while( p < end ){
+		const char * eol = (const char *)memchr(p, '\n', end - p);
+		const char * lineEnd = eol ? eol : end;
+
+		p = skipBlanks(p, lineEnd);
+		const char * keyword = p;
+		while( p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r' )
+			++p;
+		std::string key(keyword, p);
+
+		float values[3];
+		if( key == "newmtl" ){
+			out_materials.push_back(Material());
+			current = &out_materials.back();
+			current->name = restOfLine(p, lineEnd);
+		}else if( current == NULL ){
+			// Comments, or garbage before the first material
+		}else if( key == "Ka" && readFloats(p, lineEnd, values, 3) ){
+			current->ambient = glm::vec3(values[0], values[1], values[2]);
+		}else if( key == "Kd" && readFloats(p, lineEnd, values, 3) ){
+			current->diffuse = glm::vec3(values[0], values[1], values[2]);
+		}else if( key == "Ks" && readFloats(p, lineEnd, values, 3) ){
+			current->specular = glm::vec3(values[0], values[1], values[2]);
+		}else if( key == "Ns" && readFloats(p, lineEnd, values, 1) ){
+			current->shininess = values[0];
+		}else if( key == "d" && readFloats(p, lineEnd, values, 1) ){
+			current->opacity = values[0];
+		}else if( key == "Tr" && readFloats(p, lineEnd, values, 1) ){
+			current->opacity = 1.0f - values[0];
+		}else if( key == "map_Kd" ){
+			current->diffuseTexture = restOfLine(p, lineEnd);
+		}
+		// Everything else (illum, Ni, Ke, other maps...) isn't used by our shader
+
+		p = eol ? eol + 1 : end;
+	}
+	return true;
+}
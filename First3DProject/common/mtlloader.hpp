@@ -0,0 +1,25 @@
+#ifndef MTLLOADER_HPP
+#define MTLLOADER_HPP
+
+#include <vector>
+#include <string>
+
+#include <glm/glm.hpp>
+
+// One "newmtl" entry of an MTL material library.
+struct Material {
+	Material() : ambient(0.0f), diffuse(0.5f), specular(0.3f), shininess(5.0f), opacity(1.0f) {}
+
+	std::string name;
+	glm::vec3 ambient;          // Ka
+	glm::vec3 diffuse;          // Kd, what the shader uses as the object's color
+	glm::vec3 specular;         // Ks
+	float shininess;            // Ns
+	float opacity;              // d, or 1 - Tr
+	std::string diffuseTexture; // map_Kd, relative to the MTL file
+};
+
+// Appends every material of the MTL file at path to out_materials.
+bool loadMTL(const char * path, std::vector<Material> & out_materials);
+
+#endif
@@ -2,29 +2,36 @@
 #include <stdio.h>
 #include <string>
 #include <cstring>
+#include <chrono>
+#include <sys/stat.h>
+#include <istream>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 
 #include "objloader.hpp"
+#include "objparser.hpp"
+#include "mappedfile.hpp"
+#include "mtlloader.hpp"
+#include "mesh.hpp"
+#include "meshnormals.hpp"
 
 // Very, VERY simple OBJ loader.
 // Here is a short list of features a real function would provide : 
 // - Binary files. Reading a model should be just a few memcpy's away, not parsing a file at runtime. In short : OBJ is not very great.
 // - Animations & bones (includes bones weights)
 // - Multiple UVs
-// - All attributes should be optional, not "forced"
+// - All attributes should be optional, not "forced" (done for UVs and normals : missing normals are computed)
 // - More stable. Change a line in the OBJ file and it crashes.
 // - More secure. Change another line and you can inject code.
-// - Loading from memory, stream, etc
+// - Loading from memory, stream, etc (done : see the buffer and std::istream overloads below)
 
-bool loadOBJ(
+static bool loadOBJStdio(
 	const char * path, 
 	std::vector<glm::vec3> & out_vertices, 
 	std::vector<glm::vec2> & out_uvs,
 	std::vector<glm::vec3> & out_normals
 ){
-	printf("Loading OBJ file %s...\n", path);
-
 	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
 	std::vector<glm::vec3> temp_vertices; 
 	std::vector<glm::vec2> temp_uvs;
@@ -110,6 +117,291 @@ bool loadOBJ(
 	return true;
 }
 
+static unsigned int threadCountFor(OBJLoadMode mode) {
+	return mode == OBJ_LOAD_PARALLEL ? defaultOBJThreadCount() : 1;
+}
+
+static void reportLoad(size_t bytes, std::chrono::steady_clock::time_point start, size_t vertexCount, size_t indexCount) {
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double megabytes = bytes / (1024.0 * 1024.0);
+	printf("Loaded %u vertices, %u indices, %.2f MB in %.2f ms (%.1f MB/s)\n",
+		(unsigned int)vertexCount, (unsigned int)indexCount, megabytes, seconds * 1000.0, seconds > 0.0 ? megabytes / seconds : 0.0);
+}
+
+// Gives smooth normals to the vertices [firstVertex, end) of faces that had none (f v or f v/vt), e.g. from a scan.
+// indices, when not NULL, are the triangles [firstIndex, end) over them ; otherwise the vertices are plain triangles.
+static void fillMissingNormals(
+	const OBJData & data,
+	const std::vector<unsigned int> * indices, size_t firstIndex,
+	const std::vector<glm::vec3> & vertices, std::vector<glm::vec3> & normals, size_t firstVertex,
+	OBJLoadMode mode
+){
+	if( std::find(data.normalIndices.begin(), data.normalIndices.end(), 0u) == data.normalIndices.end() )
+		return;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<glm::vec3> smooth(vertices.size());
+	if( indices )
+		computeSmoothNormals(indices->data() + firstIndex, indices->size() - firstIndex, vertices.data(), vertices.size(), smooth.data(), threadCountFor(mode));
+	else
+		computeSmoothNormals(NULL, vertices.size() - firstVertex, vertices.data() + firstVertex, vertices.size() - firstVertex, smooth.data() + firstVertex, threadCountFor(mode));
+	for( size_t v = firstVertex; v < vertices.size(); v++ )
+		if( normals[v] == glm::vec3(0.0f) )
+			normals[v] = smooth[v];
+	printf("Computed smooth normals in %.2f ms\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1000.0);
+}
+
+// The parser core shared by files, memory buffers and streams : everything ends up as bytes in memory.
+static bool expandBuffer(
+	const char * buffer, size_t size,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t firstVertex = out_vertices.size();
+
+	OBJData data;
+	if( !parseOBJParallel(buffer, buffer + size, data, threadCountFor(mode)) || !expandOBJ(data, out_vertices, out_uvs, out_normals, threadCountFor(mode)) )
+		return false;
+	fillMissingNormals(data, NULL, 0, out_vertices, out_normals, firstVertex, mode);
+
+	reportLoad(size, start, out_vertices.size() - firstVertex, 0);
+	return true;
+}
+
+static bool indexBuffer(
+	const char * buffer, size_t size,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t firstVertex = out_vertices.size();
+	size_t firstIndex = out_indices.size();
+
+	OBJData data;
+	if( !parseOBJParallel(buffer, buffer + size, data, threadCountFor(mode)) || !indexOBJ(data, out_indices, out_vertices, out_uvs, out_normals) )
+		return false;
+	fillMissingNormals(data, &out_indices, firstIndex, out_vertices, out_normals, firstVertex, mode);
+
+	reportLoad(size, start, out_vertices.size() - firstVertex, out_indices.size() - firstIndex);
+	return true;
+}
+
+// Reads a whole stream into buffer, a large block at a time.
+static bool readStream(std::istream & stream, std::vector<char> & buffer) {
+	const size_t blockSize = 1 << 20;
+	std::streambuf * source = stream.rdbuf();
+	if( source == NULL )
+		return false;
+	size_t size = 0;
+	for( ;; ){
+		buffer.resize(size + blockSize);
+		std::streamsize got = source->sgetn(&buffer[size], blockSize);
+		size += (size_t)std::max<std::streamsize>(got, 0);
+		if( got < (std::streamsize)blockSize )
+			break;
+	}
+	buffer.resize(size);
+	return true;
+}
+
+static bool mapOBJ(const char * path, MappedFile & file) {
+	printf("Loading OBJ file %s...\n", path);
+	if( !file.open(path) ){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+	return true;
+}
+
+bool loadOBJ(
+	const char * path,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	if( mode == OBJ_LOAD_STDIO ){
+		printf("Loading OBJ file %s...\n", path);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		size_t firstVertex = out_vertices.size();
+		if( !loadOBJStdio(path, out_vertices, out_uvs, out_normals) )
+			return false;
+		struct stat info;
+		reportLoad(stat(path, &info) == 0 ? (size_t)info.st_size : 0, start, out_vertices.size() - firstVertex, 0);
+		return true;
+	}
+
+	MappedFile file;
+	return mapOBJ(path, file) && expandBuffer(file.data(), file.size(), out_vertices, out_uvs, out_normals, mode);
+}
+
+bool loadOBJIndexed(
+	const char * path,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	MappedFile file;
+	return mapOBJ(path, file) && indexBuffer(file.data(), file.size(), out_indices, out_vertices, out_uvs, out_normals, mode);
+}
+
+bool loadOBJ(
+	const char * buffer, size_t size,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	printf("Loading OBJ from memory...\n");
+	return expandBuffer(buffer, size, out_vertices, out_uvs, out_normals, mode);
+}
+
+bool loadOBJIndexed(
+	const char * buffer, size_t size,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	printf("Loading OBJ from memory...\n");
+	return indexBuffer(buffer, size, out_indices, out_vertices, out_uvs, out_normals, mode);
+}
+
+bool loadOBJ(
+	std::istream & stream,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	printf("Loading OBJ from stream...\n");
+	std::vector<char> buffer;
+	if( !readStream(stream, buffer) ){
+		printf("Impossible to read the OBJ stream\n");
+		return false;
+	}
+	return expandBuffer(buffer.data(), buffer.size(), out_vertices, out_uvs, out_normals, mode);
+}
+
+bool loadOBJIndexed(
+	std::istream & stream,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode
+){
+	printf("Loading OBJ from stream...\n");
+	std::vector<char> buffer;
+	if( !readStream(stream, buffer) ){
+		printf("Impossible to read the OBJ stream\n");
+		return false;
+	}
+	return indexBuffer(buffer.data(), buffer.size(), out_indices, out_vertices, out_uvs, out_normals, mode);
+}
+
+// Directory part of path, with its trailing separator, or "" for a bare file name.
+static std::string directoryOf(const char * path) {
+	const char * slash = strrchr(path, '/');
+	return slash ? std::string(path, slash + 1) : std::string();
+}
+
+// The mesh loader core shared by files, memory buffers and streams. name is what the messages call the OBJ.
+static bool meshBuffer(
+	const char * buffer, size_t size,
+	const char * directory,
+	const char * name,
+	Mesh & mesh,
+	OBJLoadMode mode
+){
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	OBJData data;
+	if( !parseOBJParallel(buffer, buffer + size, data, threadCountFor(mode)) )
+		return false;
+
+	if( !indexOBJ(data, mesh.indices, mesh.vertices, mesh.uvs, mesh.normals) )
+		return false;
+	fillMissingNormals(data, &mesh.indices, 0, mesh.vertices, mesh.normals, 0, mode);
+
+	// A missing library only costs the materials' colors. It's listed all the same, so that caches notice when it shows up
+	std::vector<Material> library;
+	bool librariesLoaded = true;
+	for( size_t i = 0; directory != NULL && i < data.materialLibraries.size(); i++ ){
+		std::string libraryPath = directory + data.materialLibraries[i];
+		librariesLoaded = loadMTL(libraryPath.c_str(), library) && librariesLoaded;
+		mesh.materialLibraries.push_back(libraryPath);
+	}
+
+	// Keep the materials that are defined, the faces of the others get no material at all
+	std::vector<unsigned int> remap(data.materials.size(), MESH_NO_MATERIAL);
+	for( size_t i = 0; i < data.materials.size(); i++ ){
+		// Later libraries override earlier ones, like most exporters expect
+		size_t found = library.size();
+		for( size_t j = 0; j < library.size(); j++ )
+			if( library[j].name == data.materials[i] )
+				found = j;
+		if( found == library.size() ){
+			if( librariesLoaded ) // else the library that failed already said why
+				printf("Material %s isn't defined by any material library of %s\n", data.materials[i].c_str(), name);
+			continue;
+		}
+		remap[i] = (unsigned int)mesh.materials.size();
+		mesh.materials.push_back(library[found]);
+	}
+	for( size_t r = 0; r < data.materialRuns.size(); r++ )
+		data.materialRuns[r].index = remap[data.materialRuns[r].index];
+	groupOBJ(data, mesh.vertices, mesh.indices, mesh.parts, mesh.groups);
+
+	reportLoad(size, start, mesh.vertices.size(), mesh.indices.size());
+	printf("%u materials, %u groups, %u parts\n", (unsigned int)mesh.materials.size(), (unsigned int)mesh.groups.size(), (unsigned int)mesh.parts.size());
+	return true;
+}
+
+bool loadOBJMesh(
+	const char * path,
+	Mesh & mesh,
+	OBJLoadMode mode
+){
+	mesh = Mesh();
+	MappedFile file;
+	return mapOBJ(path, file) && meshBuffer(file.data(), file.size(), directoryOf(path).c_str(), path, mesh, mode);
+}
+
+bool loadOBJMesh(
+	const char * buffer, size_t size,
+	const char * directory,
+	Mesh & mesh,
+	OBJLoadMode mode
+){
+	mesh = Mesh();
+	printf("Loading OBJ from memory...\n");
+	return meshBuffer(buffer, size, directory, "the OBJ in memory", mesh, mode);
+}
+
+bool loadOBJMesh(
+	std::istream & stream,
+	const char * directory,
+	Mesh & mesh,
+	OBJLoadMode mode
+){
+	mesh = Mesh();
+	printf("Loading OBJ from stream...\n");
+	std::vector<char> buffer;
+	if( !readStream(stream, buffer) ){
+		printf("Impossible to read the OBJ stream\n");
+		return false;
+	}
+	return meshBuffer(buffer.data(), buffer.size(), directory, "the OBJ stream", mesh, mode);
+}
+
 
 #ifdef USE_ASSIMP // don't use this #define, it's only for me (it AssImp fails to compile on your machine, at least all the other tutorials still work)
 
@@ -1,11 +1,98 @@
 #ifndef OBJLOADER_H
 #define OBJLOADER_H
 
+#include <iosfwd>
+
+struct Mesh;
+
+enum OBJLoadMode {
+	OBJ_LOAD_STDIO,  // the original fscanf loop, kept as a reference
+	OBJ_LOAD_MAPPED, // mmap the file and tokenize it in a single pass
+	OBJ_LOAD_PARALLEL // mmap the file and tokenize slices of it on all cores
+};
+
+// Faces are f v/vt/vn, or leave out the UVs or the normals (f v, f v/vt, f v//vn) : missing UVs are (0, 0),
+// missing normals are computed, smooth. Polygons are fanned into triangles and negative indices are resolved.
+// OBJ_LOAD_STDIO only reads v/vt/vn triangles with positive indices.
 bool loadOBJ(
 	const char * path, 
 	std::vector<glm::vec3> & out_vertices, 
 	std::vector<glm::vec2> & out_uvs, 
-	std::vector<glm::vec3> & out_normals
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+
+// Same as loadOBJ, but identical (v, vt, vn) corners are merged into a single vertex
+// and out_indices holds three indices per triangle. OBJ_LOAD_STDIO is read like OBJ_LOAD_MAPPED.
+bool loadOBJIndexed(
+	const char * path,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+
+// The same loaders for OBJ text that is already in memory, e.g. decompressed out of an archive.
+// The buffer is parsed in place, without any copy. OBJ_LOAD_STDIO is read like OBJ_LOAD_MAPPED.
+bool loadOBJ(
+	const char * buffer, size_t size,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+
+bool loadOBJIndexed(
+	const char * buffer, size_t size,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+
+// And for streams, which are read to their end in large blocks, then parsed like a buffer.
+bool loadOBJ(
+	std::istream & stream,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+
+bool loadOBJIndexed(
+	std::istream & stream,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+// Indexed mesh with materials : the faces are split into one group per o/g name, with its bounds, and each
+// group into one part per usemtl material. The materials are read from the mtllib files, which are looked up next to the OBJ file.
+// Faces whose material no library defines are put in the MESH_NO_MATERIAL part, drawn with the object's own color.
+// mesh is cleared first, whether loading succeeds or not.
+bool loadOBJMesh(
+	const char * path,
+	Mesh & mesh,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+
+// The same for OBJ text in memory or in a stream. Its material libraries are looked up in directory
+// (with its trailing separator, "" for the current one), or not at all if it's NULL, e.g. when they aren't files.
+bool loadOBJMesh(
+	const char * buffer, size_t size,
+	const char * directory,
+	Mesh & mesh,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
+);
+
+bool loadOBJMesh(
+	std::istream & stream,
+	const char * directory,
+	Mesh & mesh,
+	OBJLoadMode mode = OBJ_LOAD_PARALLEL
 );
 
 
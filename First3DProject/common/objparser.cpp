@@ -0,0 +1,784 @@
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <cstring>
+#include <cfloat>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+#include <glm/glm.hpp>
+
+#include "objparser.hpp"
+
+// Hand-rolled tokenizer for the subset of OBJ that loadOBJ understands.
+// Faces are parsed by one template instance per corner layout, picked once per face from its first corner.
+// Numbers are converted with Clinger's fast path : a decimal with at most 2^24 as mantissa and a power of ten
+// up to 1e10 is a single correctly rounded float operation, so the result is bit-identical to strtof / fscanf("%f").
+// Anything longer (or nan, inf, hex floats...) falls back to strtof on a copy of the token.
+
+namespace {
+
+const float powersOfTen[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+inline bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool isDigit(char c) {
+	return (unsigned char)(c - '0') < 10;
+}
+
+inline const char * skipBlanks(const char * p, const char * end) {
+	while( p < end && isBlank(*p) )
+		++p;
+	return p;
+}
+
+// p may be at end, never past it : the bound is explicit, so that no compiler sees a negative length.
+inline const char * skipLine(const char * p, const char * end) {
+	if( p >= end )
+		return end;
+	size_t remaining = (size_t)(end - p);
+	const char * eol = (const char *)memchr(p, '\n', remaining);
+	return eol ? eol + 1 : end;
+}
+
+bool parseFloatSlow(const char * start, const char * end, const char *& p, float & out) {
+	char buffer[64];
+	size_t length = std::min<size_t>(end - start, sizeof(buffer) - 1);
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+
+	char * stop;
+	out = strtof(buffer, &stop);
+	if( stop == buffer )
+		return false;
+	p = start + (stop - buffer);
+	return true;
+}
+
+bool parseFloat(const char *& p, const char * end, float & out) {
+	p = skipBlanks(p, end);
+	const char * start = p;
+
+	bool negative = false;
+	if( p < end && (*p == '-' || *p == '+') ){
+		negative = *p == '-';
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;    // significant digits stored in mantissa
+	int exponent = 0;  // power of ten applied to mantissa
+	bool anyDigit = false;
+
+	while( p < end && isDigit(*p) ){
+		unsigned int d = *p - '0';
+		if( mantissa != 0 || d != 0 ){
+			if( digits < 19 ){
+				mantissa = mantissa * 10 + d;
+				digits++;
+			}else{
+				exponent++;
+			}
+		}
+		anyDigit = true;
+		++p;
+	}
+	if( p < end && *p == '.' ){
+		++p;
+		while( p < end && isDigit(*p) ){
+			unsigned int d = *p - '0';
+			if( mantissa == 0 && d == 0 ){
+				exponent--;
+			}else if( digits < 19 ){
+				mantissa = mantissa * 10 + d;
+				digits++;
+				exponent--;
+			}
+			anyDigit = true;
+			++p;
+		}
+	}
+	if( !anyDigit || (p < end && (*p == 'x' || *p == 'X')) )
+		return parseFloatSlow(start, end, p, out);
+
+	if( p < end && (*p == 'e' || *p == 'E') ){
+		const char * q = p + 1;
+		bool negativeExponent = false;
+		if( q < end && (*q == '-' || *q == '+') ){
+			negativeExponent = *q == '-';
+			++q;
+		}
+		if( q < end && isDigit(*q) ){
+			int value = 0;
+			while( q < end && isDigit(*q) ){
+				if( value < 100000 )
+					value = value * 10 + (*q - '0');
+				++q;
+			}
+			exponent += negativeExponent ? -value : value;
+			p = q;
+		}
+	}
+
+	if( mantissa == 0 ){
+		out = negative ? -0.0f : 0.0f;
+		return true;
+	}
+	if( mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10 ){
+		float value = (float)mantissa;
+		value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+		out = negative ? -value : value;
+		return true;
+	}
+	return parseFloatSlow(start, end, p, out);
+}
+
+// An OBJ index : 1-based, or negative to count back from the last element read so far, count.
+// Relative indices are resolved here ; relative, when not NULL, is set for them instead of checking they don't
+// reach before the first element, because the caller only knows part of the file.
+inline bool parseIndex(const char *& p, const char * end, size_t count, unsigned int & out, bool * relative) {
+	bool negative = p < end && *p == '-';
+	if( negative )
+		++p;
+	if( p >= end || !isDigit(*p) )
+		return false;
+	unsigned int value = 0;
+	while( p < end && isDigit(*p) ){
+		if( value > 429496728u )
+			return false;
+		value = value * 10 + (*p - '0');
+		++p;
+	}
+	if( !negative ){
+		out = value;
+		return true;
+	}
+	if( value == 0 || (relative == NULL && value > count) )
+		return false;
+	if( relative )
+		*relative = true;
+	out = (unsigned int)count + 1 - value; // wraps around when it reaches into an earlier slice of the file
+	return true;
+}
+
+// Which indices the corners of a face give.
+enum FaceLayout {
+	FACE_V,       // f v
+	FACE_V_VT,    // f v/vt
+	FACE_V_VN,    // f v//vn
+	FACE_V_VT_VN  // f v/vt/vn
+};
+
+// Reads the layout off the first corner of a face ; every corner of the face must then use it.
+inline FaceLayout faceLayout(const char * p, const char * end) {
+	while( p < end && *p != '/' && !isBlank(*p) && *p != '\n' )
+		++p;
+	if( p >= end || *p != '/' )
+		return FACE_V;
+	++p;
+	bool hasUV = p < end && *p != '/';
+	while( p < end && *p != '/' && !isBlank(*p) && *p != '\n' )
+		++p;
+	if( p >= end || *p != '/' )
+		return FACE_V_VT;
+	return hasUV ? FACE_V_VT_VN : FACE_V_VN;
+}
+
+// The indices of one face corner. relative has one bit per index (1 : v, 2 : vt, 4 : vn) that was negative.
+struct FaceCorner {
+	unsigned int v, vt, vn;
+	unsigned int relative;
+};
+
+// Positions, in the index arrays, of the indices that were resolved against the counts of a slice of the file
+// rather than of the whole file, for parseOBJParallel to add the counts of the slices before.
+struct RelativeIndices {
+	std::vector<size_t> vertices, uvs, normals;
+};
+
+// One corner in the layout of the face : the format is known at compile time, so nothing but the digits is tested.
+template <bool hasUV, bool hasNormal>
+inline bool parseCorner(const char *& p, const char * end, const OBJData & data, FaceCorner & corner, RelativeIndices * relative) {
+	bool relativeV = false, relativeVT = false, relativeVN = false;
+	corner.vt = corner.vn = 0;
+	if( !parseIndex(p, end, data.vertices.size(), corner.v, relative ? &relativeV : NULL) )
+		return false;
+	if( hasUV || hasNormal ){
+		if( p >= end || *p != '/' )
+			return false;
+		++p;
+	}
+	if( hasUV && !parseIndex(p, end, data.uvs.size(), corner.vt, relative ? &relativeVT : NULL) )
+		return false;
+	if( hasNormal ){
+		if( p >= end || *p != '/' )
+			return false;
+		++p;
+		if( !parseIndex(p, end, data.normals.size(), corner.vn, relative ? &relativeVN : NULL) )
+			return false;
+	}
+	corner.relative = (relativeV ? 1 : 0) | (relativeVT ? 2 : 0) | (relativeVN ? 4 : 0);
+	// The corner must end here : anything else is a corner in another layout
+	return p >= end || isBlank(*p) || *p == '\n';
+}
+
+inline void addCorner(OBJData & data, const FaceCorner & corner, RelativeIndices * relative) {
+	if( corner.relative ){
+		size_t position = data.vertexIndices.size();
+		if( corner.relative & 1 )
+			relative->vertices.push_back(position);
+		if( corner.relative & 2 )
+			relative->uvs.push_back(position);
+		if( corner.relative & 4 )
+			relative->normals.push_back(position);
+	}
+	data.vertexIndices.push_back(corner.v);
+	data.uvIndices    .push_back(corner.vt);
+	data.normalIndices.push_back(corner.vn);
+}
+
+// A face of any number of corners, triangulated as a fan around its first corner : (0, 1, 2), (0, 2, 3)...
+// Stops at the end of the line or at a comment.
+template <bool hasUV, bool hasNormal>
+bool parseFace(const char *& p, const char * end, OBJData & data, RelativeIndices * relative) {
+	FaceCorner first, previous, corner;
+	int cornerCount = 0;
+	while( true ){
+		p = skipBlanks(p, end);
+		if( p >= end || *p == '\n' || *p == '#' )
+			break;
+		if( !parseCorner<hasUV, hasNormal>(p, end, data, corner, relative) )
+			return false;
+		if( cornerCount >= 2 ){
+			addCorner(data, first, relative);
+			addCorner(data, previous, relative);
+			addCorner(data, corner, relative);
+		}else if( cornerCount == 0 ){
+			first = corner;
+		}
+		previous = corner;
+		cornerCount++;
+	}
+	return cornerCount >= 3;
+}
+
+// The rest of the line, without surrounding blanks.
+std::string restOfLine(const char * p, const char * end) {
+	p = skipBlanks(p, end);
+	const char * last = skipLine(p, end);
+	while( last > p && (isBlank(last[-1]) || last[-1] == '\n') )
+		--last;
+	return std::string(p, last);
+}
+
+unsigned int findOrAddName(std::vector<std::string> & names, const std::string & name) {
+	for( size_t i = 0; i < names.size(); i++ )
+		if( names[i] == name )
+			return (unsigned int)i;
+	names.push_back(name);
+	return (unsigned int)names.size() - 1;
+}
+
+// Appends run, unless it changes nothing : runs stay minimal, whichever way the file was cut.
+void addRun(std::vector<OBJRun> & runs, const OBJRun & run) {
+	if( !runs.empty() && runs.back().firstTriangle == run.firstTriangle ){
+		runs.back().index = run.index; // no face used the previous one
+		if( runs.size() >= 2 && runs[runs.size() - 2].index == run.index )
+			runs.pop_back();
+	}else if( runs.empty() || runs.back().index != run.index ){
+		runs.push_back(run);
+	}
+}
+
+// Starts a run of the name on the rest of the line, at the next face.
+void startRun(std::vector<std::string> & names, std::vector<OBJRun> & runs, const std::string & name, const OBJData & data) {
+	OBJRun run;
+	run.index = findOrAddName(names, name);
+	run.firstTriangle = (unsigned int)(data.vertexIndices.size() / 3);
+	addRun(runs, run);
+}
+
+// Appends the runs of a chunk, whose faces start at firstTriangle, renumbering its names into names.
+// Faces before the chunk's first run simply continue the last run of the previous chunks.
+void mergeRuns(std::vector<std::string> & names, std::vector<OBJRun> & runs, const std::vector<std::string> & chunkNames, const std::vector<OBJRun> & chunkRuns, unsigned int firstTriangle) {
+	for( size_t j = 0; j < chunkRuns.size(); j++ ){
+		OBJRun run;
+		run.index = findOrAddName(names, chunkNames[chunkRuns[j].index]);
+		run.firstTriangle = firstTriangle + chunkRuns[j].firstTriangle;
+		addRun(runs, run);
+	}
+}
+
+unsigned int lineNumber(const char * begin, const char * p) {
+	return 1 + (unsigned int)std::count(begin, p, '\n');
+}
+
+// parseOBJRange, telling apart the indices that count back from the end of [begin, end) when relative is not NULL.
+bool parseRange(const char * file, const char * begin, const char * end, OBJData & data, RelativeIndices * relative) {
+	const char * p = begin;
+
+	while( p < end ){
+		p = skipBlanks(p, end);
+		const char * keyword = p;
+		while( p < end && !isBlank(*p) && *p != '\n' )
+			++p;
+		size_t keywordLength = p - keyword;
+
+		if( keywordLength == 1 && keyword[0] == 'v' ){
+			glm::vec3 vertex;
+			if( !parseFloat(p, end, vertex.x) || !parseFloat(p, end, vertex.y) || !parseFloat(p, end, vertex.z) ){
+				printf("Malformed vertex on line %u\n", lineNumber(file, keyword));
+				return false;
+			}
+			data.vertices.push_back(vertex);
+		}else if( keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't' ){
+			glm::vec2 uv;
+			if( !parseFloat(p, end, uv.x) || !parseFloat(p, end, uv.y) ){
+				printf("Malformed texture coordinate on line %u\n", lineNumber(file, keyword));
+				return false;
+			}
+			uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
+			data.uvs.push_back(uv);
+		}else if( keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n' ){
+			glm::vec3 normal;
+			if( !parseFloat(p, end, normal.x) || !parseFloat(p, end, normal.y) || !parseFloat(p, end, normal.z) ){
+				printf("Malformed normal on line %u\n", lineNumber(file, keyword));
+				return false;
+			}
+			data.normals.push_back(normal);
+		}else if( keywordLength == 1 && keyword[0] == 'f' ){
+			// One branch on the layout per face, none per corner
+			p = skipBlanks(p, end);
+			bool parsed = false;
+			switch( faceLayout(p, end) ){
+			case FACE_V:       parsed = parseFace<false, false>(p, end, data, relative); break;
+			case FACE_V_VT:    parsed = parseFace<true, false>(p, end, data, relative); break;
+			case FACE_V_VN:    parsed = parseFace<false, true>(p, end, data, relative); break;
+			case FACE_V_VT_VN: parsed = parseFace<true, true>(p, end, data, relative); break;
+			}
+			if( !parsed ){
+				printf("Malformed face on line %u\n", lineNumber(file, keyword));
+				return false;
+			}
+		}else if( keywordLength == 6 && memcmp(keyword, "usemtl", 6) == 0 ){
+			startRun(data.materials, data.materialRuns, restOfLine(p, end), data);
+		}else if( keywordLength == 1 && (keyword[0] == 'o' || keyword[0] == 'g') ){
+			startRun(data.groups, data.groupRuns, restOfLine(p, end), data);
+		}else if( keywordLength == 6 && memcmp(keyword, "mtllib", 6) == 0 ){
+			// Several libraries may be listed on one line
+			std::string libraries = restOfLine(p, end);
+			size_t start = 0;
+			while( start < libraries.size() ){
+				size_t stop = libraries.find_first_of(" \t", start);
+				if( stop == std::string::npos )
+					stop = libraries.size();
+				if( stop > start )
+					findOrAddName(data.materialLibraries, libraries.substr(start, stop - start));
+				start = stop + 1;
+			}
+		}
+		// Anything else (comments, s...) and trailing data are ignored.
+
+		p = skipLine(p, end);
+	}
+	return true;
+}
+
+} // namespace
+
+bool parseOBJRange(const char * file, const char * begin, const char * end, OBJData & data) {
+	return parseRange(file, begin, end, data, NULL);
+}
+
+bool parseOBJ(const char * begin, const char * end, OBJData & data) {
+	return parseOBJRange(begin, begin, end, data);
+}
+
+unsigned int defaultOBJThreadCount() {
+	unsigned int threads = std::thread::hardware_concurrency();
+	return threads == 0 ? 1 : threads;
+}
+
+// Copies all of source into destination, starting at offset.
+template <typename T>
+static void copyInto(std::vector<T> & destination, size_t offset, const std::vector<T> & source) {
+	if( !source.empty() )
+		memcpy(&destination[offset], &source[0], source.size() * sizeof(T));
+}
+
+// Adds count, the number of elements before a chunk, to the relative indices of the chunk, which start at offset in indices.
+static bool rebaseIndices(std::vector<unsigned int> & indices, size_t offset, const std::vector<size_t> & positions, size_t count) {
+	for( size_t j = 0; j < positions.size(); j++ ){
+		unsigned int & index = indices[offset + positions[j]];
+		// Within the chunk, an index that counts back past its first element is 0 or below
+		if( (long long)(int)index + (long long)count < 1 ){
+			printf("Face %u counts back before the first element of the file\n", (unsigned int)((offset + positions[j]) / 3 + 1));
+			return false;
+		}
+		index += (unsigned int)count;
+	}
+	return true;
+}
+
+bool parseOBJParallel(const char * begin, const char * end, OBJData & data, unsigned int threadCount) {
+	// Below a megabyte per thread, spawning threads costs more than it saves.
+	const size_t minimumChunk = 1 << 20;
+	size_t size = end - begin;
+	size_t chunkCount = std::min<size_t>(threadCount, size / minimumChunk);
+	if( chunkCount <= 1 )
+		return parseOBJ(begin, end, data);
+
+	// Cut the file in roughly equal slices, moving every cut just past the next line break
+	// so that no record is split between two threads.
+	std::vector<const char *> cuts(chunkCount + 1);
+	cuts[0] = begin;
+	cuts[chunkCount] = end;
+	for( size_t i = 1; i < chunkCount; i++ ){
+		const char * cut = std::max(cuts[i - 1], begin + size * i / chunkCount);
+		cuts[i] = skipLine(cut, end);
+	}
+
+	std::vector<OBJData> chunks(chunkCount);
+	std::vector<RelativeIndices> relatives(chunkCount);
+	std::vector<char> succeeded(chunkCount, 0);
+	std::vector<std::thread> workers;
+	for( size_t i = 0; i < chunkCount; i++ )
+		workers.push_back(std::thread([&, i](){
+			succeeded[i] = parseRange(begin, cuts[i], cuts[i + 1], chunks[i], &relatives[i]);
+		}));
+	for( size_t i = 0; i < chunkCount; i++ )
+		workers[i].join();
+	for( size_t i = 0; i < chunkCount; i++ )
+		if( !succeeded[i] )
+			return false;
+
+	// Exclusive prefix sums of the per-chunk counts give every chunk its place in the global arrays.
+	// OBJ indices are absolute positions in those arrays, so the chunks are simply laid out in file order.
+	// Negative indices were resolved within their chunk, and only need the counts of the chunks before added.
+	std::vector<size_t> vertexOffset(chunkCount + 1), uvOffset(chunkCount + 1), normalOffset(chunkCount + 1), indexOffset(chunkCount + 1);
+	vertexOffset[0] = data.vertices.size();
+	uvOffset[0] = data.uvs.size();
+	normalOffset[0] = data.normals.size();
+	indexOffset[0] = data.vertexIndices.size();
+	for( size_t i = 0; i < chunkCount; i++ ){
+		vertexOffset[i + 1] = vertexOffset[i] + chunks[i].vertices.size();
+		uvOffset[i + 1] = uvOffset[i] + chunks[i].uvs.size();
+		normalOffset[i + 1] = normalOffset[i] + chunks[i].normals.size();
+		indexOffset[i + 1] = indexOffset[i] + chunks[i].vertexIndices.size();
+	}
+	data.vertices.resize(vertexOffset[chunkCount]);
+	data.uvs.resize(uvOffset[chunkCount]);
+	data.normals.resize(normalOffset[chunkCount]);
+	data.vertexIndices.resize(indexOffset[chunkCount]);
+	data.uvIndices.resize(indexOffset[chunkCount]);
+	data.normalIndices.resize(indexOffset[chunkCount]);
+
+	// Material and group names are numbered per chunk : renumber them globally.
+	for( size_t i = 0; i < chunkCount; i++ ){
+		const OBJData & chunk = chunks[i];
+		for( size_t j = 0; j < chunk.materialLibraries.size(); j++ )
+			findOrAddName(data.materialLibraries, chunk.materialLibraries[j]);
+		unsigned int firstTriangle = (unsigned int)(indexOffset[i] / 3);
+		mergeRuns(data.materials, data.materialRuns, chunk.materials, chunk.materialRuns, firstTriangle);
+		mergeRuns(data.groups, data.groupRuns, chunk.groups, chunk.groupRuns, firstTriangle);
+	}
+
+	workers.clear();
+	for( size_t i = 0; i < chunkCount; i++ )
+		workers.push_back(std::thread([&, i](){
+			copyInto(data.vertices, vertexOffset[i], chunks[i].vertices);
+			copyInto(data.uvs, uvOffset[i], chunks[i].uvs);
+			copyInto(data.normals, normalOffset[i], chunks[i].normals);
+			copyInto(data.vertexIndices, indexOffset[i], chunks[i].vertexIndices);
+			copyInto(data.uvIndices, indexOffset[i], chunks[i].uvIndices);
+			copyInto(data.normalIndices, indexOffset[i], chunks[i].normalIndices);
+			succeeded[i] = rebaseIndices(data.vertexIndices, indexOffset[i], relatives[i].vertices, vertexOffset[i])
+				&& rebaseIndices(data.uvIndices, indexOffset[i], relatives[i].uvs, uvOffset[i])
+				&& rebaseIndices(data.normalIndices, indexOffset[i], relatives[i].normals, normalOffset[i]);
+			chunks[i] = OBJData(); // release the chunk as soon as it's merged
+		}));
+	for( size_t i = 0; i < chunkCount; i++ )
+		workers[i].join();
+	for( size_t i = 0; i < chunkCount; i++ )
+		if( !succeeded[i] )
+			return false;
+	return true;
+}
+
+// De-indexes the corners [first, last) of data into the output arrays, which are already sized.
+static bool expandRange(const OBJData & data, size_t first, size_t last, glm::vec3 * out_vertices, glm::vec2 * out_uvs, glm::vec3 * out_normals) {
+	// For each vertex of each triangle
+	for( size_t i = first; i < last; i++ ){
+		// OBJ indices are 1-based, so a vertex index of 0 wraps around and is rejected as well ; a uv or normal index of 0 is a missing one
+		unsigned int vertexIndex = data.vertexIndices[i] - 1;
+		unsigned int uvIndex = data.uvIndices[i];
+		unsigned int normalIndex = data.normalIndices[i];
+		if( vertexIndex >= data.vertices.size() || (uvIndex != 0 && uvIndex - 1 >= data.uvs.size()) || (normalIndex != 0 && normalIndex - 1 >= data.normals.size()) ){
+			printf("Face %u references an attribute that doesn't exist\n", (unsigned int)(i / 3 + 1));
+			return false;
+		}
+
+		out_vertices[i] = data.vertices[vertexIndex];
+		out_uvs     [i] = uvIndex ? data.uvs[uvIndex - 1] : glm::vec2(0.0f);
+		out_normals [i] = normalIndex ? data.normals[normalIndex - 1] : glm::vec3(0.0f);
+	}
+	return true;
+}
+
+bool expandOBJ(
+	const OBJData & data,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	unsigned int threadCount
+){
+	size_t base = out_vertices.size();
+	size_t count = data.vertexIndices.size();
+	out_vertices.resize(base + count);
+	out_uvs     .resize(base + count);
+	out_normals .resize(base + count);
+	if( count == 0 )
+		return true;
+
+	// Shift the output pointers so that corner i lands at base + i
+	glm::vec3 * vertices = &out_vertices[base];
+	glm::vec2 * uvs = &out_uvs[base];
+	glm::vec3 * normals = &out_normals[base];
+
+	const size_t minimumCorners = 1 << 16;
+	size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, count / minimumCorners));
+	bool succeeded = true;
+	if( chunkCount == 1 ){
+		succeeded = expandRange(data, 0, count, vertices, uvs, normals);
+	}else{
+		std::atomic<bool> allSucceeded(true);
+		std::vector<std::thread> workers;
+		for( size_t i = 0; i < chunkCount; i++ )
+			workers.push_back(std::thread([&, i](){
+				// Chunks end on triangle boundaries so error messages name whole faces
+				size_t first = count / 3 * i / chunkCount * 3;
+				size_t last = i + 1 == chunkCount ? count : count / 3 * (i + 1) / chunkCount * 3;
+				if( !expandRange(data, first, last, vertices, uvs, normals) )
+					allSucceeded = false;
+			}));
+		for( size_t i = 0; i < chunkCount; i++ )
+			workers[i].join();
+		succeeded = allSucceeded;
+	}
+
+	if( !succeeded ){
+		out_vertices.resize(base);
+		out_uvs     .resize(base);
+		out_normals .resize(base);
+	}
+	return succeeded;
+}
+
+// Open-addressing hash map from a (v, vt, vn) index triplet to its slot in the indexed vertex arrays.
+// Linear probing over a power-of-two table, kept at most half full. v is never 0 for a stored key
+// since OBJ indices are 1-based, so v == 0 marks an empty bucket.
+class TripletMap {
+public:
+	explicit TripletMap(size_t expected) : mCount(0) {
+		size_t capacity = 64;
+		while( capacity < expected * 2 )
+			capacity *= 2;
+		mBuckets.assign(capacity, Bucket());
+	}
+
+	// Returns the value stored for the triplet, or inserts value and returns it.
+	unsigned int findOrInsert(unsigned int v, unsigned int vt, unsigned int vn, unsigned int value) {
+		if( (mCount + 1) * 2 > mBuckets.size() )
+			grow();
+		size_t mask = mBuckets.size() - 1;
+		for( size_t i = hash(v, vt, vn) & mask; ; i = (i + 1) & mask ){
+			Bucket & bucket = mBuckets[i];
+			if( bucket.v == 0 ){
+				bucket.v = v;
+				bucket.vt = vt;
+				bucket.vn = vn;
+				bucket.value = value;
+				mCount++;
+				return value;
+			}
+			if( bucket.v == v && bucket.vt == vt && bucket.vn == vn )
+				return bucket.value;
+		}
+	}
+
+private:
+	struct Bucket {
+		Bucket() : v(0), vt(0), vn(0), value(0) {}
+		unsigned int v, vt, vn, value;
+	};
+
+	static size_t hash(unsigned int v, unsigned int vt, unsigned int vn) {
+		uint64_t h = v * 0x9E3779B97F4A7C15ull ^ vt * 0xC2B2AE3D27D4EB4Full ^ vn * 0x165667B19E3779F9ull;
+		h ^= h >> 29;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 32;
+		return (size_t)h;
+	}
+
+	void grow() {
+		std::vector<Bucket> old;
+		old.swap(mBuckets);
+		mBuckets.assign(old.size() * 2, Bucket());
+		size_t mask = mBuckets.size() - 1;
+		for( size_t j = 0; j < old.size(); j++ ){
+			if( old[j].v == 0 )
+				continue;
+			size_t i = hash(old[j].v, old[j].vt, old[j].vn) & mask;
+			while( mBuckets[i].v != 0 )
+				i = (i + 1) & mask;
+			mBuckets[i] = old[j];
+		}
+	}
+
+	std::vector<Bucket> mBuckets;
+	size_t mCount;
+};
+
+bool indexOBJ(
+	const OBJData & data,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	size_t count = data.vertexIndices.size();
+	size_t base = out_vertices.size();
+	size_t firstIndex = out_indices.size();
+
+	// A mesh can't have more distinct corners than the largest attribute pool, or more than it has corners
+	TripletMap map(std::min(count, std::max(data.vertices.size(), std::max(data.uvs.size(), data.normals.size()))));
+	out_indices.reserve(firstIndex + count);
+
+	for( size_t i = 0; i < count; i++ ){
+		unsigned int vertexIndex = data.vertexIndices[i];
+		unsigned int uvIndex = data.uvIndices[i];
+		unsigned int normalIndex = data.normalIndices[i];
+		if( vertexIndex - 1 >= data.vertices.size() || (uvIndex != 0 && uvIndex - 1 >= data.uvs.size()) || (normalIndex != 0 && normalIndex - 1 >= data.normals.size()) ){
+			printf("Face %u references an attribute that doesn't exist\n", (unsigned int)(i / 3 + 1));
+			out_indices.resize(firstIndex);
+			out_vertices.resize(base);
+			out_uvs     .resize(base);
+			out_normals .resize(base);
+			return false;
+		}
+
+		unsigned int next = (unsigned int)out_vertices.size();
+		unsigned int index = map.findOrInsert(vertexIndex, uvIndex, normalIndex, next);
+		if( index == next ){
+			out_vertices.push_back(data.vertices[vertexIndex - 1]);
+			out_uvs     .push_back(uvIndex ? data.uvs[uvIndex - 1] : glm::vec2(0.0f));
+			out_normals .push_back(normalIndex ? data.normals[normalIndex - 1] : glm::vec3(0.0f));
+		}
+		out_indices.push_back(index);
+	}
+	return true;
+}
+
+// Slot of a run index when sorting : 0 for none, index + 1 otherwise.
+static unsigned int runSlot(unsigned int index) {
+	return index == MESH_NO_MATERIAL ? 0 : index + 1;
+}
+
+// Faces [first, last) all in the same group and material slots.
+struct OBJSegment {
+	unsigned int group;
+	unsigned int material;
+	unsigned int first;
+	unsigned int last;
+};
+
+static bool segmentBefore(const OBJSegment & a, const OBJSegment & b) {
+	return a.group != b.group ? a.group < b.group : a.material < b.material;
+}
+
+void groupOBJ(
+	const OBJData & data,
+	const std::vector<glm::vec3> & vertices,
+	std::vector<unsigned int> & indices,
+	std::vector<MeshPart> & out_parts,
+	std::vector<MeshGroup> & out_groups
+){
+	unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+
+	// Cut the faces wherever the group or the material changes. There are only as many cuts as o, g and usemtl lines.
+	std::vector<OBJSegment> segments;
+	size_t groupRun = 0, materialRun = 0;
+	unsigned int groupSlot = 0, materialSlot = 0;
+	for( unsigned int t = 0; t < triangleCount; ){
+		for( ; groupRun < data.groupRuns.size() && data.groupRuns[groupRun].firstTriangle <= t; groupRun++ )
+			groupSlot = runSlot(data.groupRuns[groupRun].index);
+		for( ; materialRun < data.materialRuns.size() && data.materialRuns[materialRun].firstTriangle <= t; materialRun++ )
+			materialSlot = runSlot(data.materialRuns[materialRun].index);
+		unsigned int next = triangleCount;
+		if( groupRun < data.groupRuns.size() )
+			next = std::min(next, data.groupRuns[groupRun].firstTriangle);
+		if( materialRun < data.materialRuns.size() )
+			next = std::min(next, data.materialRuns[materialRun].firstTriangle);
+		OBJSegment segment = { groupSlot, materialSlot, t, next };
+		segments.push_back(segment);
+		t = next;
+	}
+	// Stable, so each part keeps the file's face order
+	std::stable_sort(segments.begin(), segments.end(), segmentBefore);
+
+	// Lay the segments out in that order, and gather the bounds while the triangles go by
+	bool moves = segments.size() > 1;
+	std::vector<unsigned int> sorted(moves ? indices.size() : 0);
+	unsigned int cursor = 0;
+	for( size_t s = 0; s < segments.size(); s++ ){
+		const OBJSegment & segment = segments[s];
+		bool newGroup = s == 0 || segment.group != segments[s - 1].group;
+		if( newGroup ){
+			MeshGroup group;
+			group.name = segment.group == 0 ? std::string() : data.groups[segment.group - 1];
+			group.firstPart = (unsigned int)out_parts.size();
+			group.partCount = 0;
+			group.firstIndex = cursor;
+			group.indexCount = 0;
+			group.boundsMin = glm::vec3(FLT_MAX);
+			group.boundsMax = glm::vec3(-FLT_MAX);
+			out_groups.push_back(group);
+		}
+		if( newGroup || segment.material != segments[s - 1].material ){
+			MeshPart part;
+			part.material = segment.material == 0 ? MESH_NO_MATERIAL : segment.material - 1;
+			part.firstIndex = cursor;
+			part.indexCount = 0;
+			out_parts.push_back(part);
+			out_groups.back().partCount++;
+		}
+
+		MeshGroup & group = out_groups.back();
+		unsigned int count = (segment.last - segment.first) * 3;
+		const unsigned int * source = &indices[segment.first * 3];
+		for( unsigned int i = 0; i < count; i++ ){
+			const glm::vec3 & position = vertices[source[i]];
+			group.boundsMin = glm::min(group.boundsMin, position);
+			group.boundsMax = glm::max(group.boundsMax, position);
+		}
+		if( moves )
+			memcpy(&sorted[cursor], source, count * sizeof(unsigned int));
+		out_parts.back().indexCount += count;
+		group.indexCount += count;
+		cursor += count;
+	}
+	if( moves )
+		indices.swap(sorted);
+
+	// The sphere around the box is looser than the tightest one, but it comes for free
+	for( size_t g = 0; g < out_groups.size(); g++ ){
+		MeshGroup & group = out_groups[g];
+		group.center = (group.boundsMin + group.boundsMax) * 0.5f;
+		group.radius = glm::length(group.boundsMax - group.boundsMin) * 0.5f;
+	}
+}
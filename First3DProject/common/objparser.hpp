@@ -0,0 +1,84 @@
+#ifndef OBJPARSER_HPP
+#define OBJPARSER_HPP
+
+#include <vector>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// From firstTriangle on (until the next run starts), faces use the name at index in materials or groups.
+// A material run whose index is MESH_NO_MATERIAL removes the material.
+struct OBJRun {
+	unsigned int index;
+	unsigned int firstTriangle;
+};
+
+// Everything a triangulated OBJ file declares, before de-indexing :
+// the attribute pools and the 1-based (v, vt, vn) indices of every triangle corner (0 for a vt or vn the face doesn't give),
+// plus the material libraries, and which material and which group each face belongs to.
+struct OBJData {
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+
+	std::vector<std::string> materialLibraries; // mtllib arguments, in file order
+	std::vector<std::string> materials;         // usemtl names, in order of first use
+	std::vector<OBJRun> materialRuns;           // faces before the first run have no material
+	std::vector<std::string> groups;            // o and g names, in order of first use
+	std::vector<OBJRun> groupRuns;              // faces before the first run are in an unnamed group
+};
+
+// Parses the OBJ text in [begin, end) in one pass over the bytes and appends it to data.
+// No stdio, no locale, no copies : numbers are read straight out of the buffer.
+// Faces are f v, f v/vt, f v//vn or f v/vt/vn, with any number of corners (fanned into triangles)
+// and negative indices, which count back from the last element declared before the face.
+bool parseOBJ(const char * begin, const char * end, OBJData & data);
+
+// Same as parseOBJ, for the whole lines in [begin, end) of a larger buffer that starts at file.
+// Attribute indices keep referring to the whole file, and error messages give line numbers within it.
+bool parseOBJRange(const char * file, const char * begin, const char * end, OBJData & data);
+
+// Same as parseOBJ, but the buffer is cut at line boundaries and the slices are parsed by threadCount threads.
+// The slices are stitched back in file order, so the result is bit-identical to parseOBJ.
+bool parseOBJParallel(const char * begin, const char * end, OBJData & data, unsigned int threadCount);
+
+// Number of threads the parallel paths use when asked for "all cores".
+unsigned int defaultOBJThreadCount();
+
+// Expands every triangle corner of data into its own vertex, exactly like loadOBJ always did.
+// Missing UVs are (0, 0) and missing normals (0, 0, 0).
+bool expandOBJ(
+	const OBJData & data,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	unsigned int threadCount = 1
+);
+
+// Builds an indexed mesh out of data : every distinct (v, vt, vn) triplet becomes one vertex,
+// and out_indices holds three vertex indices per triangle. Vertices are numbered in order of first use.
+// Missing UVs and normals are zero, like in expandOBJ.
+bool indexOBJ(
+	const OBJData & data,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
+
+// Reorders the triangles of indices (which follow the faces of data, 3 per face) by group, then by material,
+// and appends one group per o/g name to out_groups and one part per material of each group to out_parts.
+// Parts carry the materials of data.materialRuns. The order of the faces within one part is kept.
+// The group bounds are gathered from vertices while the triangles are moved.
+void groupOBJ(
+	const OBJData & data,
+	const std::vector<glm::vec3> & vertices,
+	std::vector<unsigned int> & indices,
+	std::vector<MeshPart> & out_parts,
+	std::vector<MeshGroup> & out_groups
+);
+
+#endif
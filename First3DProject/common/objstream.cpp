@@ -0,0 +1,144 @@
+#include <vector>
+#include <stdio.h>
+#include <cstring>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "objstream.hpp"
+#include "meshnormals.hpp"
+
+// Bytes of OBJ text parsed at once : large enough to amortize the bookkeeping, small enough to stay in cache.
+static const size_t sliceBytes = 256 * 1024;
+
+// Number of triangles in the file : a face of n corners is fanned into n - 2 triangles.
+static size_t countTriangles(const char * p, const char * end) {
+	size_t count = 0;
+	while( p < end ){
+		while( p < end && (*p == ' ' || *p == '\t') )
+			++p;
+		const char * eol = (const char *)memchr(p, '\n', end - p);
+		const char * lineEnd = eol ? eol : end;
+		if( lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t') ){
+			size_t corners = 0;
+			for( const char * q = p + 1; q < lineEnd && *q != '#'; ){
+				while( q < lineEnd && (*q == ' ' || *q == '\t' || *q == '\r') )
+					++q;
+				if( q >= lineEnd || *q == '#' )
+					break;
+				corners++;
+				while( q < lineEnd && *q != ' ' && *q != '\t' && *q != '\r' )
+					++q;
+			}
+			if( corners >= 3 )
+				count += corners - 2;
+		}
+		p = eol ? eol + 1 : end;
+	}
+	return count;
+}
+
+OBJStream::OBJStream() : mBegin(NULL), mEnd(NULL), mCursor(NULL), mPendingStart(0), mTriangleCount(0), mTrianglesRead(0), mFailed(false) {
+}
+
+bool OBJStream::open(const char * path) {
+	close();
+	if( !mFile.open(path) ){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+	return open(mFile.data(), mFile.size());
+}
+
+bool OBJStream::open(const char * buffer, size_t size) {
+	if( mFile.data() != buffer )
+		close();
+	mBegin = mCursor = buffer;
+	mEnd = buffer + size;
+	mTriangleCount = countTriangles(mBegin, mEnd);
+	return true;
+}
+
+void OBJStream::close() {
+	mFile.close();
+	mBegin = mEnd = mCursor = NULL;
+	mData = OBJData();
+	mPending = OBJBatch();
+	mPendingStart = 0;
+	mTriangleCount = 0;
+	mTrianglesRead = 0;
+	mFailed = false;
+}
+
+bool OBJStream::parseSlice() {
+	const char * end = mEnd;
+	const char * sliceEnd = end;
+	if( (size_t)(end - mCursor) > sliceBytes ){
+		const char * eol = (const char *)memchr(mCursor + sliceBytes, '\n', end - (mCursor + sliceBytes));
+		sliceEnd = eol ? eol + 1 : end;
+	}
+
+	// Drop what was already handed out before appending more
+	mPending.vertices.erase(mPending.vertices.begin(), mPending.vertices.begin() + mPendingStart);
+	mPending.uvs     .erase(mPending.uvs.begin(), mPending.uvs.begin() + mPendingStart);
+	mPending.normals .erase(mPending.normals.begin(), mPending.normals.begin() + mPendingStart);
+	mPendingStart = 0;
+
+	size_t firstVertex = mPending.vertices.size();
+	bool parsed = parseOBJRange(mBegin, mCursor, sliceEnd, mData)
+		&& expandOBJ(mData, mPending.vertices, mPending.uvs, mPending.normals);
+
+	// Like loadOBJ, corners without a normal get a smooth one ; only the slice's triangles are smoothed together,
+	// so a crease may show where two slices meet
+	if( parsed && std::find(mData.normalIndices.begin(), mData.normalIndices.end(), 0u) != mData.normalIndices.end() ){
+		size_t count = mPending.vertices.size() - firstVertex;
+		std::vector<glm::vec3> smooth(count);
+		computeSmoothNormals(NULL, count, &mPending.vertices[firstVertex], count, smooth.data());
+		for( size_t v = 0; v < count; v++ )
+			if( mPending.normals[firstVertex + v] == glm::vec3(0.0f) )
+				mPending.normals[firstVertex + v] = smooth[v];
+	}
+	mData.vertexIndices.clear();
+	mData.uvIndices.clear();
+	mData.normalIndices.clear();
+	mData.materialRuns.clear(); // streamed batches carry no material nor group
+	mData.groupRuns.clear();
+	mCursor = sliceEnd;
+	return parsed;
+}
+
+bool OBJStream::next(OBJBatch & batch, size_t batchTriangles) {
+	if( !isOpen() || mFailed || batchTriangles == 0 )
+		return false;
+
+	const char * end = mEnd;
+	size_t wanted = batchTriangles * 3;
+	while( mPending.vertices.size() - mPendingStart < wanted && mCursor < end ){
+		if( !parseSlice() ){
+			mFailed = true;
+			return false;
+		}
+	}
+
+	size_t count = std::min(wanted, mPending.vertices.size() - mPendingStart);
+	if( count == 0 )
+		return false;
+
+	batch.firstTriangle = mTrianglesRead;
+	batch.vertices.assign(mPending.vertices.begin() + mPendingStart, mPending.vertices.begin() + mPendingStart + count);
+	batch.uvs     .assign(mPending.uvs.begin() + mPendingStart, mPending.uvs.begin() + mPendingStart + count);
+	batch.normals .assign(mPending.normals.begin() + mPendingStart, mPending.normals.begin() + mPendingStart + count);
+	mPendingStart += count;
+	mTrianglesRead += count / 3;
+	return true;
+}
+
+bool streamOBJ(const char * path, size_t batchTriangles, void (*onBatch)(const OBJBatch & batch, void * user), void * user) {
+	OBJStream stream;
+	if( !stream.open(path) )
+		return false;
+	OBJBatch batch;
+	while( stream.next(batch, batchTriangles) )
+		onBatch(batch, user);
+	return !stream.failed();
+}
@@ -0,0 +1,70 @@
+#ifndef OBJSTREAM_HPP
+#define OBJSTREAM_HPP
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "mappedfile.hpp"
+#include "objparser.hpp"
+
+// A run of de-indexed triangles, 3 vertices each, like loadOBJ would output them.
+// Missing normals are smoothed over the triangles of one slice of the file at a time, not over the whole mesh.
+struct OBJBatch {
+	size_t firstTriangle; // position of the batch's first triangle in the whole mesh
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+};
+
+// Streaming OBJ reader : the file is parsed a slice at a time and handed out in fixed-size triangle batches.
+// Only the v/vt/vn pools (which any later face may reference) and the current slice are kept in memory,
+// never the whole index lists nor the whole de-indexed mesh.
+//
+//   OBJStream stream;
+//   stream.open(path);
+//   OBJBatch batch;
+//   while( stream.next(batch, 4096) )
+//       upload(batch);
+class OBJStream {
+public:
+	OBJStream();
+
+	// Maps the file and counts its triangles, so that GPU buffers can be sized before the first batch.
+	bool open(const char * path);
+	// Streams OBJ text that is already in memory. The buffer must outlive the stream.
+	bool open(const char * buffer, size_t size);
+	void close();
+	bool isOpen() const { return mBegin != NULL; }
+
+	size_t triangleCount() const { return mTriangleCount; }
+	size_t trianglesRead() const { return mTrianglesRead; }
+	bool failed() const { return mFailed; }
+
+	// Fills batch with the next batchTriangles triangles (fewer for the last batch).
+	// Returns false once the file is exhausted, or when it turns out to be malformed (see failed()).
+	bool next(OBJBatch & batch, size_t batchTriangles);
+
+private:
+	OBJStream(const OBJStream &);
+	OBJStream & operator=(const OBJStream &);
+
+	bool parseSlice();
+
+	MappedFile mFile;
+	const char * mBegin;
+	const char * mEnd;
+	const char * mCursor;
+	OBJData mData;        // attribute pools, plus the faces of the current slice only
+	OBJBatch mPending;    // de-indexed triangles not handed out yet
+	size_t mPendingStart; // first vertex of mPending that still has to go out
+	size_t mTriangleCount;
+	size_t mTrianglesRead;
+	bool mFailed;
+};
+
+// Callback flavour of OBJStream : calls onBatch for every batch of batchTriangles triangles.
+bool streamOBJ(const char * path, size_t batchTriangles, void (*onBatch)(const OBJBatch & batch, void * user), void * user);
+
+#endif
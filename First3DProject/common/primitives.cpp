@@ -0,0 +1,54 @@
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "primitives.hpp"
+
+// Empties mesh and sizes its arrays for the primitive, which the builders then append to.
+static void resetMesh(Mesh & mesh, size_t vertexCount, size_t indexCount) {
+	mesh = Mesh();
+	mesh.vertices.reserve(vertexCount);
+	mesh.uvs.reserve(vertexCount);
+	mesh.normals.reserve(vertexCount);
+	mesh.indices.reserve(indexCount);
+}
+
+void generateBox(Mesh & mesh, float width, float height, float depth, unsigned int subdivisions) {
+	subdivisions = std::max(subdivisions, 1u);
+	resetMesh(mesh, boxVertexCount(subdivisions), boxIndexCount(subdivisions));
+	MeshPrimitiveOutput out(mesh);
+	buildBox(out, width, height, depth, subdivisions);
+}
+
+void generatePlane(Mesh & mesh, float width, float depth, unsigned int subdivisionsX, unsigned int subdivisionsZ) {
+	subdivisionsX = std::max(subdivisionsX, 1u);
+	subdivisionsZ = std::max(subdivisionsZ, 1u);
+	resetMesh(mesh, planeVertexCount(subdivisionsX, subdivisionsZ), planeIndexCount(subdivisionsX, subdivisionsZ));
+	MeshPrimitiveOutput out(mesh);
+	buildPlane(out, width, depth, subdivisionsX, subdivisionsZ);
+}
+
+void generateCylinder(Mesh & mesh, float radius, float height, unsigned int segments, unsigned int stacks) {
+	segments = std::max(segments, 3u);
+	stacks = std::max(stacks, 1u);
+	resetMesh(mesh, cylinderVertexCount(segments, stacks), cylinderIndexCount(segments, stacks));
+	MeshPrimitiveOutput out(mesh);
+	buildCylinder(out, radius, height, segments, stacks);
+}
+
+void generateSphere(Mesh & mesh, float radius, unsigned int segments, unsigned int rings) {
+	segments = std::max(segments, 3u);
+	rings = std::max(rings, 2u);
+	resetMesh(mesh, sphereVertexCount(segments, rings), sphereIndexCount(segments, rings));
+	MeshPrimitiveOutput out(mesh);
+	buildSphere(out, radius, segments, rings);
+}
+
+void generateTorus(Mesh & mesh, float majorRadius, float minorRadius, unsigned int segments, unsigned int sides) {
+	segments = std::max(segments, 3u);
+	sides = std::max(sides, 3u);
+	resetMesh(mesh, torusVertexCount(segments, sides), torusIndexCount(segments, sides));
+	MeshPrimitiveOutput out(mesh);
+	buildTorus(out, majorRadius, minorRadius, segments, sides);
+}
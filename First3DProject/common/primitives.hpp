@@ -0,0 +1,312 @@
+#ifndef PRIMITIVES_HPP
+#define PRIMITIVES_HPP
+
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// Parametric primitives, built as indexed triangles without any file : box, plane, cylinder, sphere and torus.
+//
+// Every primitive is centered on the origin, with counter-clockwise front faces, unit normals, and UVs in [0, 1]
+// with V inverted like loadOBJ does (see objloader.cpp). The same builders run at compile time for small fixed
+// tessellations, e.g.
+//
+//     constexpr auto box = boxArrays<1>(1.0f, 1.0f, 1.0f); // 24 vertices and 36 indices in the binary
+//
+// and at run time straight into a Mesh, see generateBox and the others at the bottom.
+
+// Vertex and index counts, so that arrays can be sized at compile time.
+constexpr size_t boxVertexCount(unsigned int subdivisions) { return 6 * (size_t)(subdivisions + 1) * (subdivisions + 1); }
+constexpr size_t boxIndexCount(unsigned int subdivisions) { return 36 * (size_t)subdivisions * subdivisions; }
+constexpr size_t planeVertexCount(unsigned int subdivisionsX, unsigned int subdivisionsZ) { return (size_t)(subdivisionsX + 1) * (subdivisionsZ + 1); }
+constexpr size_t planeIndexCount(unsigned int subdivisionsX, unsigned int subdivisionsZ) { return 6 * (size_t)subdivisionsX * subdivisionsZ; }
+constexpr size_t cylinderVertexCount(unsigned int segments, unsigned int stacks) { return (size_t)(segments + 1) * (stacks + 1) + 2 * (size_t)(segments + 1); }
+constexpr size_t cylinderIndexCount(unsigned int segments, unsigned int stacks) { return 6 * (size_t)segments * stacks + 6 * (size_t)segments; }
+constexpr size_t sphereVertexCount(unsigned int segments, unsigned int rings) { return (size_t)(segments + 1) * (rings + 1); }
+constexpr size_t sphereIndexCount(unsigned int segments, unsigned int rings) { return 6 * (size_t)segments * (rings - 1); }
+constexpr size_t torusVertexCount(unsigned int segments, unsigned int sides) { return (size_t)(segments + 1) * (sides + 1); }
+constexpr size_t torusIndexCount(unsigned int segments, unsigned int sides) { return 6 * (size_t)segments * sides; }
+
+// Fixed size vertex and index arrays a primitive is built into at compile time.
+template <size_t VertexCount, size_t IndexCount>
+struct PrimitiveArrays {
+	constexpr PrimitiveArrays() : positions(), uvs(), normals(), indices(), vertexCount(0), indexCount(0) {}
+
+	constexpr unsigned int addVertex(float px, float py, float pz, float u, float v, float nx, float ny, float nz) {
+		positions[vertexCount * 3] = px; positions[vertexCount * 3 + 1] = py; positions[vertexCount * 3 + 2] = pz;
+		uvs[vertexCount * 2] = u; uvs[vertexCount * 2 + 1] = v;
+		normals[vertexCount * 3] = nx; normals[vertexCount * 3 + 1] = ny; normals[vertexCount * 3 + 2] = nz;
+		return (unsigned int)vertexCount++;
+	}
+	constexpr void addTriangle(unsigned int a, unsigned int b, unsigned int c) {
+		indices[indexCount++] = a;
+		indices[indexCount++] = b;
+		indices[indexCount++] = c;
+	}
+
+	float positions[VertexCount * 3];
+	float uvs[VertexCount * 2];
+	float normals[VertexCount * 3];
+	unsigned int indices[IndexCount];
+	size_t vertexCount; // filled so far, VertexCount once built
+	size_t indexCount;
+};
+
+// Builds into the vertex and index arrays of a Mesh at run time, for the same builders.
+class MeshPrimitiveOutput {
+public:
+	explicit MeshPrimitiveOutput(Mesh & mesh) : mMesh(mesh) {}
+
+	unsigned int addVertex(float px, float py, float pz, float u, float v, float nx, float ny, float nz) {
+		mMesh.vertices.push_back(glm::vec3(px, py, pz));
+		mMesh.uvs.push_back(glm::vec2(u, v));
+		mMesh.normals.push_back(glm::vec3(nx, ny, nz));
+		return (unsigned int)mMesh.vertices.size() - 1;
+	}
+	void addTriangle(unsigned int a, unsigned int b, unsigned int c) {
+		mMesh.indices.push_back(a);
+		mMesh.indices.push_back(b);
+		mMesh.indices.push_back(c);
+	}
+
+private:
+	Mesh & mMesh;
+};
+
+// sin and cos that can run at compile time, where <cmath> can't : a Taylor series after reducing x to [-pi, pi].
+// Accurate to a few units in the last place of a double, so the builders agree with <cmath> on every float.
+constexpr double primitiveSin(double x) {
+	const double pi = 3.14159265358979323846;
+	while( x > pi )
+		x -= 2.0 * pi;
+	while( x < -pi )
+		x += 2.0 * pi;
+	double term = x, sum = x;
+	for( int n = 1; n < 14; n++ ){
+		term *= -x * x / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double primitiveCos(double x) {
+	return primitiveSin(x + 3.14159265358979323846 / 2.0);
+}
+
+// Two triangles per cell of a grid of (columns + 1) x (rows + 1) vertices numbered row by row from first,
+// counter-clockwise when columns go right and rows go up.
+template <typename Output>
+constexpr void buildGridTriangles(Output & out, unsigned int first, unsigned int columns, unsigned int rows) {
+	for( unsigned int j = 0; j < rows; j++ ){
+		for( unsigned int i = 0; i < columns; i++ ){
+			unsigned int a = first + j * (columns + 1) + i;
+			unsigned int d = a + columns + 1;
+			out.addTriangle(a, a + 1, d + 1);
+			out.addTriangle(a, d + 1, d);
+		}
+	}
+}
+
+// A box of the given size, each face cut into subdivisions x subdivisions quads with its own vertices,
+// so that the edges stay sharp.
+template <typename Output>
+constexpr void buildBox(Output & out, float width, float height, float depth, unsigned int subdivisions) {
+	// Normal, then the axes U and V go along, with U x V = normal so the grid faces outwards
+	const float faces[6][9] = {
+		{  1, 0, 0,   0, 0, -1,   0, 1, 0 },
+		{ -1, 0, 0,   0, 0,  1,   0, 1, 0 },
+		{  0, 1, 0,   1, 0,  0,   0, 0, -1 },
+		{  0,-1, 0,   1, 0,  0,   0, 0, 1 },
+		{  0, 0, 1,   1, 0,  0,   0, 1, 0 },
+		{  0, 0,-1,  -1, 0,  0,   0, 1, 0 }
+	};
+	const float size[3] = { width, height, depth };
+	for( int f = 0; f < 6; f++ ){
+		const float * n = faces[f];
+		const float * u = faces[f] + 3;
+		const float * v = faces[f] + 6;
+		unsigned int first = 0;
+		for( unsigned int j = 0; j <= subdivisions; j++ ){
+			for( unsigned int i = 0; i <= subdivisions; i++ ){
+				float s = (float)i / subdivisions, t = (float)j / subdivisions;
+				float p[3] = { 0, 0, 0 };
+				for( int k = 0; k < 3; k++ )
+					p[k] = (n[k] * 0.5f + u[k] * (s - 0.5f) + v[k] * (t - 0.5f)) * size[k];
+				unsigned int index = out.addVertex(p[0], p[1], p[2], s, -t, n[0], n[1], n[2]);
+				if( i == 0 && j == 0 )
+					first = index;
+			}
+		}
+		buildGridTriangles(out, first, subdivisions, subdivisions);
+	}
+}
+
+// A plane in XZ facing up (+Y).
+template <typename Output>
+constexpr void buildPlane(Output & out, float width, float depth, unsigned int subdivisionsX, unsigned int subdivisionsZ) {
+	unsigned int first = 0;
+	for( unsigned int j = 0; j <= subdivisionsZ; j++ ){
+		for( unsigned int i = 0; i <= subdivisionsX; i++ ){
+			float s = (float)i / subdivisionsX, t = (float)j / subdivisionsZ;
+			unsigned int index = out.addVertex((s - 0.5f) * width, 0.0f, (0.5f - t) * depth, s, -t, 0.0f, 1.0f, 0.0f);
+			if( i == 0 && j == 0 )
+				first = index;
+		}
+	}
+	buildGridTriangles(out, first, subdivisionsX, subdivisionsZ);
+}
+
+// A cylinder along Y : segments around, stacks along its height, closed by two caps with their own flat normals.
+// The side has a seam of duplicated vertices, where U wraps from 1 back to 0.
+template <typename Output>
+constexpr void buildCylinder(Output & out, float radius, float height, unsigned int segments, unsigned int stacks) {
+	const double pi = 3.14159265358979323846;
+	unsigned int first = 0;
+	for( unsigned int j = 0; j <= stacks; j++ ){
+		for( unsigned int i = 0; i <= segments; i++ ){
+			double angle = 2.0 * pi * (i % segments) / segments;
+			float x = (float)primitiveSin(angle), z = (float)primitiveCos(angle);
+			float s = (float)i / segments, t = (float)j / stacks;
+			unsigned int index = out.addVertex(x * radius, (t - 0.5f) * height, z * radius, s, -t, x, 0.0f, z);
+			if( i == 0 && j == 0 )
+				first = index;
+		}
+	}
+	buildGridTriangles(out, first, segments, stacks);
+
+	for( int cap = 0; cap < 2; cap++ ){
+		float y = cap ? 0.5f : -0.5f;
+		float normal = cap ? 1.0f : -1.0f;
+		unsigned int center = out.addVertex(0.0f, y * height, 0.0f, 0.5f, -0.5f, 0.0f, normal, 0.0f);
+		for( unsigned int i = 0; i < segments; i++ ){
+			double angle = 2.0 * pi * i / segments;
+			float x = (float)primitiveSin(angle), z = (float)primitiveCos(angle);
+			out.addVertex(x * radius, y * height, z * radius, 0.5f + 0.5f * x, -(0.5f + 0.5f * z), 0.0f, normal, 0.0f);
+		}
+		for( unsigned int i = 0; i < segments; i++ ){
+			unsigned int a = center + 1 + i, b = center + 1 + (i + 1) % segments;
+			if( cap )
+				out.addTriangle(center, a, b);
+			else
+				out.addTriangle(center, b, a);
+		}
+	}
+}
+
+// A UV sphere : segments around Y, rings from the south pole to the north pole.
+// The poles are single triangles per segment, not quads squashed into a point.
+template <typename Output>
+constexpr void buildSphere(Output & out, float radius, unsigned int segments, unsigned int rings) {
+	const double pi = 3.14159265358979323846;
+	unsigned int first = 0;
+	for( unsigned int j = 0; j <= rings; j++ ){
+		double latitude = pi * j / rings;
+		float y = j == 0 ? -1.0f : j == rings ? 1.0f : (float)-primitiveCos(latitude);
+		float ring = j == 0 || j == rings ? 0.0f : (float)primitiveSin(latitude);
+		for( unsigned int i = 0; i <= segments; i++ ){
+			double angle = 2.0 * pi * (i % segments) / segments;
+			float x = ring * (float)primitiveSin(angle), z = ring * (float)primitiveCos(angle);
+			unsigned int index = out.addVertex(x * radius, y * radius, z * radius, (float)i / segments, -(float)j / rings, x, y, z);
+			if( i == 0 && j == 0 )
+				first = index;
+		}
+	}
+	for( unsigned int j = 0; j < rings; j++ ){
+		for( unsigned int i = 0; i < segments; i++ ){
+			unsigned int a = first + j * (segments + 1) + i;
+			unsigned int d = a + segments + 1;
+			if( j != 0 )
+				out.addTriangle(a, a + 1, d + 1);
+			if( j != rings - 1 )
+				out.addTriangle(a, d + 1, d);
+		}
+	}
+}
+
+// A torus around Y : segments around Y, sides around the tube. majorRadius is the distance from the center
+// to the middle of the tube, minorRadius the radius of the tube.
+template <typename Output>
+constexpr void buildTorus(Output & out, float majorRadius, float minorRadius, unsigned int segments, unsigned int sides) {
+	const double pi = 3.14159265358979323846;
+	unsigned int first = 0;
+	for( unsigned int j = 0; j <= sides; j++ ){
+		double tube = 2.0 * pi * (j % sides) / sides;
+		float outwards = (float)primitiveCos(tube), y = (float)primitiveSin(tube);
+		for( unsigned int i = 0; i <= segments; i++ ){
+			double angle = 2.0 * pi * (i % segments) / segments;
+			float sine = (float)primitiveSin(angle), cosine = (float)primitiveCos(angle);
+			float distance = majorRadius + minorRadius * outwards;
+			unsigned int index = out.addVertex(sine * distance, y * minorRadius, cosine * distance,
+				(float)i / segments, -(float)j / sides, sine * outwards, y, cosine * outwards);
+			if( i == 0 && j == 0 )
+				first = index;
+		}
+	}
+	buildGridTriangles(out, first, segments, sides);
+}
+
+// Compile-time primitives, tessellation given as template arguments.
+template <unsigned int Subdivisions>
+constexpr PrimitiveArrays<boxVertexCount(Subdivisions), boxIndexCount(Subdivisions)> boxArrays(float width, float height, float depth) {
+	static_assert(Subdivisions >= 1, "a box needs at least one quad per face");
+	PrimitiveArrays<boxVertexCount(Subdivisions), boxIndexCount(Subdivisions)> out;
+	buildBox(out, width, height, depth, Subdivisions);
+	return out;
+}
+
+template <unsigned int SubdivisionsX, unsigned int SubdivisionsZ>
+constexpr PrimitiveArrays<planeVertexCount(SubdivisionsX, SubdivisionsZ), planeIndexCount(SubdivisionsX, SubdivisionsZ)> planeArrays(float width, float depth) {
+	static_assert(SubdivisionsX >= 1 && SubdivisionsZ >= 1, "a plane needs at least one quad");
+	PrimitiveArrays<planeVertexCount(SubdivisionsX, SubdivisionsZ), planeIndexCount(SubdivisionsX, SubdivisionsZ)> out;
+	buildPlane(out, width, depth, SubdivisionsX, SubdivisionsZ);
+	return out;
+}
+
+template <unsigned int Segments, unsigned int Stacks>
+constexpr PrimitiveArrays<cylinderVertexCount(Segments, Stacks), cylinderIndexCount(Segments, Stacks)> cylinderArrays(float radius, float height) {
+	static_assert(Segments >= 3 && Stacks >= 1, "a cylinder needs at least 3 segments and 1 stack");
+	PrimitiveArrays<cylinderVertexCount(Segments, Stacks), cylinderIndexCount(Segments, Stacks)> out;
+	buildCylinder(out, radius, height, Segments, Stacks);
+	return out;
+}
+
+template <unsigned int Segments, unsigned int Rings>
+constexpr PrimitiveArrays<sphereVertexCount(Segments, Rings), sphereIndexCount(Segments, Rings)> sphereArrays(float radius) {
+	static_assert(Segments >= 3 && Rings >= 2, "a sphere needs at least 3 segments and 2 rings");
+	PrimitiveArrays<sphereVertexCount(Segments, Rings), sphereIndexCount(Segments, Rings)> out;
+	buildSphere(out, radius, Segments, Rings);
+	return out;
+}
+
+template <unsigned int Segments, unsigned int Sides>
+constexpr PrimitiveArrays<torusVertexCount(Segments, Sides), torusIndexCount(Segments, Sides)> torusArrays(float majorRadius, float minorRadius) {
+	static_assert(Segments >= 3 && Sides >= 3, "a torus needs at least 3 segments and 3 sides");
+	PrimitiveArrays<torusVertexCount(Segments, Sides), torusIndexCount(Segments, Sides)> out;
+	buildTorus(out, majorRadius, minorRadius, Segments, Sides);
+	return out;
+}
+
+// Replaces the vertices and indices of mesh with arrays built at compile time.
+template <size_t VertexCount, size_t IndexCount>
+void assignPrimitive(Mesh & mesh, const PrimitiveArrays<VertexCount, IndexCount> & arrays) {
+	mesh = Mesh();
+	const glm::vec3 * positions = (const glm::vec3 *)arrays.positions;
+	const glm::vec2 * uvs = (const glm::vec2 *)arrays.uvs;
+	const glm::vec3 * normals = (const glm::vec3 *)arrays.normals;
+	mesh.vertices.assign(positions, positions + VertexCount);
+	mesh.uvs.assign(uvs, uvs + VertexCount);
+	mesh.normals.assign(normals, normals + VertexCount);
+	mesh.indices.assign(arrays.indices, arrays.indices + IndexCount);
+}
+
+// Run-time primitives : replace mesh with the primitive, ready for the VBO. Tessellations below the minimum
+// (1 subdivision or stack, 3 segments or sides, 2 rings) are raised to it.
+void generateBox(Mesh & mesh, float width = 1.0f, float height = 1.0f, float depth = 1.0f, unsigned int subdivisions = 1);
+void generatePlane(Mesh & mesh, float width = 1.0f, float depth = 1.0f, unsigned int subdivisionsX = 1, unsigned int subdivisionsZ = 1);
+void generateCylinder(Mesh & mesh, float radius = 0.5f, float height = 1.0f, unsigned int segments = 32, unsigned int stacks = 1);
+void generateSphere(Mesh & mesh, float radius = 0.5f, unsigned int segments = 32, unsigned int rings = 16);
+void generateTorus(Mesh & mesh, float majorRadius = 0.5f, float minorRadius = 0.2f, unsigned int segments = 32, unsigned int sides = 16);
+
+#endif
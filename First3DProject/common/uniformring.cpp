@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include "uniformring.hpp"
+
+static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms is read by the shaders as is, std140");
+static_assert(sizeof(ObjectUniforms) == 224, "ObjectUniforms is read by the shaders as is, std140");
+
+void setObjectUniforms(ObjectUniforms & out, const glm::mat4 & model, const glm::mat4 & viewProjection, const glm::vec3 & color,
+                       const glm::vec3 & positionScale, const glm::vec3 & positionOffset, float normalScale) {
+	out.M = model;
+	out.MVP = viewProjection * model;
+	glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(model));
+	for( int c = 0; c < 3; c++ )
+		out.normalMatrix[c] = glm::vec4(normalMatrix[c], 0.0f);
+	out.color = glm::vec4(color, 1.0f);
+	out.positionScale = glm::vec4(positionScale, normalScale);
+	out.positionOffset = glm::vec4(positionOffset, 0.0f);
+}
+
+UniformRing::UniformRing() : mBuffer(0), mMapped(NULL), mAlignment(256), mRegionSize(0), mRegion(0), mUsed(0) {
+	for( int r = 0; r < REGION_COUNT; r++ )
+		mFences[r] = 0;
+}
+
+UniformRing::~UniformRing() {
+	destroy();
+}
+
+bool UniformRing::create(size_t frameBytes) {
+	destroy();
+	GLint alignment = 0, storageAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if( GLEW_VERSION_4_3 )
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	mAlignment = std::max(std::max(alignment, storageAlignment), 1);
+	mRegionSize = alignedSize(frameBytes);
+	mRegion = 0;
+	mUsed = 0;
+
+	glGenBuffers(1, &mBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+	if( GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage ){
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, mRegionSize * REGION_COUNT, NULL, flags);
+		mMapped = (unsigned char *)glMapBufferRange(GL_UNIFORM_BUFFER, 0, mRegionSize * REGION_COUNT, flags);
+		if( mMapped == NULL ){
+			printf("Uniform ring : persistent mapping failed, staging uniforms instead\n");
+			glDeleteBuffers(1, &mBuffer);
+			glGenBuffers(1, &mBuffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+		}
+	}
+	if( mMapped == NULL ){
+		glBufferData(GL_UNIFORM_BUFFER, mRegionSize, NULL, GL_STREAM_DRAW);
+		mStaging.resize(mRegionSize);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return true;
+}
+
+void UniformRing::destroy() {
+	for( int r = 0; r < REGION_COUNT; r++ ){
+		if( mFences[r] != 0 )
+			glDeleteSync(mFences[r]);
+		mFences[r] = 0;
+	}
+	if( mBuffer == 0 )
+		return;
+	if( mMapped != NULL ){
+		glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		mMapped = NULL;
+	}
+	glDeleteBuffers(1, &mBuffer);
+	mBuffer = 0;
+	mStaging.clear();
+}
+
+void UniformRing::beginFrame(size_t frameBytes) {
+	if( frameBytes > mRegionSize ){
+		glFinish(); // every region is in use until then
+		create(std::max(frameBytes, mRegionSize * 2));
+	}
+	if( mFences[mRegion] != 0 ){
+		// Normally long signaled : the GPU is at most two frames behind
+		GLenum status;
+		do {
+			status = glClientWaitSync(mFences[mRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		} while( status == GL_TIMEOUT_EXPIRED );
+		glDeleteSync(mFences[mRegion]);
+		mFences[mRegion] = 0;
+	}
+	mUsed = 0;
+}
+
+void * UniformRing::allocate(size_t size, GLintptr & out_offset) {
+	size_t offset = alignedSize(mUsed);
+	if( offset + size > mRegionSize )
+		return NULL;
+	mUsed = offset + size;
+	if( mMapped == NULL ){
+		out_offset = (GLintptr)offset;
+		return mStaging.data() + offset;
+	}
+	out_offset = (GLintptr)(mRegion * mRegionSize + offset);
+	return mMapped + out_offset;
+}
+
+void UniformRing::flush() {
+	if( mMapped != NULL || mUsed == 0 )
+		return; // coherent : the draws see the writes as they are
+	// A new store, so the GPU can go on reading last frame's meanwhile
+	glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, mRegionSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, mUsed, mStaging.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformRing::endFrame() {
+	if( mMapped == NULL )
+		return;
+	mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mRegion = (mRegion + 1) % REGION_COUNT;
+}
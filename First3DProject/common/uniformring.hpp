@@ -0,0 +1,87 @@
+#ifndef UNIFORMRING_HPP
+#define UNIFORMRING_HPP
+
+#include <vector>
+#include <stddef.h>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Uniform blocks of shader/StandardShading.vertexshader, std140.
+// Frame is written once per frame and bound at UNIFORM_FRAME_BINDING; Object once per object, color and geometry
+// drawn, and bound by offset at UNIFORM_OBJECT_BINDING before its draws.
+#define UNIFORM_FRAME_BINDING 0
+#define UNIFORM_OBJECT_BINDING 1
+
+struct FrameUniforms {
+	glm::mat4 V;
+	glm::mat4 P;
+	glm::vec4 lightPosition;  // world space, w unused
+};
+
+struct ObjectUniforms {
+	glm::mat4 M;
+	glm::mat4 MVP;
+	glm::vec4 normalMatrix[3]; // the inverse transpose of M's upper 3x3, one column per vec4 as std140 lays out a mat3
+	glm::vec4 color;
+	glm::vec4 positionScale;   // w : normal scale, see PackedVertices
+	glm::vec4 positionOffset;
+};
+
+// Fills the Object block of a draw : model and MVP matrices, normal matrix, color and vertex decoding.
+void setObjectUniforms(ObjectUniforms & out, const glm::mat4 & model, const glm::mat4 & viewProjection, const glm::vec3 & color,
+                       const glm::vec3 & positionScale, const glm::vec3 & positionOffset, float normalScale);
+
+// A uniform buffer cut in three regions, one per frame in flight, so the CPU writes a frame's uniforms
+// while the GPU still reads the two before. A region is reused once the fence set at the end of its frame has passed.
+//
+// With GL 4.4 (or ARB_buffer_storage) the buffer is mapped once, persistent and coherent : uniforms are written
+// straight into it, with no driver call per object. Without, they're staged in memory and uploaded in one call in flush().
+// Other per-frame data goes through it too, e.g. the draws of GeometryPool, bound as shader storage or indirect commands.
+class UniformRing {
+public:
+	UniformRing();
+	~UniformRing();
+
+	// Room for frameBytes per frame.
+	bool create(size_t frameBytes);
+	void destroy();
+	bool isPersistent() const { return mMapped != NULL; }
+	GLuint buffer() const { return mBuffer; }
+
+	// Offsets of allocate() are multiples of this, as glBindBufferRange wants them for GL_UNIFORM_BUFFER
+	// (and GL_SHADER_STORAGE_BUFFER, with GL 4.3).
+	size_t alignment() const { return mAlignment; }
+	size_t alignedSize(size_t size) const { return (size + mAlignment - 1) / mAlignment * mAlignment; }
+
+	// Starts writing the next region, waiting for the GPU to finish with it first.
+	// Grows the ring if a frame needs more than frameBytes, which must count every allocation as alignedSize(size) :
+	// allocations up to that total then never fail.
+	void beginFrame(size_t frameBytes);
+
+	// size bytes of the current region to write into, at out_offset in buffer(); NULL if the region is full.
+	void * allocate(size_t size, GLintptr & out_offset);
+
+	// Makes this frame's writes visible to the GPU : call after the last allocate, before the draws.
+	void flush();
+
+	// Fences the region : call after the frame's last draw.
+	void endFrame();
+
+private:
+	UniformRing(const UniformRing &);
+	UniformRing & operator=(const UniformRing &);
+
+	static const int REGION_COUNT = 3;
+
+	GLuint mBuffer;
+	unsigned char * mMapped;                 // persistent mapping of the whole buffer
+	std::vector<unsigned char> mStaging;     // the current region, without persistent mapping
+	GLsync mFences[REGION_COUNT];
+	size_t mAlignment;
+	size_t mRegionSize;
+	int mRegion;
+	size_t mUsed;                            // in the current region
+};
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef VERTEXFORMAT_HPP
+#define VERTEXFORMAT_HPP
+
+#include <stddef.h>
+#include <utility>
+
+#include <GL/glew.h>
+
+#include "vertexpacking.hpp"
+
+// Compile-time vertex formats : a vertex struct comes with the list of its attributes (shader input, location,
+// component type and count, normalization, offset and size), and the stride, the attribute setup and the vertex shader's
+// input declarations all follow from that list. Every glVertexAttribPointer / glVertexAttribFormat is expanded
+// from template arguments, so there's no layout to interpret at runtime, and a new format is a new struct and list.
+
+// What the vertex shader calls an input, and the GLSL type it reads it as. One input may be fed by several formats :
+// a half UV still arrives as a vec2, and an octahedral normal (2 components) as a vec3 with z = 0.
+struct PositionInput {
+	static constexpr const char * name() { return "vertexPosition_encoded"; }
+	static constexpr const char * type() { return "vec3"; }
+};
+struct UVInput {
+	static constexpr const char * name() { return "vertexUV"; }
+	static constexpr const char * type() { return "vec2"; }
+};
+struct NormalInput {
+	static constexpr const char * name() { return "vertexNormal_encoded"; }
+	static constexpr const char * type() { return "vec3"; }
+};
+struct InstanceModelInput {
+	static constexpr const char * name() { return "instanceModel"; }
+	static constexpr const char * type() { return "mat4"; }
+};
+struct InstanceColorInput {
+	static constexpr const char * name() { return "instanceColor"; }
+	static constexpr const char * type() { return "vec3"; }
+};
+
+// Text built at compile time, see VertexFormat::shaderInputs().
+template<size_t N>
+struct ShaderText {
+	char text[N];
+};
+
+constexpr size_t shaderTextLength(const char * s) {
+	size_t length = 0;
+	while( s[length] != 0 )
+		length++;
+	return length;
+}
+
+constexpr size_t shaderDigitCount(unsigned int value) {
+	size_t digits = 1;
+	for( ; value >= 10; value /= 10 )
+		digits++;
+	return digits;
+}
+
+constexpr size_t appendShaderText(char * out, size_t at, const char * s) {
+	while( *s != 0 )
+		out[at++] = *s++;
+	return at;
+}
+
+constexpr size_t appendShaderNumber(char * out, size_t at, unsigned int value) {
+	size_t digits = shaderDigitCount(value);
+	for( size_t i = digits; i-- > 0; value /= 10 )
+		out[at + i] = (char)('0' + value % 10);
+	return at + digits;
+}
+
+template<size_t N, size_t M>
+constexpr ShaderText<N + M - 1> joinShaderText(const ShaderText<N> & a, const ShaderText<M> & b) {
+	ShaderText<N + M - 1> out = {};
+	size_t at = appendShaderText(out.text, 0, a.text);
+	at = appendShaderText(out.text, at, b.text);
+	out.text[at] = 0;
+	return out;
+}
+
+constexpr bool sameShaderText(const char * a, const char * b) {
+	for( ; *a != 0 || *b != 0; a++, b++ )
+		if( *a != *b )
+			return false;
+	return true;
+}
+
+// One attribute : Count components of Type at Offset in the vertex, Size bytes with padding.
+// Integer types are converted to float, to [0, 1] / [-1, 1] if Normalized.
+template<typename Input, GLuint Location, GLenum Type, GLint Count, GLboolean Normalized, size_t Offset, size_t Size>
+struct VertexAttribute {
+	typedef Input input;
+	static constexpr GLuint location = Location;
+	static constexpr size_t offset = Offset;
+	static constexpr size_t size = Size;
+
+	// Attribute pointer into the bound GL_ARRAY_BUFFER, in the bound vertex array
+	static void pointer(GLsizei stride, size_t base) {
+		glEnableVertexAttribArray(Location);
+		glVertexAttribPointer(Location, Count, Type, Normalized, stride, (const void *)base);
+	}
+
+	// GL 4.3 : the format alone, read from whichever buffer is bound to binding
+	static void format(GLuint binding) {
+		glEnableVertexAttribArray(Location);
+		glVertexAttribFormat(Location, Count, Type, Normalized, (GLuint)Offset);
+		glVertexAttribBinding(Location, binding);
+	}
+
+	// Advance once every divisor instances instead of once per vertex
+	static void divisor(GLuint divisor) {
+		glVertexAttribDivisor(Location, divisor);
+	}
+
+	// "layout(location = L) in type name;\n"
+	static constexpr size_t declarationLength() {
+		return shaderTextLength("layout(location = ") + shaderDigitCount(Location) + shaderTextLength(") in ")
+			+ shaderTextLength(Input::type()) + 1 + shaderTextLength(Input::name()) + shaderTextLength(";\n");
+	}
+
+	static constexpr size_t declare(char * out, size_t at) {
+		at = appendShaderText(out, at, "layout(location = ");
+		at = appendShaderNumber(out, at, Location);
+		at = appendShaderText(out, at, ") in ");
+		at = appendShaderText(out, at, Input::type());
+		at = appendShaderText(out, at, " ");
+		at = appendShaderText(out, at, Input::name());
+		return appendShaderText(out, at, ";\n");
+	}
+};
+
+// A float matrix of Columns vec4 columns at Offset, which takes one location per column from Location on.
+template<typename Input, GLuint Location, GLuint Columns, size_t Offset>
+struct MatrixAttribute {
+	typedef Input input;
+	static constexpr GLuint location = Location;
+	static constexpr size_t offset = Offset;
+	static constexpr size_t size = Columns * 4 * sizeof(float);
+
+	static void pointer(GLsizei stride, size_t base) {
+		for( GLuint c = 0; c < Columns; c++ ){
+			glEnableVertexAttribArray(Location + c);
+			glVertexAttribPointer(Location + c, 4, GL_FLOAT, GL_FALSE, stride, (const void *)(base + c * 4 * sizeof(float)));
+		}
+	}
+
+	static void format(GLuint binding) {
+		for( GLuint c = 0; c < Columns; c++ ){
+			glEnableVertexAttribArray(Location + c);
+			glVertexAttribFormat(Location + c, 4, GL_FLOAT, GL_FALSE, (GLuint)(Offset + c * 4 * sizeof(float)));
+			glVertexAttribBinding(Location + c, binding);
+		}
+	}
+
+	static void divisor(GLuint divisor) {
+		for( GLuint c = 0; c < Columns; c++ )
+			glVertexAttribDivisor(Location + c, divisor);
+	}
+
+	static constexpr size_t declarationLength() {
+		return VertexAttribute<Input, Location, GL_FLOAT, 4, GL_FALSE, Offset, size>::declarationLength();
+	}
+
+	static constexpr size_t declare(char * out, size_t at) {
+		return VertexAttribute<Input, Location, GL_FLOAT, 4, GL_FALSE, Offset, size>::declare(out, at);
+	}
+};
+
+template<typename Vertex, typename... Attributes>
+struct VertexFormat {
+	typedef Vertex vertex;
+	static constexpr GLsizei stride = (GLsizei)sizeof(Vertex);
+
+	static constexpr size_t shaderInputsLength() {
+		size_t lengths[] = { 0, Attributes::declarationLength()... };
+		size_t length = 0;
+		for( size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++ )
+			length += lengths[i];
+		return length;
+	}
+
+	// The vertex shader's input declarations for this format, to insert after its #version line
+	static constexpr ShaderText<shaderInputsLength() + 1> shaderInputs() {
+		ShaderText<shaderInputsLength() + 1> out = {};
+		size_t at = 0;
+		size_t expand[] = { 0, (at = Attributes::declare(out.text, at))... };
+		(void)expand;
+		out.text[at] = 0;
+		return out;
+	}
+
+	// Every attribute read from buffer, whole vertices of stride bytes : the bound vertex array keeps it all
+	static void specifyInterleaved(GLuint buffer) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		int expand[] = { 0, (Attributes::pointer(stride, Attributes::offset), 0)... };
+		(void)expand;
+	}
+
+	// Every attribute read from buffer once per instance, for glDraw*Instanced
+	static void specifyInstanced(GLuint buffer) {
+		specifyInterleaved(buffer);
+		int expand[] = { 0, (Attributes::divisor(1), 0)... };
+		(void)expand;
+	}
+
+	// Attribute i read from buffers[i], a stream of its own
+	static void specifySeparate(const GLuint * buffers) {
+		specifySeparate(buffers, std::index_sequence_for<Attributes...>());
+	}
+
+	// GL 4.3 : every attribute read from the buffer bound with glBindVertexBuffer(binding, buffer, 0, stride)
+	static void specifyFormats(GLuint binding) {
+		int expand[] = { 0, (Attributes::format(binding), 0)... };
+		(void)expand;
+	}
+
+private:
+	template<size_t... I>
+	static void specifySeparate(const GLuint * buffers, std::index_sequence<I...>) {
+		int expand[] = { 0, (glBindBuffer(GL_ARRAY_BUFFER, buffers[I]), Attributes::pointer((GLsizei)Attributes::size, 0), 0)... };
+		(void)expand;
+	}
+};
+
+// True if two formats declare the same shader inputs, i.e. one program draws both.
+template<typename FormatA, typename FormatB>
+constexpr bool sameShaderInputs() {
+	return sameShaderText(FormatA::shaderInputs().text, FormatB::shaderInputs().text);
+}
+
+// The formats packVertices writes : component type, count, normalization and bytes of every encoding.
+template<VertexPositionEncoding Encoding> struct PositionEncodingFormat;
+template<> struct PositionEncodingFormat<VERTEX_POSITION_FLOAT> {
+	static constexpr GLenum type = GL_FLOAT; static constexpr GLint count = 3; static constexpr GLboolean normalized = GL_FALSE; static constexpr size_t size = 12;
+};
+template<> struct PositionEncodingFormat<VERTEX_POSITION_HALF> {
+	static constexpr GLenum type = GL_HALF_FLOAT; static constexpr GLint count = 3; static constexpr GLboolean normalized = GL_FALSE; static constexpr size_t size = 8;
+};
+template<> struct PositionEncodingFormat<VERTEX_POSITION_UNORM16> { // 0..1 across the bounds, see PackedVertices::positionScale
+	static constexpr GLenum type = GL_UNSIGNED_SHORT; static constexpr GLint count = 3; static constexpr GLboolean normalized = GL_TRUE; static constexpr size_t size = 8;
+};
+
+template<VertexUVEncoding Encoding> struct UVEncodingFormat;
+template<> struct UVEncodingFormat<VERTEX_UV_FLOAT> {
+	static constexpr GLenum type = GL_FLOAT; static constexpr GLint count = 2; static constexpr GLboolean normalized = GL_FALSE; static constexpr size_t size = 8;
+};
+template<> struct UVEncodingFormat<VERTEX_UV_HALF> {
+	static constexpr GLenum type = GL_HALF_FLOAT; static constexpr GLint count = 2; static constexpr GLboolean normalized = GL_FALSE; static constexpr size_t size = 4;
+};
+
+// Octahedral normals are passed as plain integers and scaled in the shader : GL before 4.2 maps
+// normalized signed integers with (2c+1)/(2^b-1), which doesn't round-trip glm's packSnorm
+template<VertexNormalEncoding Encoding> struct NormalEncodingFormat;
+template<> struct NormalEncodingFormat<VERTEX_NORMAL_FLOAT> {
+	static constexpr GLenum type = GL_FLOAT; static constexpr GLint count = 3; static constexpr GLboolean normalized = GL_FALSE; static constexpr size_t size = 12;
+};
+template<> struct NormalEncodingFormat<VERTEX_NORMAL_OCT16> {
+	static constexpr GLenum type = GL_SHORT; static constexpr GLint count = 2; static constexpr GLboolean normalized = GL_FALSE; static constexpr size_t size = 4;
+};
+template<> struct NormalEncodingFormat<VERTEX_NORMAL_OCT8> {
+	static constexpr GLenum type = GL_BYTE; static constexpr GLint count = 2; static constexpr GLboolean normalized = GL_FALSE; static constexpr size_t size = 2;
+};
+
+// A vertex as interleaveVertices lays it out, byte arrays so that no padding creeps in.
+template<VertexPositionEncoding Position, VertexNormalEncoding Normal, VertexUVEncoding UV>
+struct PackedVertex {
+	unsigned char position[PositionEncodingFormat<Position>::size];
+	unsigned char uv[UVEncodingFormat<UV>::size];
+	unsigned char normal[NormalEncodingFormat<Normal>::size];
+};
+
+template<VertexPositionEncoding Position, VertexNormalEncoding Normal, VertexUVEncoding UV,
+	typename P = PositionEncodingFormat<Position>, typename T = UVEncodingFormat<UV>, typename N = NormalEncodingFormat<Normal>,
+	typename Vertex = PackedVertex<Position, Normal, UV>>
+using PackedVertexFormat = VertexFormat<Vertex,
+	VertexAttribute<PositionInput, 0, P::type, P::count, P::normalized, offsetof(Vertex, position), P::size>,
+	VertexAttribute<UVInput, 1, T::type, T::count, T::normalized, offsetof(Vertex, uv), T::size>,
+	VertexAttribute<NormalInput, 2, N::type, N::count, N::normalized, offsetof(Vertex, normal), N::size>
+>;
+
+// The float vertex : the inputs every other format has to match, and what the shaders are loaded with.
+typedef PackedVertexFormat<VERTEX_POSITION_FLOAT, VERTEX_NORMAL_FLOAT, VERTEX_UV_FLOAT> FloatVertexFormat;
+static_assert(FloatVertexFormat::stride == 32, "a float vertex is 3 + 2 + 3 floats");
+static_assert(sameShaderInputs<FloatVertexFormat, PackedVertexFormat<VERTEX_POSITION_UNORM16, VERTEX_NORMAL_OCT8, VERTEX_UV_HALF>>(),
+	"packed formats feed the same shader inputs");
+
+// What an instanced draw reads per instance : the instance's transform, applied before the object's own,
+// and a color that multiplies the object's. Outside instanced draws, the shader sees identity and white,
+// see setDefaultInstance().
+struct Instance {
+	glm::mat4 model;
+	glm::vec3 color;
+};
+
+typedef VertexFormat<Instance,
+	MatrixAttribute<InstanceModelInput, 3, 4, offsetof(Instance, model)>,
+	VertexAttribute<InstanceColorInput, 7, GL_FLOAT, 3, GL_FALSE, offsetof(Instance, color), 12>
+> InstanceFormat;
+static_assert(InstanceFormat::stride == 76, "an instance is a mat4 and a vec3");
+
+// The current values of the instance attributes, which disabled arrays read : an identity transform, in white.
+// GL leaves them undefined once an instanced draw read them from a buffer, so set again after one.
+inline void setDefaultInstance() {
+	glVertexAttrib4f(3, 1.0f, 0.0f, 0.0f, 0.0f);
+	glVertexAttrib4f(4, 0.0f, 1.0f, 0.0f, 0.0f);
+	glVertexAttrib4f(5, 0.0f, 0.0f, 1.0f, 0.0f);
+	glVertexAttrib4f(6, 0.0f, 0.0f, 0.0f, 1.0f);
+	glVertexAttrib3f(7, 1.0f, 1.0f, 1.0f);
+}
+
+// The attribute setup of one format, looked up from a runtime VertexEncoding once when the buffers are created.
+struct VertexAttributeSetup {
+	void (*specifyInterleaved)(GLuint buffer);
+	void (*specifySeparate)(const GLuint * buffers); // position, UV and normal buffers
+	void (*specifyFormats)(GLuint binding);
+	GLsizei stride;
+};
+
+template<typename Format>
+inline VertexAttributeSetup vertexAttributeSetup() {
+	VertexAttributeSetup setup = { &Format::specifyInterleaved, &Format::specifySeparate, &Format::specifyFormats, Format::stride };
+	return setup;
+}
+
+template<VertexPositionEncoding Position, VertexNormalEncoding Normal>
+inline VertexAttributeSetup vertexAttributeSetupForUV(VertexUVEncoding uv) {
+	if( uv == VERTEX_UV_HALF )
+		return vertexAttributeSetup<PackedVertexFormat<Position, Normal, VERTEX_UV_HALF>>();
+	return vertexAttributeSetup<PackedVertexFormat<Position, Normal, VERTEX_UV_FLOAT>>();
+}
+
+template<VertexPositionEncoding Position>
+inline VertexAttributeSetup vertexAttributeSetupForNormal(VertexNormalEncoding normal, VertexUVEncoding uv) {
+	switch( normal ){
+		case VERTEX_NORMAL_OCT16: return vertexAttributeSetupForUV<Position, VERTEX_NORMAL_OCT16>(uv);
+		case VERTEX_NORMAL_OCT8:  return vertexAttributeSetupForUV<Position, VERTEX_NORMAL_OCT8>(uv);
+		default:                  return vertexAttributeSetupForUV<Position, VERTEX_NORMAL_FLOAT>(uv);
+	}
+}
+
+inline VertexAttributeSetup vertexAttributeSetup(const VertexEncoding & encoding) {
+	switch( encoding.position ){
+		case VERTEX_POSITION_HALF:    return vertexAttributeSetupForNormal<VERTEX_POSITION_HALF>(encoding.normal, encoding.uv);
+		case VERTEX_POSITION_UNORM16: return vertexAttributeSetupForNormal<VERTEX_POSITION_UNORM16>(encoding.normal, encoding.uv);
+		default:                      return vertexAttributeSetupForNormal<VERTEX_POSITION_FLOAT>(encoding.normal, encoding.uv);
+	}
+}
+
+#endif
@@ -0,0 +1,296 @@
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+// VERTEXPACKING_SCALAR builds the plain C++ paths only, e.g. to check them against the SSE2 ones
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(VERTEXPACKING_SCALAR)
+#include <emmintrin.h>
+#define VERTEXPACKING_SSE
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "vertexpacking.hpp"
+
+size_t positionStride(VertexPositionEncoding encoding) {
+	return encoding == VERTEX_POSITION_FLOAT ? 12 : 8;
+}
+
+size_t normalStride(VertexNormalEncoding encoding) {
+	return encoding == VERTEX_NORMAL_FLOAT ? 12 : encoding == VERTEX_NORMAL_OCT16 ? 4 : 2;
+}
+
+size_t uvStride(VertexUVEncoding encoding) {
+	return encoding == VERTEX_UV_FLOAT ? 8 : 4;
+}
+
+size_t vertexSize(const VertexEncoding & encoding) {
+	return positionStride(encoding.position) + normalStride(encoding.normal) + uvStride(encoding.uv);
+}
+
+size_t positionOffset(const VertexEncoding &) {
+	// positions always come first
+	return 0;
+}
+
+size_t uvOffset(const VertexEncoding & encoding) {
+	return positionStride(encoding.position);
+}
+
+size_t normalOffset(const VertexEncoding & encoding) {
+	return positionStride(encoding.position) + uvStride(encoding.uv);
+}
+
+void interleaveVertices(const VertexEncoding & encoding, const PackedVertices & packed, size_t count, std::vector<unsigned char> & out) {
+	const size_t stride = vertexSize(encoding);
+	const size_t sizes[3] = { positionStride(encoding.position), uvStride(encoding.uv), normalStride(encoding.normal) };
+	const size_t offsets[3] = { positionOffset(encoding), uvOffset(encoding), normalOffset(encoding) };
+	const unsigned char * streams[3] = { packed.positions.data(), packed.uvs.data(), packed.normals.data() };
+	out.resize(count * stride);
+	for( int a = 0; a < 3; a++ ){
+		// One attribute at a time : the source stream is read straight through
+		unsigned char * destination = out.data() + offsets[a];
+		const unsigned char * source = streams[a];
+		const size_t size = sizes[a];
+		for( size_t i = 0; i < count; i++ )
+			memcpy(destination + i * stride, source + i * size, size);
+	}
+}
+
+static float signNotZero(float x) {
+	return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+glm::vec2 octahedralEncode(glm::vec3 normal) {
+	// Project on the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if( length == 0.0f )
+		return glm::vec2(0.0f); // degenerate normal, decodes to +Z
+	normal /= length;
+	if( normal.z >= 0.0f )
+		return glm::vec2(normal.x, normal.y);
+	return glm::vec2((1.0f - std::fabs(normal.y)) * signNotZero(normal.x), (1.0f - std::fabs(normal.x)) * signNotZero(normal.y));
+}
+
+glm::vec3 octahedralDecode(glm::vec2 encoded) {
+	glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+	float fold = glm::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+	return glm::normalize(normal);
+}
+
+// Octahedral coordinates of normal, snapped to steps of 1 / maximum so that packSnorm stores them exactly.
+// Whichever of the four surrounding grid points decodes closest to normal wins, instead of just rounding :
+// at 8 bits that roughly halves the error.
+static glm::vec2 octahedralQuantize(const glm::vec3 & normal, float maximum) {
+	glm::vec2 base = glm::floor(octahedralEncode(normal) * maximum);
+	glm::vec2 best(0.0f);
+	float bestDot = -2.0f;
+	for( int i = 0; i < 4; i++ ){
+		glm::vec2 candidate = glm::clamp(base + glm::vec2(i & 1, i >> 1), -maximum, maximum) / maximum;
+		float dot = glm::dot(octahedralDecode(candidate), normal);
+		if( dot > bestDot ){
+			bestDot = dot;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+void packVertices(
+	const VertexEncoding & encoding,
+	const glm::vec3 * positions,
+	const glm::vec2 * uvs,
+	const glm::vec3 * normals,
+	size_t count,
+	PackedVertices & out
+){
+	out.positions.resize(count * positionStride(encoding.position));
+	out.uvs.resize(count * uvStride(encoding.uv));
+	out.normals.resize(count * normalStride(encoding.normal));
+	out.positionScale = glm::vec3(1.0f);
+	out.positionOffset = glm::vec3(0.0f);
+	out.normalScale = 0.0f;
+	if( count == 0 )
+		return;
+
+	if( encoding.position == VERTEX_POSITION_FLOAT ){
+		memcpy(&out.positions[0], positions, count * sizeof(glm::vec3));
+	}else if( encoding.position == VERTEX_POSITION_HALF ){
+		for( size_t i = 0; i < count; i++ ){
+			glm::uint64 packed = glm::packHalf4x16(glm::vec4(positions[i], 1.0f));
+			memcpy(&out.positions[i * 8], &packed, 8);
+		}
+	}else{
+		// 16 bits across the mesh bounds : a 10 m model still gets 0.15 mm steps
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		for( size_t i = 0; i < count; i++ ){
+			boundsMin = glm::min(boundsMin, positions[i]);
+			boundsMax = glm::max(boundsMax, positions[i]);
+		}
+		glm::vec3 extent = boundsMax - boundsMin;
+		glm::vec3 inverse(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+		for( size_t i = 0; i < count; i++ ){
+			glm::uint64 packed = glm::packUnorm4x16(glm::vec4((positions[i] - boundsMin) * inverse, 0.0f));
+			memcpy(&out.positions[i * 8], &packed, 8);
+		}
+		out.positionScale = extent;
+		out.positionOffset = boundsMin;
+	}
+
+	if( encoding.uv == VERTEX_UV_FLOAT ){
+		memcpy(&out.uvs[0], uvs, count * sizeof(glm::vec2));
+	}else{
+		for( size_t i = 0; i < count; i++ ){
+			glm::uint packed = glm::packHalf2x16(uvs[i]);
+			memcpy(&out.uvs[i * 4], &packed, 4);
+		}
+	}
+
+	if( encoding.normal == VERTEX_NORMAL_FLOAT ){
+		memcpy(&out.normals[0], normals, count * sizeof(glm::vec3));
+	}else if( encoding.normal == VERTEX_NORMAL_OCT16 ){
+		out.normalScale = 1.0f / 32767.0f;
+		for( size_t i = 0; i < count; i++ ){
+			glm::uint packed = glm::packSnorm2x16(octahedralQuantize(normals[i], 32767.0f));
+			memcpy(&out.normals[i * 4], &packed, 4);
+		}
+	}else{
+		out.normalScale = 1.0f / 127.0f;
+		for( size_t i = 0; i < count; i++ ){
+			glm::uint16 packed = glm::packSnorm2x8(octahedralQuantize(normals[i], 127.0f));
+			memcpy(&out.normals[i * 2], &packed, 2);
+		}
+	}
+}
+
+#ifdef VERTEXPACKING_SSE
+
+// Half floats to floats, including denormals, infinities and NaNs : the exponent is rebased with a multiply.
+static __m128 halfToFloat(__m128i halves) {
+	__m128i magnitude = _mm_and_si128(halves, _mm_set1_epi32(0x7FFF));
+	__m128i sign = _mm_slli_epi32(_mm_xor_si128(halves, magnitude), 16);
+	__m128i shifted = _mm_slli_epi32(magnitude, 13);
+	__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(shifted), _mm_castsi128_ps(_mm_set1_epi32(0x77800000))); // 2^112
+	__m128i special = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7BFF));
+	__m128i bits = _mm_or_si128(_mm_andnot_si128(special, _mm_castps_si128(scaled)),
+		_mm_and_si128(special, _mm_or_si128(shifted, _mm_set1_epi32(0x7F800000))));
+	return _mm_castsi128_ps(_mm_or_si128(bits, sign));
+}
+
+#endif
+
+void unpackVertices(
+	const VertexEncoding & encoding,
+	const PackedVertices & packed,
+	size_t count,
+	glm::vec3 * out_positions,
+	glm::vec2 * out_uvs,
+	glm::vec3 * out_normals
+){
+	if( count == 0 )
+		return;
+	size_t i;
+
+	if( encoding.position == VERTEX_POSITION_FLOAT ){
+		memcpy(out_positions, &packed.positions[0], count * sizeof(glm::vec3));
+	}else if( encoding.position == VERTEX_POSITION_HALF ){
+		for( i = 0; i < count; i++ ){
+			glm::uint64 value;
+			memcpy(&value, &packed.positions[i * 8], 8);
+			out_positions[i] = glm::vec3(glm::unpackHalf4x16(value));
+		}
+	}else{
+		glm::vec3 step = packed.positionScale / 65535.0f;
+		const unsigned char * source = &packed.positions[0];
+		i = 0;
+#ifdef VERTEXPACKING_SSE
+		// Two vertices per load ; every store writes a fourth float that the next vertex overwrites, so the last one is left out
+		__m128 scale = _mm_setr_ps(step.x, step.y, step.z, 0.0f);
+		__m128 offset = _mm_setr_ps(packed.positionOffset.x, packed.positionOffset.y, packed.positionOffset.z, 0.0f);
+		__m128i zero = _mm_setzero_si128();
+		for( ; i + 2 < count; i += 2 ){
+			__m128i values = _mm_loadu_si128((const __m128i *)(source + i * 8));
+			__m128 first = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)), scale), offset);
+			__m128 second = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)), scale), offset);
+			_mm_storeu_ps(&out_positions[i].x, first);
+			_mm_storeu_ps(&out_positions[i + 1].x, second);
+		}
+#endif
+		for( ; i < count; i++ ){
+			unsigned short value[4];
+			memcpy(value, source + i * 8, 8);
+			out_positions[i] = packed.positionOffset + glm::vec3(value[0], value[1], value[2]) * step;
+		}
+	}
+
+	if( encoding.uv == VERTEX_UV_FLOAT ){
+		memcpy(out_uvs, &packed.uvs[0], count * sizeof(glm::vec2));
+	}else{
+		// 2 halves per vertex, into 2 floats : a flat array of halves into a flat array of floats
+		const unsigned char * source = &packed.uvs[0];
+		float * destination = &out_uvs[0].x;
+		i = 0;
+#ifdef VERTEXPACKING_SSE
+		__m128i zero = _mm_setzero_si128();
+		for( ; i + 4 <= count; i += 4 ){
+			__m128i values = _mm_loadu_si128((const __m128i *)(source + i * 4));
+			_mm_storeu_ps(destination + i * 2, halfToFloat(_mm_unpacklo_epi16(values, zero)));
+			_mm_storeu_ps(destination + i * 2 + 4, halfToFloat(_mm_unpackhi_epi16(values, zero)));
+		}
+#endif
+		for( ; i < count; i++ ){
+			glm::uint value;
+			memcpy(&value, source + i * 4, 4);
+			out_uvs[i] = glm::unpackHalf2x16(value);
+		}
+	}
+
+	if( encoding.normal == VERTEX_NORMAL_FLOAT ){
+		memcpy(out_normals, &packed.normals[0], count * sizeof(glm::vec3));
+	}else if( encoding.normal == VERTEX_NORMAL_OCT16 ){
+		const unsigned char * source = &packed.normals[0];
+		i = 0;
+#ifdef VERTEXPACKING_SSE
+		// octahedralDecode on 4 normals at a time, then transposed back to one normal per vec3 like the positions above
+		__m128 inverseMaximum = _mm_set1_ps(1.0f / 32767.0f);
+		__m128 minusOne = _mm_set1_ps(-1.0f);
+		__m128 signBit = _mm_set1_ps(-0.0f);
+		for( ; i + 4 < count; i += 4 ){
+			__m128i values = _mm_loadu_si128((const __m128i *)(source + i * 4));
+			__m128 x = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(values, 16), 16)), inverseMaximum), minusOne);
+			__m128 y = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(values, 16)), inverseMaximum), minusOne);
+			__m128 z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_andnot_ps(signBit, x)), _mm_andnot_ps(signBit, y));
+			__m128 fold = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+			// x += x >= 0 ? -fold : fold, with the sign of x moved onto fold
+			x = _mm_sub_ps(x, _mm_or_ps(fold, _mm_and_ps(x, signBit)));
+			y = _mm_sub_ps(y, _mm_or_ps(fold, _mm_and_ps(y, signBit)));
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			x = _mm_div_ps(x, length);
+			y = _mm_div_ps(y, length);
+			z = _mm_div_ps(z, length);
+			__m128 w = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(&out_normals[i].x, x);
+			_mm_storeu_ps(&out_normals[i + 1].x, y);
+			_mm_storeu_ps(&out_normals[i + 2].x, z);
+			_mm_storeu_ps(&out_normals[i + 3].x, w);
+		}
+#endif
+		for( ; i < count; i++ ){
+			glm::uint value;
+			memcpy(&value, source + i * 4, 4);
+			out_normals[i] = octahedralDecode(glm::unpackSnorm2x16(value));
+		}
+	}else{
+		for( i = 0; i < count; i++ ){
+			glm::uint16 value;
+			memcpy(&value, &packed.normals[i * 2], 2);
+			out_normals[i] = octahedralDecode(glm::unpackSnorm2x8(value));
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef VERTEXPACKING_HPP
+#define VERTEXPACKING_HPP
+
+#include <vector>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+// Compact vertex attribute encodings, built on glm's packing functions.
+// A float vertex (position, UV, normal) is 32 bytes; the smallest encodings below bring it down to 14.
+
+enum VertexPositionEncoding {
+	VERTEX_POSITION_FLOAT,   // 3 x 32-bit float, 12 bytes
+	VERTEX_POSITION_HALF,    // 4 x 16-bit half float (w unused), 8 bytes
+	VERTEX_POSITION_UNORM16  // 4 x 16-bit normalized against the mesh bounds (w unused), 8 bytes
+};
+
+enum VertexNormalEncoding {
+	VERTEX_NORMAL_FLOAT,     // 3 x 32-bit float, 12 bytes
+	VERTEX_NORMAL_OCT16,     // octahedral, 2 x 16-bit snorm, 4 bytes
+	VERTEX_NORMAL_OCT8       // octahedral, 2 x 8-bit snorm, 2 bytes
+};
+
+enum VertexUVEncoding {
+	VERTEX_UV_FLOAT,         // 2 x 32-bit float, 8 bytes
+	VERTEX_UV_HALF           // 2 x 16-bit half float, 4 bytes ; V is flipped, so UVs are negative and unorm won't do
+};
+
+struct VertexEncoding {
+	VertexEncoding() : position(VERTEX_POSITION_FLOAT), normal(VERTEX_NORMAL_FLOAT), uv(VERTEX_UV_FLOAT) {}
+	VertexEncoding(VertexPositionEncoding position, VertexNormalEncoding normal, VertexUVEncoding uv) : position(position), normal(normal), uv(uv) {}
+
+	VertexPositionEncoding position;
+	VertexNormalEncoding normal;
+	VertexUVEncoding uv;
+};
+
+// Bytes per vertex of each attribute stream.
+size_t positionStride(VertexPositionEncoding encoding);
+size_t normalStride(VertexNormalEncoding encoding);
+size_t uvStride(VertexUVEncoding encoding);
+size_t vertexSize(const VertexEncoding & encoding);
+
+// Attribute streams ready for glBufferData, and what the vertex shader needs to decode them.
+struct PackedVertices {
+	std::vector<unsigned char> positions;
+	std::vector<unsigned char> uvs;
+	std::vector<unsigned char> normals;
+	glm::vec3 positionScale;  // position = positionOffset + positionScale * attribute
+	glm::vec3 positionOffset;
+	float normalScale;        // octahedral : the normal is decoded from attribute * normalScale ; 0 for float normals
+};
+
+void packVertices(
+	const VertexEncoding & encoding,
+	const glm::vec3 * positions,
+	const glm::vec2 * uvs,
+	const glm::vec3 * normals,
+	size_t count,
+	PackedVertices & out
+);
+
+// Where the vertex data lives on the GPU : one buffer per attribute, or one buffer of whole vertices.
+enum VertexLayout {
+	VERTEX_LAYOUT_SEPARATE,    // the streams of PackedVertices as they are, e.g. to append to each of them
+	VERTEX_LAYOUT_INTERLEAVED  // position, UV and normal of a vertex side by side, vertexSize() bytes apart
+};
+
+// Byte offset of each attribute within an interleaved vertex.
+size_t positionOffset(const VertexEncoding & encoding);
+size_t uvOffset(const VertexEncoding & encoding);
+size_t normalOffset(const VertexEncoding & encoding);
+
+// Interleaves the streams of packed into out, count vertices of vertexSize(encoding) bytes each :
+// a vertex fetch then reads one cache line instead of one per attribute.
+void interleaveVertices(const VertexEncoding & encoding, const PackedVertices & packed, size_t count, std::vector<unsigned char> & out);
+
+// The inverse of packVertices, back to floats, e.g. for streams read back from the mesh cache.
+// The UNORM16 positions, OCT16 normals and half UVs are decoded 2 to 8 values at a time with SSE2 where available.
+void unpackVertices(
+	const VertexEncoding & encoding,
+	const PackedVertices & packed,
+	size_t count,
+	glm::vec3 * out_positions,
+	glm::vec2 * out_uvs,
+	glm::vec3 * out_normals
+);
+
+// Octahedral mapping of a unit vector to [-1, 1]^2, and back (the shader has the same decoder).
+glm::vec2 octahedralEncode(glm::vec3 normal);
+glm::vec3 octahedralDecode(glm::vec2 encoded);
+
+#endif
@@ -0,0 +1,370 @@
+// Offline asset cooker: turns every OBJ file under a directory into the compressed ".mesh" cache
+// the renderer loads instead of parsing the OBJ (see meshcache.hpp).
+//
+//     cooker <asset directory> [-j threads] [--force] [--crease-angle degrees]
+//
+// --crease-angle recomputes every normal, smooth except across edges sharper than the angle (see MeshCookOptions).
+// A manifest in the asset directory keeps the content hash of every source and of its material libraries.
+// A source is only cooked again when one of those hashes changed, or its cache is missing or of another version,
+// or the options differ from the last run.
+// Sources whose content didn't change but whose modification time did (e.g. after a fresh checkout) only get
+// their cache restamped, so the renderer accepts it again.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "objloader.hpp"
+#include "objparser.hpp"
+#include "meshcache.hpp"
+#include "meshcooker.hpp"
+
+#define MANIFEST_NAME "cooker.manifest"
+#define MANIFEST_MAGIC "cooker-manifest"
+
+// What a file looked like when it was last cooked. The hash is what matters;
+// the size and modification time only let an untouched file skip being hashed again.
+struct FileStamp {
+    std::string path;
+    uint64_t size;
+    int64_t seconds;
+    int64_t nanoseconds;
+    uint64_t hash;
+};
+
+struct ManifestEntry {
+    FileStamp source;                     // path relative to the asset directory
+    std::vector<FileStamp> dependencies;  // absolute paths, as recorded in the cache
+};
+
+struct Job {
+    std::string path;                     // absolute
+    std::string relativePath;
+    FileStamp source;
+    bool stale;                           // needs cooking
+    bool cooked;
+};
+
+static bool statFile(const char *path, FileStamp &stamp) {
+    struct stat info;
+    if(stat(path, &info) != 0)
+        return false;
+    stamp.size = (uint64_t)info.st_size;
+    stamp.seconds = (int64_t)info.st_mtime;
+#ifdef __APPLE__
+    stamp.nanoseconds = (int64_t)info.st_mtimespec.tv_nsec;
+#else
+    stamp.nanoseconds = (int64_t)info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+// Stamps path, hashing it only if it looks different from known (which may be NULL).
+// With missingOK, a file that doesn't exist gets an all zero stamp, like the caches give missing dependencies.
+static bool stampFile(const char *path, const FileStamp *known, FileStamp &stamp, bool missingOK = false) {
+    if(!statFile(path, stamp)) {
+        if(!missingOK || (errno != ENOENT && errno != ENOTDIR))
+            return false;
+        stamp.size = 0;
+        stamp.seconds = stamp.nanoseconds = 0;
+        stamp.hash = 0;
+        return true;
+    }
+    if(known != NULL && known->size == stamp.size && known->seconds == stamp.seconds && known->nanoseconds == stamp.nanoseconds) {
+        stamp.hash = known->hash;
+        return true;
+    }
+    return hashFile(path, stamp.hash);
+}
+
+static bool hasOBJExtension(const char *name) {
+    size_t length = strlen(name);
+    return length > 4 && name[length - 4] == '.'
+        && tolower(name[length - 3]) == 'o' && tolower(name[length - 2]) == 'b' && tolower(name[length - 1]) == 'j';
+}
+
+// Appends the path of every OBJ file under directory, relative to it, to out_paths.
+static void findOBJFiles(const std::string &root, const std::string &directory, std::vector<std::string> &out_paths) {
+    DIR *dir = opendir((root + directory).c_str());
+    if(dir == NULL) {
+        printf("Impossible to open the directory %s\n", (root + directory).c_str());
+        return;
+    }
+    while(struct dirent *entry = readdir(dir)) {
+        if(entry->d_name[0] == '.')
+            continue; // ., .. and hidden files
+        std::string path = directory + entry->d_name;
+        struct stat info;
+        if(stat((root + path).c_str(), &info) != 0)
+            continue;
+        if(S_ISDIR(info.st_mode))
+            findOBJFiles(root, path + "/", out_paths);
+        else if(S_ISREG(info.st_mode) && hasOBJExtension(entry->d_name))
+            out_paths.push_back(path);
+    }
+    closedir(dir);
+}
+
+// Parses "<size> <seconds> <nanoseconds> <hash> <path>", the path running to the end of the line.
+static bool parseStamp(const char *line, FileStamp &stamp) {
+    unsigned long long size, hash;
+    long long seconds, nanoseconds;
+    int pathStart = 0;
+    if(sscanf(line, "%llu %lld %lld %llx %n", &size, &seconds, &nanoseconds, &hash, &pathStart) != 4 || pathStart == 0)
+        return false;
+    stamp.size = size;
+    stamp.seconds = seconds;
+    stamp.nanoseconds = nanoseconds;
+    stamp.hash = hash;
+    stamp.path = line + pathStart;
+    while(!stamp.path.empty() && (stamp.path.back() == '\n' || stamp.path.back() == '\r'))
+        stamp.path.pop_back();
+    return !stamp.path.empty();
+}
+
+static void writeStamp(FILE *file, const char *kind, const FileStamp &stamp) {
+    fprintf(file, "%s %llu %lld %lld %016llx %s\n", kind, (unsigned long long)stamp.size, (long long)stamp.seconds,
+            (long long)stamp.nanoseconds, (unsigned long long)stamp.hash, stamp.path.c_str());
+}
+
+// The crease angle in the manifest, -1 when the sources' normals were kept.
+static float manifestCreaseAngle(const MeshCookOptions &options) {
+    return options.recomputeNormals ? options.creaseAngle : -1.0f;
+}
+
+// A manifest written by another version of the cooker or of the cache format, or with other options, is ignored,
+// so everything is cooked again.
+static void readManifest(const std::string &path, const MeshCookOptions &options, std::map<std::string, ManifestEntry> &out_entries) {
+    FILE *file = fopen(path.c_str(), "r");
+    if(file == NULL)
+        return; // first run
+    char line[PATH_MAX + 128];
+    int cookVersion = 0, cacheVersion = 0;
+    float creaseAngle = 0.0f;
+    if(fgets(line, sizeof(line), file) == NULL
+       || sscanf(line, MANIFEST_MAGIC " %d %d %f", &cookVersion, &cacheVersion, &creaseAngle) != 3
+       || cookVersion != MESH_COOK_VERSION || cacheVersion != MESH_CACHE_VERSION || creaseAngle != manifestCreaseAngle(options)) {
+        fclose(file);
+        return;
+    }
+    ManifestEntry *current = NULL;
+    while(fgets(line, sizeof(line), file) != NULL) {
+        FileStamp stamp;
+        if(strncmp(line, "source ", 7) == 0 && parseStamp(line + 7, stamp)) {
+            current = &out_entries[stamp.path];
+            current->source = stamp;
+            current->dependencies.clear();
+        } else if(strncmp(line, "dependency ", 11) == 0 && current != NULL && parseStamp(line + 11, stamp)) {
+            current->dependencies.push_back(stamp);
+        }
+    }
+    fclose(file);
+}
+
+static bool writeManifest(const std::string &path, const MeshCookOptions &options, const std::map<std::string, ManifestEntry> &entries) {
+    std::string temporaryPath = path + ".tmp";
+    FILE *file = fopen(temporaryPath.c_str(), "w");
+    if(file == NULL) {
+        printf("Impossible to write the manifest %s\n", path.c_str());
+        return false;
+    }
+    fprintf(file, MANIFEST_MAGIC " %d %d %.9g\n", MESH_COOK_VERSION, MESH_CACHE_VERSION, manifestCreaseAngle(options));
+    for(std::map<std::string, ManifestEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        writeStamp(file, "source", it->second.source);
+        for(size_t i = 0; i < it->second.dependencies.size(); i++)
+            writeStamp(file, "dependency", it->second.dependencies[i]);
+    }
+    bool written = !ferror(file);
+    written = fclose(file) == 0 && written;
+    if(!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        printf("Impossible to write the manifest %s\n", path.c_str());
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// True if the cache of job still matches what the manifest says it was cooked from.
+// Fills in the stamps of the source and of the dependencies on the way.
+static bool isUpToDate(Job &job, const ManifestEntry *entry, ManifestEntry &out_entry) {
+    if(entry == NULL || !stampFile(job.path.c_str(), &entry->source, job.source) || job.source.hash != entry->source.hash)
+        return false;
+    out_entry.dependencies.clear();
+    for(size_t i = 0; i < entry->dependencies.size(); i++) {
+        FileStamp stamp;
+        if(!stampFile(entry->dependencies[i].path.c_str(), &entry->dependencies[i], stamp, true) || stamp.hash != entry->dependencies[i].hash
+           || stamp.size != entry->dependencies[i].size)
+            return false;
+        stamp.path = entry->dependencies[i].path;
+        out_entry.dependencies.push_back(stamp);
+    }
+    // Checks the cache is there and of this version, and refreshes its stamps if the files were only touched
+    return restampMeshCache(job.path.c_str(), job.source.hash);
+}
+
+static bool cook(Job &job, OBJLoadMode mode, const MeshCookOptions &options, ManifestEntry &out_entry) {
+    Mesh mesh;
+    if(!cookOBJMesh(job.path.c_str(), mesh, mode, options) || !writeMeshCache(job.path.c_str(), mesh, MESH_CACHE_COMPRESSED))
+        return false;
+    // Stamp what was actually read : the source may have changed since isUpToDate looked at it.
+    // Every library the source references is a dependency, so that one that's missing gets cooked in once it's there
+    if(!stampFile(job.path.c_str(), NULL, job.source))
+        return false;
+    out_entry.dependencies.clear();
+    for(size_t i = 0; i < mesh.materialLibraries.size(); i++) {
+        FileStamp stamp;
+        if(!stampFile(mesh.materialLibraries[i].c_str(), NULL, stamp, true))
+            return false;
+        stamp.path = mesh.materialLibraries[i];
+        out_entry.dependencies.push_back(stamp);
+    }
+    return true;
+}
+
+static void printUsage() {
+    printf("Usage: cooker <asset directory> [-j threads] [--force] [--crease-angle degrees]\n");
+    printf("Cooks every OBJ file under the directory into the .mesh cache next to it, on all cores by default.\n");
+    printf("Only sources that changed since the last run are cooked again, unless --force is given.\n");
+    printf("--crease-angle recomputes the normals, smooth except across edges sharper than the angle.\n");
+}
+
+int main(int argc, const char * argv[]) {
+    const char *directory = NULL;
+    unsigned int threadCount = defaultOBJThreadCount();
+    bool force = false;
+    MeshCookOptions options;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, atoi(argv[++i]));
+        } else if(strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if(strcmp(argv[i], "--crease-angle") == 0 && i + 1 < argc) {
+            options.recomputeNormals = true;
+            options.creaseAngle = (float)atof(argv[++i]);
+        } else if(argv[i][0] != '-' && directory == NULL) {
+            directory = argv[i];
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if(directory == NULL) {
+        printUsage();
+        return 2;
+    }
+
+    // Absolute paths, so that the dependencies recorded in the caches don't depend on where the cooker ran from
+    char resolved[PATH_MAX];
+    if(realpath(directory, resolved) == NULL) {
+        printf("Impossible to open the directory %s\n", directory);
+        return 1;
+    }
+    std::string root = std::string(resolved) + "/";
+    std::string manifestPath = root + MANIFEST_NAME;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::map<std::string, ManifestEntry> previous;
+    if(!force)
+        readManifest(manifestPath, options, previous);
+
+    std::vector<std::string> paths;
+    findOBJFiles(root, "", paths);
+    std::sort(paths.begin(), paths.end());
+
+    // Checking and cooking both run on all the threads : hashing a big OBJ costs about as much as reading it
+    std::vector<Job> jobs(paths.size());
+    std::vector<ManifestEntry> entries(paths.size());
+    for(size_t i = 0; i < paths.size(); i++) {
+        jobs[i].path = root + paths[i];
+        jobs[i].relativePath = paths[i];
+        jobs[i].stale = false;
+        jobs[i].cooked = false;
+    }
+    std::vector<size_t> stale;
+    std::mutex staleMutex;
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for(unsigned int t = 0; t < std::min<size_t>(threadCount, jobs.size()); t++) {
+        workers.push_back(std::thread([&]() {
+            for(size_t i = next++; i < jobs.size(); i = next++) {
+                std::map<std::string, ManifestEntry>::const_iterator it = previous.find(jobs[i].relativePath);
+                if(isUpToDate(jobs[i], it == previous.end() ? NULL : &it->second, entries[i]))
+                    continue;
+                std::lock_guard<std::mutex> lock(staleMutex);
+                jobs[i].stale = true;
+                stale.push_back(i);
+            }
+        }));
+    }
+    for(size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    workers.clear();
+
+    // Biggest sources first, so a large one doesn't start last and keep a single core busy at the end.
+    // The threads are one budget : several sources cook one per thread, each on that thread alone;
+    // a single source gets all of them
+    std::sort(stale.begin(), stale.end(), [&](size_t a, size_t b) { return jobs[a].source.size > jobs[b].source.size; });
+    size_t jobCount = std::min<size_t>(threadCount, stale.size());
+    OBJLoadMode mode = jobCount > 1 ? OBJ_LOAD_MAPPED : OBJ_LOAD_PARALLEL;
+    options.threadCount = jobCount > 1 ? 1 : threadCount;
+    std::atomic<size_t> nextStale(0);
+    std::atomic<int> failures(0);
+    std::mutex printMutex;
+    for(size_t t = 0; t < jobCount; t++) {
+        workers.push_back(std::thread([&]() {
+            for(size_t s = nextStale++; s < stale.size(); s = nextStale++) {
+                Job &job = jobs[stale[s]];
+                std::chrono::steady_clock::time_point jobStart = std::chrono::steady_clock::now();
+                job.cooked = cook(job, mode, options, entries[stale[s]]);
+                double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - jobStart).count();
+                std::lock_guard<std::mutex> lock(printMutex);
+                if(job.cooked) {
+                    printf("Cooked %s in %.0f ms\n", job.relativePath.c_str(), milliseconds);
+                } else {
+                    printf("Impossible to cook %s\n", job.relativePath.c_str());
+                    failures++;
+                }
+            }
+        }));
+    }
+    for(size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+
+    // Failed sources are left out of the manifest, so the next run tries them again
+    std::map<std::string, ManifestEntry> manifest;
+    for(size_t i = 0; i < jobs.size(); i++) {
+        if(jobs[i].stale && !jobs[i].cooked)
+            continue;
+        ManifestEntry &entry = manifest[jobs[i].relativePath];
+        entry.source = jobs[i].source;
+        entry.source.path = jobs[i].relativePath;
+        entry.dependencies = entries[i].dependencies;
+    }
+    // The caches of sources that disappeared would never be read again
+    for(std::map<std::string, ManifestEntry>::const_iterator it = previous.begin(); it != previous.end(); ++it) {
+        if(manifest.find(it->first) == manifest.end() && !std::binary_search(paths.begin(), paths.end(), it->first))
+            remove(meshCachePath((root + it->first).c_str()).c_str());
+    }
+    bool written = writeManifest(manifestPath, options, manifest);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu sources, %zu cooked, %d failed, %zu up to date, in %.2f s\n", jobs.size(), stale.size() - (size_t)failures,
+           (int)failures, jobs.size() - stale.size(), seconds);
+    return failures == 0 && written ? 0 : 1;
+}
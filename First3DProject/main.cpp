@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <string.h>
+#include <ctype.h>
 
 #include <GL/glew.h> // Always include GLEW before gl.h and glfw3.h, since it's a bit magic.
 
@@ -18,6 +21,21 @@ GLFWwindow* window;
 #include "shader/shader.hpp" // include LoadShaders function.
 #include "controls.hpp"  // include keyboard and mouse control
 #include "objloader.hpp"
+#include "meshcache.hpp"
+#include "objstream.hpp"
+#include "assetloader.hpp"
+#include "mesh.hpp"
+#include "vertexpacking.hpp"
+#include "vertexformat.hpp"
+#include "geometrypool.hpp"
+#include "uniformring.hpp"
+#include "meshsimplifier.hpp"
+#include "lodselector.hpp"
+#include "meshlets.hpp"
+#include "meshcooker.hpp"
+#include "primitives.hpp"
+
+static bool verbose = false; // --verbose : what every mesh upload takes
 
 bool initializeWindow() {
     // Initialise GLFW
@@ -83,18 +101,62 @@ public:
     
     glm::mat4 modelMatrix;
     
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec2> uvs;
-    std::vector<glm::vec3> normals;
+    Mesh mesh; // no indices: draw the vertices as a plain triangle list; no parts: draw everything with color
+    std::vector<bool> groupVisible; // per mesh group, see setGroupVisible()
+    int lod; // 0 draws the full mesh, n draws mesh.lods[n - 1]
+    std::vector<unsigned int> lodTriangles; // of the full mesh, then of every lod
+    std::vector<unsigned int> partMeshlets; // first of mesh.meshlets of every part, and one past the last
+    glm::vec3 boundsCenter; // bounding sphere of the whole mesh, in model space
+    float boundsRadius;
+    
+    MeshCache meshCache; // when open, the mesh is uploaded from the .mesh file instead of the mesh above
+    OBJStream objStream; // when open, the mesh is still streaming in, see streamObj()
+    OBJBatch streamBatch;
     
     GLuint VertexArrayID;
     GLuint vertexbuffer;
     GLuint uvbuffer;
     GLuint normalbuffer;
+    GLuint elementbuffer;
+    GLenum indexType;
+    VertexEncoding encoding; // of the uploaded attributes, see setVertexEncoding()
+    VertexLayout layout; // one interleaved buffer, or one per attribute, see setVertexLayout()
+    glm::vec3 positionScale; // what the vertex shader needs to decode them
+    glm::vec3 positionOffset;
+    float normalScale;
+    GLsizei vertexCount;
+    GLsizei elementCount;
+    std::vector<Instance> instances; // when not empty, the mesh is drawn once per instance, see uploadInstances()
+    GLuint instancebuffer;
+    GLsizei instanceCount; // of the uploaded instances
+    GeometryPool *pool; // when set, the mesh goes to the pool instead of buffers of its own, see setGeometryPool()
+    PoolMesh poolMesh;
+    bool pooled; // it went: draw it through pool
+    bool ready; // the buffers exist and can be drawn
     
     VBO() {
         color = glm::vec3(0.5,0.5,0.5);
         modelMatrix = glm::mat4(1.0);
+        VertexArrayID = 0;
+        vertexbuffer = 0;
+        uvbuffer = 0;
+        normalbuffer = 0;
+        elementbuffer = 0;
+        indexType = GL_UNSIGNED_INT;
+        layout = VERTEX_LAYOUT_INTERLEAVED;
+        positionScale = glm::vec3(1.0f);
+        positionOffset = glm::vec3(0.0f);
+        normalScale = 0.0f;
+        vertexCount = 0;
+        elementCount = 0;
+        instancebuffer = 0;
+        instanceCount = 0;
+        pool = NULL;
+        pooled = false;
+        ready = false;
+        lod = 0;
+        boundsCenter = glm::vec3(0.0f);
+        boundsRadius = 0.0f;
     }
     
     void setColor(float r, float g, float b) {
@@ -121,107 +183,706 @@ public:
         modelMatrix = glm::rotate(modelMatrix, 0.01F, glm::vec3(x, y, z));
     }
     
-    void loadObj(const char *path) {
-        loadOBJ(path, vertices, uvs, normals);
+    bool loadObj(const char *path) {
+        // A binary cache that still matches the OBJ file and its materials makes parsing unnecessary
+        if(meshCache.open(path)) {
+            printf("Using mesh cache %s\n", meshCachePath(path).c_str());
+            mesh.parts.assign(meshCache.parts(), meshCache.parts() + meshCache.partCount());
+            meshCache.materials(mesh.materials);
+            meshCache.groups(mesh.groups);
+            meshCache.lods(mesh.lods);
+            mesh.meshlets.assign(meshCache.meshlets(), meshCache.meshlets() + meshCache.meshletCount());
+            return true;
+        }
+        // Same stages as the offline cooker, so a model it didn't cook yet comes out identical
+        if(!cookOBJMesh(path, mesh, OBJ_LOAD_PARALLEL))
+            return false;
+        writeMeshCache(path, mesh, cacheCompression());
+        return true;
     }
     
-    void genBuffers() {
-        // Load it into a VBO
-
+    // A compressed cache is smaller, and decoded faster than it reads off a disk, but it's quantized :
+    // only worth it when the uploaded attributes are quantized anyway. Float ones come from a raw cache, mapped and uploaded as is
+    MeshCacheCompression cacheCompression() {
+        bool quantized = encoding.position != VERTEX_POSITION_FLOAT && encoding.normal != VERTEX_NORMAL_FLOAT && encoding.uv != VERTEX_UV_FLOAT;
+        return quantized ? MESH_CACHE_COMPRESSED : MESH_CACHE_RAW;
+    }
+    
+    // With copy, the model is loaded once for both, e.g. when it's also drawn instanced: copy gets the same mesh
+    // (call its setters before, and don't touch its mesh until it's ready)
+    std::future<bool> loadObjAsync(AssetLoader &loader, const char *path, VBO *copy = NULL) {
+        // loadObj only touches memory and files, so it runs on a worker;
+        // the buffers are created on the GL thread once it's done
+        std::string file(path);
+        return loader.submit([this, file, copy]() {
+                                 if(!loadObj(file.c_str()))
+                                     return false;
+                                 if(copy != NULL) {
+                                     readCachedVertices();
+                                     copy->mesh = mesh;
+                                 }
+                                 return true;
+                             },
+                             [this, copy](bool loaded) {
+                                 if(!loaded)
+                                     return;
+                                 genBuffers();
+                                 if(copy != NULL)
+                                     copy->genBuffers();
+                             });
+    }
+    
+    // Copies the vertices and indices of an open cache into mesh, which has the rest of it already, and closes the cache
+    void readCachedVertices() {
+        if(!meshCache.isOpen())
+            return;
+        size_t count = meshCache.header().vertexCount;
+        const glm::vec3 *positions = (const glm::vec3 *)meshCache.attribute(MESH_ATTRIBUTE_POSITION);
+        const glm::vec2 *uvs = (const glm::vec2 *)meshCache.attribute(MESH_ATTRIBUTE_UV);
+        const glm::vec3 *normals = (const glm::vec3 *)meshCache.attribute(MESH_ATTRIBUTE_NORMAL);
+        mesh.vertices.assign(positions, positions + count);
+        mesh.uvs.assign(uvs, uvs + count);
+        mesh.normals.assign(normals, normals + count);
+        size_t indexCount = meshCache.header().indexCount;
+        if(meshCache.header().indexSize == 2) {
+            const unsigned short *indices = (const unsigned short *)meshCache.indexData();
+            mesh.indices.assign(indices, indices + indexCount);
+        } else {
+            const unsigned int *indices = (const unsigned int *)meshCache.indexData();
+            mesh.indices.assign(indices, indices + indexCount);
+        }
+        meshCache.close();
+    }
+    
+    // e.g. a model decompressed out of an archive, parsed in place. It goes through the same stages as a file,
+    // without the cache; its material libraries are looked up in directory, or not at all if it's NULL
+    bool loadObj(const char *buffer, size_t size, const char *directory = NULL) {
+        return loadOBJMesh(buffer, size, directory, mesh, OBJ_LOAD_PARALLEL) && cookMesh(mesh);
+    }
+    
+    bool loadObj(std::istream &stream, const char *directory = NULL) {
+        return loadOBJMesh(stream, directory, mesh, OBJ_LOAD_PARALLEL) && cookMesh(mesh);
+    }
+    
+    // Compact attribute encodings, e.g. for large scenes; call before the buffers are created
+    void setVertexEncoding(const VertexEncoding &vertexEncoding) {
+        encoding = vertexEncoding;
+    }
+    
+    void streamObj(const char *path) {
+        // Don't parse up front: genBuffers sizes the buffers for the whole mesh,
+        // and uploadStreamedBatches appends the triangles to them while the render loop runs
+        objStream.open(path);
+    }
+    
+    // Static meshes share the pool's buffers and are drawn with all the others in one call; call before the buffers are created.
+    // Meshes that stream in, have instances or no indices, or don't fit, keep buffers of their own
+    void setGeometryPool(GeometryPool *geometryPool) {
+        pool = geometryPool;
+    }
+    
+    // Whole vertices in one buffer (the default), or one buffer per attribute; call before the buffers are created
+    void setVertexLayout(VertexLayout vertexLayout) {
+        layout = vertexLayout;
+    }
+    
+    GLuint createBuffer(GLenum target, const void *data, size_t bytes) {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        glBufferData(target, bytes, data, GL_STATIC_DRAW);
+        return buffer;
+    }
+    
+    // The vertex array records the element buffer bound while it is bound, so it's created first
+    void createVertexArray(const void *indexData, size_t indexBytes) {
         glGenVertexArrays(1, &VertexArrayID);
         glBindVertexArray(VertexArrayID);
+        if(indexBytes > 0)
+            elementbuffer = createBuffer(GL_ELEMENT_ARRAY_BUFFER, indexData, indexBytes);
+    }
+    
+    // One buffer per attribute, e.g. for streamed meshes whose batches are appended to each of them
+    void uploadBuffers(const void *vertexData, size_t vertexBytes, const void *uvData, size_t uvBytes, const void *normalData, size_t normalBytes, const void *indexData, size_t indexBytes) {
+        layout = VERTEX_LAYOUT_SEPARATE;
+        createVertexArray(indexData, indexBytes);
+        vertexbuffer = createBuffer(GL_ARRAY_BUFFER, vertexData, vertexBytes);
+        uvbuffer = createBuffer(GL_ARRAY_BUFFER, uvData, uvBytes);
+        normalbuffer = createBuffer(GL_ARRAY_BUFFER, normalData, normalBytes);
+        specifyAttributes();
+        glBindVertexArray(0);
+        uploadInstances(); // filled in before the mesh was loaded
+    }
+    
+    // One buffer of interleaved vertices, see interleaveVertices()
+    void uploadInterleavedBuffer(const void *vertexData, size_t vertexBytes, const void *indexData, size_t indexBytes) {
+        layout = VERTEX_LAYOUT_INTERLEAVED;
+        createVertexArray(indexData, indexBytes);
+        vertexbuffer = createBuffer(GL_ARRAY_BUFFER, vertexData, vertexBytes);
+        uvbuffer = vertexbuffer;
+        normalbuffer = vertexbuffer;
+        specifyAttributes();
+        glBindVertexArray(0);
+        uploadInstances(); // filled in before the mesh was loaded
+    }
+    
+    // Index of the group called name (an OBJ "o" or "g"), or -1
+    int findGroup(const char *name) {
+        for(size_t i = 0; i < mesh.groups.size(); i++)
+            if(mesh.groups[i].name == name)
+                return (int)i;
+        return -1;
+    }
+    
+    // Hidden groups are left out of the draws, e.g. the parts of a big model that are off-screen
+    void setGroupVisible(int group, bool visible) {
+        if(group >= 0 && (size_t)group < groupVisible.size())
+            groupVisible[group] = visible;
+    }
+    
+    // Draws a simplified version of the mesh, if it has that many levels of detail
+    void setLod(int level) {
+        lod = std::max(0, std::min(level, (int)mesh.lods.size()));
+    }
+    
+    // Parts of the level of detail being drawn, parallel to mesh.parts
+    const std::vector<MeshPart> &lodParts() {
+        return lod == 0 ? mesh.parts : mesh.lods[lod - 1].parts;
+    }
+    
+    // Triangle counts and bounding sphere the lod selection works with
+    void computeLodInfo() {
+        lodTriangles.assign(1, 0);
+        for(const MeshPart &part : mesh.parts)
+            lodTriangles[0] += part.indexCount / 3;
+        if(objStream.isOpen())
+            lodTriangles[0] = objStream.triangleCount();
+        else if(mesh.parts.empty())
+            lodTriangles[0] = (mesh.indices.empty() ? mesh.vertices.size() : mesh.indices.size()) / 3;
+        for(const MeshLod &level : mesh.lods) {
+            unsigned int triangles = 0;
+            for(const MeshPart &part : level.parts)
+                triangles += part.indexCount / 3;
+            lodTriangles.push_back(triangles);
+        }
+        if(mesh.groups.empty())
+            return;
+        glm::vec3 boundsMin = mesh.groups[0].boundsMin, boundsMax = mesh.groups[0].boundsMax;
+        for(const MeshGroup &group : mesh.groups) {
+            boundsMin = glm::min(boundsMin, group.boundsMin);
+            boundsMax = glm::max(boundsMax, group.boundsMax);
+        }
+        boundsCenter = (boundsMin + boundsMax) * 0.5f;
+        boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+    }
+    
+    // Which meshlets belong to which part, so the draws of a part can be culled cluster by cluster
+    void computeMeshletRanges() {
+        partMeshlets.assign(mesh.parts.size() + 1, 0);
+        for(const Meshlet &meshlet : mesh.meshlets)
+            partMeshlets[meshlet.part + 1]++;
+        for(size_t p = 0; p < mesh.parts.size(); p++)
+            partMeshlets[p + 1] += partMeshlets[p];
+    }
+    
+    // The bounding sphere in world space, for the lod selector
+    LodRequest lodRequest() {
+        LodRequest request;
+        glm::vec4 center = modelMatrix * glm::vec4(boundsCenter, 1.0f);
+        float scale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        request.center = glm::vec3(center);
+        request.radius = boundsRadius * scale;
+        request.errorScale = scale;
+        request.lods = &mesh.lods;
+        request.triangles = lodTriangles.data();
+        request.level = lod;
+        return request;
+    }
+    
+    bool isGroupVisible(size_t group) {
+        return group >= groupVisible.size() || groupVisible[group];
+    }
+    
+    // Packs the float attributes with the VBO's encoding and uploads them
+    void uploadPackedBuffers(const glm::vec3 *positions, const glm::vec2 *texcoords, const glm::vec3 *normalData, size_t count, const void *indexData, size_t indexBytes) {
+        if(pool != NULL && instances.empty() && indexBytes > 0) {
+            size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+            pooled = pool->add(positions, texcoords, normalData, count, indexData, indexSize, indexBytes / indexSize, poolMesh);
+            if(pooled && verbose)
+                printf("Geometry pool: %.1f of %.1f MB used\n", pool->usedBytes() / 1048576.0, pool->capacityBytes() / 1048576.0);
+            if(pooled)
+                return;
+        }
+        PackedVertices packed;
+        packVertices(encoding, positions, texcoords, normalData, count, packed);
+        positionScale = packed.positionScale;
+        positionOffset = packed.positionOffset;
+        normalScale = packed.normalScale;
+        if(verbose)
+            printf("Vertex data: %.1f KB, %u bytes per vertex (%.1f KB as floats)\n",
+                   count * vertexSize(encoding) / 1024.0, (unsigned int)vertexSize(encoding), count * vertexSize(VertexEncoding()) / 1024.0);
+        if(layout == VERTEX_LAYOUT_INTERLEAVED) {
+            std::vector<unsigned char> vertices;
+            interleaveVertices(encoding, packed, count, vertices);
+            uploadInterleavedBuffer(vertices.data(), vertices.size(), indexData, indexBytes);
+        } else {
+            uploadBuffers(packed.positions.data(), packed.positions.size(), packed.uvs.data(), packed.uvs.size(),
+                          packed.normals.data(), packed.normals.size(), indexData, indexBytes);
+        }
+    }
+    
+    void genBuffers() {
+        ready = true;
+        groupVisible.assign(mesh.groups.size(), true);
+        computeLodInfo();
+        computeMeshletRanges();
+        if(objStream.isOpen()) {
+            encoding = VertexEncoding(); // batches are appended as they come, unpacked
+            size_t capacity = objStream.triangleCount() * 3;
+            vertexCount = 0;
+            elementCount = 0;
+            uploadBuffers(NULL, capacity * sizeof(glm::vec3), NULL, capacity * sizeof(glm::vec2), NULL, capacity * sizeof(glm::vec3), NULL, 0);
+            return;
+        }
+        if(meshCache.isOpen()) {
+            const MeshCacheHeader &header = meshCache.header();
+            vertexCount = header.vertexCount;
+            elementCount = header.indexCount;
+            indexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            uploadPackedBuffers((const glm::vec3 *)meshCache.attribute(MESH_ATTRIBUTE_POSITION),
+                                (const glm::vec2 *)meshCache.attribute(MESH_ATTRIBUTE_UV),
+                                (const glm::vec3 *)meshCache.attribute(MESH_ATTRIBUTE_NORMAL),
+                                vertexCount, meshCache.indexData(), meshCache.indexDataSize());
+            meshCache.close(); // glBufferData made its own copy
+            return;
+        }
         
-        glGenBuffers(1, &vertexbuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-
-        glGenBuffers(1, &uvbuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-        glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-
-        glGenBuffers(1, &normalbuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
+        vertexCount = mesh.vertices.size();
+        elementCount = mesh.indices.size();
+        
+        // Halve the index buffer whenever every vertex is addressable with 16 bits
+        std::vector<unsigned short> shortIndices;
+        const void *indexData = mesh.indices.data();
+        size_t indexBytes = mesh.indices.size() * sizeof(unsigned int);
+        indexType = GL_UNSIGNED_INT;
+        if(!mesh.indices.empty() && mesh.vertices.size() <= 65536) {
+            shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+            indexData = shortIndices.data();
+            indexBytes = shortIndices.size() * sizeof(unsigned short);
+            indexType = GL_UNSIGNED_SHORT;
+        }
+        
+        uploadPackedBuffers(mesh.vertices.data(), mesh.uvs.data(), mesh.normals.data(), mesh.vertices.size(), indexData, indexBytes);
+    }
+    
+    void uploadStreamedBatches(int maxBatches) {
+        const size_t batchTriangles = 4096;
+        for(; objStream.isOpen() && maxBatches > 0; maxBatches--) {
+            if(!objStream.next(streamBatch, batchTriangles)) {
+                objStream.close(); // done, or the file turned out to be malformed: keep what was drawn so far
+                break;
+            }
+            size_t first = streamBatch.firstTriangle * 3;
+            size_t count = streamBatch.vertices.size();
+            glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec3), count * sizeof(glm::vec3), &streamBatch.vertices[0]);
+            glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec2), count * sizeof(glm::vec2), &streamBatch.uvs[0]);
+            glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec3), count * sizeof(glm::vec3), &streamBatch.normals[0]);
+            vertexCount = first + count;
+        }
+    }
+    
+    // Color a part is drawn with: its material's diffuse color, or the object's own color
+    glm::vec3 partColor(const MeshPart &part) {
+        if(part.material == MESH_NO_MATERIAL || part.material >= mesh.materials.size())
+            return color;
+        return mesh.materials[part.material].diffuse;
+    }
+    
+    // Points the attributes of the bound vertex array at the buffers. The vertex array keeps all of it,
+    // so this runs once when the buffers are created, and a draw only has to bind the vertex array.
+    // The calls come from the compile-time format of the encoding, see vertexformat.hpp
+    void specifyAttributes() {
+        VertexAttributeSetup setup = vertexAttributeSetup(encoding);
+        if(layout == VERTEX_LAYOUT_SEPARATE) {
+            GLuint buffers[3] = { vertexbuffer, uvbuffer, normalbuffer };
+            setup.specifySeparate(buffers);
+        } else if(GLEW_ARB_vertex_attrib_binding) {
+            setup.specifyFormats(0);
+            glBindVertexBuffer(0, vertexbuffer, 0, setup.stride);
+        } else {
+            setup.specifyInterleaved(vertexbuffer);
+        }
+    }
+    
+    void bind() {
+        glBindVertexArray(VertexArrayID);
+    }
+    
+    // Sends instances to the GPU: from then on, one draw call draws the mesh once per instance, wherever the instances are.
+    // Call again after changing them, e.g. every frame to animate them: the mesh stays, only the instance buffer is refilled
+    void uploadInstances() {
+        if(VertexArrayID == 0 || (instances.empty() && instancebuffer == 0))
+            return; // uploaded along with the mesh
+        if(instancebuffer == 0) {
+            glGenBuffers(1, &instancebuffer);
+            glBindVertexArray(VertexArrayID);
+            InstanceFormat::specifyInstanced(instancebuffer);
+            glBindVertexArray(0);
+        }
+        // A new store every time, so the GPU can go on reading last frame's instances meanwhile
+        glBindBuffer(GL_ARRAY_BUFFER, instancebuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_STREAM_DRAW);
+        instanceCount = (GLsizei)instances.size();
+    }
+    
+    // Draws count elements (or vertices, without an index buffer) from first on, the vertex array must be bound
+    void drawRange(GLsizei first, GLsizei count) {
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        if(instancebuffer != 0) {
+            if(elementCount == 0)
+                glDrawArraysInstanced(GL_TRIANGLES, first, count, instanceCount);
+            else
+                glDrawElementsInstanced(GL_TRIANGLES, count, indexType, (void*)(first * indexSize), instanceCount);
+        } else if(elementCount == 0) {
+            glDrawArrays(GL_TRIANGLES, first, count);
+        } else {
+            glDrawElements(GL_TRIANGLES, count, indexType, (void*)(first * indexSize));
+        }
     }
     
     void handleVertexAttribArray() {
-        
-        // 1rst attribute buffer : vertices
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // attribute, size, type, normalized?, stride, array buffer offset
-
-        // 2nd attribute buffer : UVs
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // attribute, size, type, normalized?, stride, array buffer offset
-
-        // 3rd attribute buffer : normals
-        glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0); // attribute, size, type, normalized?, stride, array buffer offset
-
+        bind();
         // Draw the triangles !
-        glDrawArrays(GL_TRIANGLES, 0, vertices.size() );
-
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(2);
+        drawRange(0, elementCount == 0 ? vertexCount : elementCount);
     }
     
     void cleanUp() {
         glDeleteBuffers(1, &vertexbuffer);
-        glDeleteBuffers(1, &uvbuffer);
-        glDeleteBuffers(1, &normalbuffer);
+        if(layout == VERTEX_LAYOUT_SEPARATE) {
+            glDeleteBuffers(1, &uvbuffer);
+            glDeleteBuffers(1, &normalbuffer);
+        }
+        if(elementbuffer != 0)
+            glDeleteBuffers(1, &elementbuffer);
+        if(instancebuffer != 0)
+            glDeleteBuffers(1, &instancebuffer);
         glDeleteVertexArrays(1, &VertexArrayID);
     }
     
 };
 
 
+// Stand-in drawn for models that are still loading: a unit box built by the compiler, so it's there on the very first frame
+static constexpr auto placeholderBox = boxArrays<1>(1.0f, 1.0f, 1.0f);
+
+void makePlaceholder(VBO &placeholder) {
+    assignPrimitive(placeholder.mesh, placeholderBox);
+    placeholder.setColor(0.2f, 0.2f, 0.2f);
+    placeholder.genBuffers();
+}
+
+// One glDrawElements of the frame: a range of geometry's buffers, drawn with object's matrix in color
+struct Draw {
+    VBO *object;
+    VBO *geometry; // object itself, or the placeholder while object is loading
+    GLsizei first;
+    GLsizei count;
+    glm::vec3 color;
+};
+
+// Draws that share a color are drawn one after the other, so the uniform is set once for all of them
+bool drawBefore(const Draw &a, const Draw &b) {
+    if(a.color.x != b.color.x) return a.color.x < b.color.x;
+    if(a.color.y != b.color.y) return a.color.y < b.color.y;
+    if(a.color.z != b.color.z) return a.color.z < b.color.z;
+    if(a.geometry != b.geometry) return a.geometry < b.geometry;
+    return a.object < b.object;
+}
+
+// Appends the draws of vbo to draws: one per material part of each visible group.
+// At full detail, parts are culled meshlet by meshlet, and each run of visible meshlets is one draw;
+// not for instanced meshes, where a meshlet hidden in one instance may well show in another.
+void collectDraws(VBO *vbo, VBO &placeholder, MeshletCuller &culler, std::vector<Draw> &draws) {
+    Draw draw;
+    draw.object = vbo;
+    draw.geometry = vbo->ready ? vbo : &placeholder;
+    draw.first = 0;
+    draw.count = draw.geometry->elementCount == 0 ? draw.geometry->vertexCount : draw.geometry->elementCount;
+    draw.color = vbo->getAmbientColor();
+    if(!vbo->ready || vbo->mesh.parts.empty()) {
+        draws.push_back(draw);
+        return;
+    }
+    for(size_t g = 0; g < vbo->mesh.groups.size(); g++) {
+        if(!vbo->isGroupVisible(g))
+            continue;
+        const MeshGroup &group = vbo->mesh.groups[g];
+        const std::vector<MeshPart> &parts = vbo->lodParts();
+        for(unsigned int p = group.firstPart; p < group.firstPart + group.partCount; p++) {
+            const MeshPart &part = parts[p];
+            if(part.indexCount == 0)
+                continue;
+            draw.color = vbo->partColor(part);
+            if(vbo->lod != 0 || vbo->instanceCount > 0 || vbo->partMeshlets[p] == vbo->partMeshlets[p + 1]) {
+                draw.first = part.firstIndex;
+                draw.count = part.indexCount;
+                draws.push_back(draw);
+                continue;
+            }
+            draw.count = 0;
+            for(unsigned int m = vbo->partMeshlets[p]; m < vbo->partMeshlets[p + 1]; m++) {
+                const Meshlet &meshlet = vbo->mesh.meshlets[m];
+                if(!culler.isVisible(meshlet))
+                    continue;
+                if(draw.count > 0 && (unsigned int)(draw.first + draw.count) == meshlet.firstIndex) {
+                    draw.count += meshlet.indexCount;
+                    continue;
+                }
+                if(draw.count > 0)
+                    draws.push_back(draw);
+                draw.first = meshlet.firstIndex;
+                draw.count = meshlet.indexCount;
+            }
+            if(draw.count > 0)
+                draws.push_back(draw);
+        }
+    }
+}
+
+// Points the program's uniform blocks at their binding points, see uniformring.hpp
+void bindUniformBlocks(GLuint programID) {
+    GLuint frameBlock = glGetUniformBlockIndex(programID, "Frame");
+    GLuint objectBlock = glGetUniformBlockIndex(programID, "Object");
+    if(frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(programID, frameBlock, UNIFORM_FRAME_BINDING);
+    if(objectBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(programID, objectBlock, UNIFORM_OBJECT_BINDING);
+}
+
+// CPU time spent submitting objectCount small objects, per draw, the way draws used to be issued
+// (three buffers, attributes re-specified, enabled and disabled around every draw)
+// and with the vertex array set up once at upload (one interleaved buffer, a draw binds it and draws).
+// glFinish keeps the GPU's backlog out of the measured submission time.
+void runDrawBenchmark(int objectCount) {
+    const int frames = 200, warmupFrames = 20;
+    VBO *separate = new VBO[objectCount];
+    VBO *interleaved = new VBO[objectCount];
+    int side = (int)std::ceil(std::sqrt((double)objectCount));
+    glm::mat4 View = glm::lookAt(glm::vec3(0, 0, side * 1.5f), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+    glm::mat4 Projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+    
+    // The uniforms stay the same every frame: written once, and bound by offset for each draw
+    // (sized once created: alignedSize depends on the GL's offset alignment)
+    UniformRing uniforms;
+    if(!uniforms.create(1)) {
+        fprintf(stderr, "Draw benchmark: no uniform buffer\n");
+        delete[] separate;
+        delete[] interleaved;
+        return;
+    }
+    uniforms.beginFrame(uniforms.alignedSize(sizeof(FrameUniforms)) + objectCount * uniforms.alignedSize(sizeof(ObjectUniforms)));
+    GLintptr frameOffset;
+    FrameUniforms *frame = (FrameUniforms *)uniforms.allocate(sizeof(FrameUniforms), frameOffset);
+    if(frame == NULL) {
+        fprintf(stderr, "Draw benchmark: no room for the frame uniforms\n");
+        delete[] separate;
+        delete[] interleaved;
+        return;
+    }
+    frame->V = View;
+    frame->P = Projection;
+    frame->lightPosition = glm::vec4(0, 0, side * 1.5f, 1);
+    std::vector<GLintptr> objectOffsets(objectCount);
+    for(int i = 0; i < objectCount; i++) {
+        glm::mat4 Model = glm::translate(glm::mat4(1.0f), glm::vec3(i % side - side / 2, i / side - side / 2, 0));
+        ObjectUniforms *object = (ObjectUniforms *)uniforms.allocate(sizeof(ObjectUniforms), objectOffsets[i]);
+        if(object == NULL) {
+            fprintf(stderr, "Draw benchmark: no room for the uniforms of object %d\n", i);
+            delete[] separate;
+            delete[] interleaved;
+            return;
+        }
+        setObjectUniforms(*object, Model, Projection * View, glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(0.0f), 0.0f);
+    }
+    uniforms.flush();
+    glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_FRAME_BINDING, uniforms.buffer(), frameOffset, sizeof(FrameUniforms));
+    
+    for(int i = 0; i < objectCount; i++) {
+        generateBox(separate[i].mesh, 0.5f, 0.5f, 0.5f);
+        separate[i].setVertexLayout(VERTEX_LAYOUT_SEPARATE);
+        separate[i].genBuffers();
+        generateBox(interleaved[i].mesh, 0.5f, 0.5f, 0.5f);
+        interleaved[i].genBuffers();
+    }
+    
+    for(int pass = 0; pass < 2; pass++) {
+        VBO *objects = pass == 0 ? separate : interleaved;
+        double submitted = 0;
+        for(int frame = 0; frame < frames; frame++) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+            double start = glfwGetTime();
+            for(int i = 0; i < objectCount; i++) {
+                VBO &object = objects[i];
+                glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_OBJECT_BINDING, uniforms.buffer(), objectOffsets[i], sizeof(ObjectUniforms));
+                object.bind();
+                if(pass == 0)
+                    object.specifyAttributes();
+                object.drawRange(0, object.elementCount);
+                if(pass == 0) {
+                    glDisableVertexAttribArray(0);
+                    glDisableVertexAttribArray(1);
+                    glDisableVertexAttribArray(2);
+                }
+            }
+            glBindVertexArray(0);
+            if(frame >= warmupFrames)
+                submitted += glfwGetTime() - start;
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        double perFrame = submitted / (frames - warmupFrames);
+        printf("%s: %.3f ms per frame, %.3f us per draw (%d objects)\n",
+               pass == 0 ? "Separate buffers, attributes per draw" : "Interleaved, vertex array per object",
+               perFrame * 1000.0, perFrame * 1e6 / objectCount, objectCount);
+    }
+    
+    for(int i = 0; i < objectCount; i++) {
+        separate[i].cleanUp();
+        interleaved[i].cleanUp();
+    }
+    delete[] separate;
+    delete[] interleaved;
+}
+
 int main(int argc, const char * argv[]) {
+    // --draw-benchmark [objects] : measures draw submission instead of showing the scene
+    // --no-pool : every mesh keeps its own buffers and draw calls
+    // --instances N : a crowd of N spinning suzannes behind the scene
+    // --verbose : prints the size of every mesh uploaded
+    int benchmarkObjects = 0;
+    bool usePool = true;
+    int crowdSize = 0;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--draw-benchmark") == 0) {
+            benchmarkObjects = i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]) ? std::max(atoi(argv[++i]), 1) : 4000;
+        } else if(strcmp(argv[i], "--no-pool") == 0) {
+            usePool = false;
+        } else if(strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            crowdSize = std::max(atoi(argv[++i]), 0);
+        } else if(strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Unknown option %s\nOptions: --draw-benchmark [objects], --no-pool, --instances N, --verbose\n", argv[i]);
+            return 2;
+        }
+    }
     
     if(!initializeWindow())
         return -1;
 
     // Create and compile our GLSL program from the shaders
-    GLuint programID = LoadShaders( "/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/shader/StandardShading.vertexshader", "/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/shader/StandardShading.fragmentshader" );
+    // The vertex inputs are declared by the vertex formats, every packed format feeds the same ones
+    static constexpr auto meshInputs = FloatVertexFormat::shaderInputs();
+    static constexpr auto vertexInputs = joinShaderText(meshInputs, InstanceFormat::shaderInputs());
+    GLuint programID = LoadShaders( "/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/shader/StandardShading.vertexshader", "/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/shader/StandardShading.fragmentshader", vertexInputs.text );
 
-    // Get a handle for our "LightPosition" uniform
+    // The uniforms come in blocks: Frame once per frame, Object once per object drawn, see uniformring.hpp
     glUseProgram(programID);
-    GLuint LightID = glGetUniformLocation(programID, "LightPosition_worldspace");
+    setDefaultInstance();
+    bindUniformBlocks(programID);
     
-    GLuint ColorID = glGetUniformLocation(programID, "AmbientColor");
-    
-    // Get a handle for our "MVP" uniform
-    GLuint MatrixID = glGetUniformLocation(programID, "MVP");
-    GLuint ViewMatrixID = glGetUniformLocation(programID, "V");
-    GLuint ModelMatrixID = glGetUniformLocation(programID, "M");
+    if(benchmarkObjects > 0) {
+        runDrawBenchmark(benchmarkObjects);
+        glDeleteProgram(programID);
+        glfwTerminate();
+        return 0;
+    }
 
     std::vector<VBO*> vbos;
+    std::vector<Draw> draws;
+    std::vector<GLintptr> drawOffsets; // of the Object uniforms of each draw in uniformRing
+    
+    // Per-frame and per-object uniforms are written into three frames' worth of buffer, mapped once where GL allows;
+    // it grows when a frame needs more
+    UniformRing uniformRing;
+    uniformRing.create(64 * 1024);
+    
+    // Levels of detail keep the triangle count flat whether the camera is close or far
+    LodSelector lodSelector(2.0f, 500000); // at most 2 pixels of error, 500k triangles per frame
+    std::vector<LodRequest> lodRequests;
+    std::vector<VBO*> lodObjects;
+    int frame = 0;
+    
+    // Static meshes share one geometry pool, drawn with one glMultiDrawElementsIndirect and a program of its own (GL 4.3 and up).
+    // Without it, or with --no-pool, every mesh keeps its own buffers and draw calls
+    GeometryPool pool;
+    GLuint pooledProgramID = 0;
+    if(usePool && pool.create(VertexEncoding(VERTEX_POSITION_UNORM16, VERTEX_NORMAL_OCT8, VERTEX_UV_HALF), 1 << 20, 3 << 20)) {
+        std::string pooledInputs = std::string(pool.drawIDDeclaration()) + meshInputs.text;
+        pooledProgramID = LoadShaders( "/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/shader/PooledShading.vertexshader", "/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/shader/StandardShading.fragmentshader", pooledInputs.c_str() );
+        GLint linked = GL_FALSE;
+        glGetProgramiv(pooledProgramID, GL_LINK_STATUS, &linked);
+        if(linked) {
+            bindUniformBlocks(pooledProgramID);
+        } else {
+            pool.destroy();
+        }
+    }
+    GeometryPool *sharedPool = pool.isCreated() ? &pool : NULL;
+    printf("Geometry pool: %s\n", sharedPool != NULL ? "on, one indirect draw for all static meshes" : "off, one draw call per mesh part");
+    
+    // Models are parsed on worker threads and uploaded a few per frame;
+    // until then they are drawn as the placeholder
+    AssetLoader loader;
+    VBO placeholder;
+    placeholder.setGeometryPool(sharedPool);
+    makePlaceholder(placeholder);
     
+    // Primitives are generated, not loaded: the same sizes cube.obj and cylinder.obj had
     VBO cube;
-    cube.loadObj("/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/objects/cube.obj");
+    cube.setGeometryPool(sharedPool);
+    generateBox(cube.mesh, 2, 2, 2);
+    cube.genBuffers();
     cube.setColor(1, 1, 1);
     cube.translate(0, -0.2, 0);
     vbos.push_back(&cube);
     
     VBO cylinder;
-    cylinder.loadObj("/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/objects/cylinder.obj");
+    cylinder.setGeometryPool(sharedPool);
+    generateCylinder(cylinder.mesh, 1, 2, 32);
+    cylinder.genBuffers();
     cylinder.setColor(0.396f, 0.262, 0.129);
     
+    cylinder.translate(0, 1, 0); // standing on y = 0, like the OBJ
     cylinder.scale(0.1, 1, 0.1);
     vbos.push_back(&cylinder);
     
     VBO suzanne;
+    suzanne.setGeometryPool(sharedPool);
+    suzanne.setVertexEncoding(VertexEncoding(VERTEX_POSITION_UNORM16, VERTEX_NORMAL_OCT8, VERTEX_UV_HALF)); // 14 instead of 32 bytes per vertex
     suzanne.translate(0, 2, 0);
     suzanne.setColor(0.396f, 0.262, 0.129); // set suzanne color to brown
-    suzanne.loadObj("/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/objects/suzanne.obj");
     vbos.push_back(&suzanne);
-
     
-    for(VBO* vbo : vbos)
-        vbo->genBuffers();
+    // --instances N : a crowd of N spinning suzannes behind the scene, all of them in one draw per part.
+    // It's suzanne's mesh, loaded once for both
+    int crowdSide = (int)std::ceil(std::sqrt((double)std::max(crowdSize, 1)));
+    VBO crowd;
+    if(crowdSize > 0) {
+        crowd.setVertexEncoding(VertexEncoding(VERTEX_POSITION_UNORM16, VERTEX_NORMAL_OCT8, VERTEX_UV_HALF));
+        crowd.setColor(1, 1, 1);
+        crowd.translate(0, 0, -crowdSide * 0.5f - 4.0f);
+        crowd.instances.resize(crowdSize);
+        for(int i = 0; i < crowdSize; i++)
+            crowd.instances[i].color = glm::vec3(0.5f + 0.5f * std::sin(i * 0.7f), 0.5f + 0.5f * std::sin(i * 1.3f), 0.5f + 0.5f * std::sin(i * 2.9f));
+        vbos.push_back(&crowd);
+    }
+    suzanne.loadObjAsync(loader, "/Users/nikoburkert/Documents/XCode/workspace/First-3D-Project-Yet/First3DProject/objects/suzanne.obj",
+                         crowdSize > 0 ? &crowd : NULL);
     
     // Animation loop
     do{
@@ -238,24 +899,128 @@ int main(int argc, const char * argv[]) {
 
         // camera radiates the light
         glm::vec3 lightPos = getCameraPositionVector();
-        glUniform3f(LightID, lightPos.x, lightPos.y, lightPos.z);
 
-        // draw all vbos
+        // upload the models the workers finished, spending at most 2 ms per frame on it
+        loader.uploadFinished(2.0);
+
+        // animate the crowd: the CPU only refills the instance buffer, drawing it is the same few calls for any size
+        if(crowdSize > 0) {
+            float time = (float)glfwGetTime();
+            for(int i = 0; i < crowdSize; i++) {
+                glm::vec3 position((i % crowdSide - crowdSide * 0.5f) * 1.5f, 0.0f, (i / crowdSide - crowdSide * 0.5f) * 1.5f);
+                crowd.instances[i].model = glm::rotate(glm::translate(glm::mat4(1.0f), position), time + i * 0.1f, glm::vec3(0, 1, 0)) * glm::scale(glm::vec3(0.5f));
+            }
+            crowd.uploadInstances();
+            if(crowd.ready)
+                crowd.setLod(crowdSize >= 10000 ? (int)crowd.mesh.lods.size() : 0); // a few pixels per suzanne at that size
+        }
+
+        // append the next batches of models that are still streaming in
+        for(VBO* vbo : vbos)
+            vbo->uploadStreamedBatches(4);
+
+        // pick the level of detail of every loaded vbo in one pass
+        lodRequests.clear();
+        lodObjects.clear();
+        for(VBO* vbo : vbos) {
+            if(!vbo->ready || vbo->instanceCount > 0)
+                continue; // instances are drawn at the level set with setLod()
+            lodRequests.push_back(vbo->lodRequest());
+            lodObjects.push_back(vbo);
+        }
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        lodSelector.select(lodRequests, ProjectionMatrix, framebufferHeight, getCameraPositionVector());
+        for(size_t i = 0; i < lodObjects.size(); i++)
+            lodObjects[i]->setLod(lodRequests[i].level);
+
+        // draw all vbos, grouped by material so uniforms and buffers only change when they have to;
+        // the clusters of dense meshes that are off-screen or face away are skipped
+        draws.clear();
+        MeshletCuller meshletCuller(ProjectionMatrix * ViewMatrix, getCameraPositionVector());
         for(VBO* vbo : vbos) {
-            glm::vec3 ambientColor = vbo->getAmbientColor();
-            glUniform3f(ColorID, ambientColor.x, ambientColor.y, ambientColor.z); //xyz = rgb
-            
-            glm::mat4 ModelMatrix = vbo->getModelMatrix();
-            glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
-   
-            // Send our transformation to the currently bound shader,
-            // in the "MVP" uniform
-            glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-            glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrix[0][0]);
-            glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrix[0][0]);
-
-            vbo->handleVertexAttribArray();
+            meshletCuller.setModelMatrix(vbo->getModelMatrix());
+            collectDraws(vbo, placeholder, meshletCuller, draws);
         }
+        if(++frame % 30 == 0) {
+            const LodStats &stats = lodSelector.stats();
+            char title[160];
+            snprintf(title, sizeof(title), "First-3D-Project-Yet - %u of %u triangles (%u saved), %u lod switches, %u of %u clusters culled",
+                     stats.drawnTriangles, stats.fullTriangles, stats.fullTriangles - stats.drawnTriangles, stats.switches,
+                     meshletCuller.culledCount(), meshletCuller.testedCount());
+            glfwSetWindowTitle(window, title);
+        }
+        std::sort(draws.begin(), draws.end(), drawBefore);
+        
+        // write the frame's uniforms, then the Object uniforms of every run of draws that share object, color and geometry,
+        // each in a slot of its own: nothing is sent to the driver per object, and the slots could be filled in parallel.
+        // Pooled draws get their indirect command and PoolDrawData from the same frame instead
+        size_t pooledDraws = 0;
+        for(size_t i = 0; i < draws.size(); i++)
+            pooledDraws += draws[i].geometry->pooled ? 1 : 0;
+        size_t frameBytes = uniformRing.alignedSize(sizeof(FrameUniforms)) + (draws.size() - pooledDraws) * uniformRing.alignedSize(sizeof(ObjectUniforms));
+        if(pooledDraws > 0)
+            frameBytes += uniformRing.alignedSize(pooledDraws * sizeof(DrawElementsIndirectCommand)) + uniformRing.alignedSize(pooledDraws * sizeof(PoolDrawData));
+        uniformRing.beginFrame(frameBytes);
+        if(pooledDraws > 0)
+            pool.beginDraws(uniformRing, pooledDraws);
+        GLintptr frameOffset;
+        FrameUniforms *frameUniforms = (FrameUniforms *)uniformRing.allocate(sizeof(FrameUniforms), frameOffset);
+        frameUniforms->V = ViewMatrix;
+        frameUniforms->P = ProjectionMatrix;
+        frameUniforms->lightPosition = glm::vec4(lightPos, 1.0f);
+        glm::mat4 ViewProjection = ProjectionMatrix * ViewMatrix;
+        drawOffsets.resize(draws.size());
+        size_t recordDraw = draws.size();
+        for(size_t i = 0; i < draws.size(); i++) {
+            const Draw &draw = draws[i];
+            if(draw.geometry->pooled) {
+                pool.addDraw(draw.geometry->poolMesh, draw.first, draw.count, draw.object->getModelMatrix(), draw.color);
+                continue;
+            }
+            if(recordDraw < draws.size() && draw.object == draws[recordDraw].object && draw.geometry == draws[recordDraw].geometry &&
+               draw.color == draws[recordDraw].color) {
+                drawOffsets[i] = drawOffsets[recordDraw];
+                continue;
+            }
+            recordDraw = i;
+            ObjectUniforms *objectUniforms = (ObjectUniforms *)uniformRing.allocate(sizeof(ObjectUniforms), drawOffsets[i]);
+            setObjectUniforms(*objectUniforms, draw.object->getModelMatrix(), ViewProjection, draw.color,
+                              draw.geometry->positionScale, draw.geometry->positionOffset, draw.geometry->normalScale);
+        }
+        uniformRing.flush();
+        glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_FRAME_BINDING, uniformRing.buffer(), frameOffset, sizeof(FrameUniforms));
+        
+        VBO *boundGeometry = NULL;
+        GLintptr boundOffset = -1;
+        for(size_t i = 0; i < draws.size(); i++) {
+            const Draw &draw = draws[i];
+            if(draw.geometry->pooled)
+                continue;
+            if(drawOffsets[i] != boundOffset) {
+                boundOffset = drawOffsets[i];
+                glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_OBJECT_BINDING, uniformRing.buffer(), boundOffset, sizeof(ObjectUniforms));
+            }
+            if(draw.geometry != boundGeometry) {
+                if(boundGeometry != NULL && boundGeometry->instancebuffer != 0)
+                    setDefaultInstance();
+                boundGeometry = draw.geometry;
+                boundGeometry->bind();
+            }
+            boundGeometry->drawRange(draw.first, draw.count);
+        }
+        glBindVertexArray(0);
+        if(boundGeometry != NULL && boundGeometry->instancebuffer != 0)
+            setDefaultInstance();
+        
+        // then everything in the pool at once
+        if(pool.drawCount() > 0) {
+            glUseProgram(pooledProgramID);
+            pool.submit();
+        }
+        
+        // the GPU is done with this frame's uniforms once it gets past here
+        uniformRing.endFrame();
 
         // Swap buffers
         glfwSwapBuffers(window);
@@ -263,12 +1028,20 @@ int main(int argc, const char * argv[]) {
 
     } while(glfwWindowShouldClose(window) == 0);
 
+    // Workers may still be loading into the VBOs below
+    loader.shutdown();
+
     // Cleanup VBO and shader
     for(VBO* vbo : vbos) {
         vbo->cleanUp();
     }
+    placeholder.cleanUp();
+    pool.destroy();
+    uniformRing.destroy();
     
     glDeleteProgram(programID);
+    if(pooledProgramID != 0)
+        glDeleteProgram(pooledProgramID);
     
     // Close OpenGL window and terminate GLFW
     glfwTerminate();
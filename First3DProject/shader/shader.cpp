@@ -14,7 +14,7 @@ using namespace std;
 
 #include "shader.hpp"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * vertex_inputs){
 
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
@@ -28,6 +28,11 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 		sstr << VertexShaderStream.rdbuf();
 		VertexShaderCode = sstr.str();
 		VertexShaderStream.close();
+		if(vertex_inputs != NULL){
+			size_t afterVersion = VertexShaderCode.find('\n');
+			afterVersion = afterVersion == std::string::npos ? VertexShaderCode.size() : afterVersion + 1;
+			VertexShaderCode.insert(afterVersion, vertex_inputs);
+		}
 	}else{
 		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
 		getchar();
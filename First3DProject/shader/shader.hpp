@@ -1,6 +1,7 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+// vertex_inputs, if given, is inserted right after the vertex shader's #version line, see common/vertexformat.hpp
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const char * vertex_inputs = NULL);
 
 #endif